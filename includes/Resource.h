@@ -2,11 +2,25 @@
 #include "glad/glad.h"
 #include "stb_image.h"
 #include <assimp/texture.h>
+#include <string>
 
+class CompressedTexture;
 
 class Resource
 {
 public:
-	static GLuint LoadTexture(const GLchar* path, GLint wrapMode = GL_REPEAT, GLint MagFilterMode = GL_LINEAR, GLint MinFilterMode = GL_LINEAR_MIPMAP_LINEAR, bool genMipmap = true);
+	// prefers a texture cooked offline next to the image (same name, .dds; see texture_cooker), else decodes the image.
+	// A normal map cooked with --normal is BC5 and samples as (x, y, 0, 1), so it's only used with twoChannelNormals,
+	// by shaders that rebuild z; everyone else gets the source image
+	static GLuint LoadTexture(const GLchar* path, GLint wrapMode = GL_REPEAT, GLint MagFilterMode = GL_LINEAR, GLint MinFilterMode = GL_LINEAR_MIPMAP_LINEAR, bool genMipmap = true, bool twoChannelNormals = false);
 	static GLuint LoadTextureFromAssImp(const aiTexture* aiTex, GLint wrapMode = GL_REPEAT, GLint MagFilterMode = GL_LINEAR, GLint MinFilterMode = GL_LINEAR_MIPMAP_LINEAR);
+
+private:
+	// immutable texture filled with decoded stb_image data (see GLTexture)
+	static GLuint createTexture(const unsigned char* data, int width, int height, int nrChannels, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode, bool genMipmap);
+	// block compressed texture with the cooked mip chain, or 0 if there's no usable .dds for path
+	static GLuint loadCookedTexture(const std::string& path, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode, bool twoChannelNormals);
+	static GLuint createCompressedTexture(const CompressedTexture& cooked, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode);
+	// whether stbi_set_flip_vertically_on_load is on, which cooked textures have to follow
+	static bool stbFlipsVertically();
 };
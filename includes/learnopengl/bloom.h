@@ -0,0 +1,526 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_c.h>
+
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Physically based bloom (progressive downsample / upsample through a mip chain),
+// as presented by Call Of Duty at ACM Siggraph 2014.
+//
+// Shared by 5.advanced_lighting/7.bloom and 8.guest/2022/6.physically_based_bloom.
+// Shaders are looked up by prefix in the demo's directory:
+//     <prefix>downsample.vs/.fs   <prefix>upsample.vs/.fs   (fragment path, GL 3.3)
+//     <prefix>downsample.cs       <prefix>upsample.cs       (compute path, GL 4.3)
+//
+// The compute path writes each mip with imageStore and accumulates the upsample with
+// imageLoad + imageStore, so there are no FBO attachment changes, no viewport changes and no blending.
+// It falls back to the fragment path when the context is older than 4.3.
+
+struct BloomSettings
+{
+    unsigned int mipCount = 6;
+    // R11F_G11F_B10F is 4 bytes per texel (RGBA16F is 8), no alpha is needed for bloom
+    GLenum internalFormat = GL_R11F_G11F_B10F;
+    bool useCompute = true;
+    // fixed-cost mode: mip 0 has a fixed height (width follows the aspect ratio) instead of
+    // half the window, so the cost of the whole chain does not grow with the resolution
+    bool fixedCost = false;
+    unsigned int fixedHeight = 270;
+};
+
+struct bloomMip
+{
+    glm::vec2 size;
+    glm::ivec2 intSize;
+    unsigned int texture;
+};
+
+class bloomFBO
+{
+public:
+    bloomFBO() : mInit(false), mFBO(0) {}
+
+    bool Init(unsigned int baseWidth, unsigned int baseHeight, unsigned int mipChainLength, GLenum internalFormat)
+    {
+        if (mInit) return true;
+
+        // Safety check
+        if (baseWidth > (unsigned int)INT_MAX || baseHeight > (unsigned int)INT_MAX) {
+            std::cerr << "Window size conversion overflow - cannot build bloom FBO!" << std::endl;
+            return false;
+        }
+
+        glGenFramebuffers(1, &mFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+
+        // mip 0 is the given base size, every following mip is half of the previous one
+        glm::vec2 mipSize((float)baseWidth, (float)baseHeight);
+        glm::ivec2 mipIntSize((int)baseWidth, (int)baseHeight);
+
+        for (GLuint i = 0; i < mipChainLength; i++)
+        {
+            if (mipIntSize.x < 1 || mipIntSize.y < 1)
+                break;
+
+            bloomMip mip;
+            mip.size = mipSize;
+            mip.intSize = mipIntSize;
+
+            glGenTextures(1, &mip.texture);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            // we are downscaling an HDR color buffer, so we need a float texture format.
+            // immutable storage is required to bind the mip as an image in the compute path
+            if (GLAD_GL_VERSION_4_2)
+                glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, mip.intSize.x, mip.intSize.y);
+            else
+                glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, mip.intSize.x, mip.intSize.y, 0, GL_RGB, GL_FLOAT, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            std::cout << "Created bloom mip " << mipIntSize.x << 'x' << mipIntSize.y << std::endl;
+            mMipChain.emplace_back(mip);
+
+            mipSize *= 0.5f;
+            mipIntSize /= 2;
+        }
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, mMipChain[0].texture, 0);
+
+        // setup attachments
+        unsigned int attachments[1] = { GL_COLOR_ATTACHMENT0 };
+        glDrawBuffers(1, attachments);
+
+        // check completion status
+        int status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            printf("bloom FBO error, status: 0x%x\n", status);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return false;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        mInit = true;
+        return true;
+    }
+
+    void Destroy()
+    {
+        for (int i = 0; i < (int)mMipChain.size(); i++) {
+            glDeleteTextures(1, &mMipChain[i].texture);
+            mMipChain[i].texture = 0;
+        }
+        mMipChain.clear();
+        glDeleteFramebuffers(1, &mFBO);
+        mFBO = 0;
+        mInit = false;
+    }
+
+    void BindForWriting()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+    }
+
+    const std::vector<bloomMip>& MipChain() const
+    {
+        return mMipChain;
+    }
+
+private:
+    bool mInit;
+    unsigned int mFBO;
+    std::vector<bloomMip> mMipChain;
+};
+
+class BloomRenderer
+{
+public:
+    BloomRenderer() : mInit(false) {}
+
+    bool Init(unsigned int windowWidth, unsigned int windowHeight, const BloomSettings& settings, const std::string& shaderPrefix)
+    {
+        if (mInit) return true;
+        mSettings = settings;
+        mSrcViewportSize = glm::ivec2(windowWidth, windowHeight);
+        mSrcViewportSizeFloat = glm::vec2((float)windowWidth, (float)windowHeight);
+
+        // Framebuffer
+        glm::ivec2 baseSize = mSrcViewportSize / 2;
+        if (mSettings.fixedCost)
+        {
+            baseSize.y = (int)mSettings.fixedHeight;
+            baseSize.x = (int)(mSettings.fixedHeight * mSrcViewportSizeFloat.x / mSrcViewportSizeFloat.y + 0.5f);
+        }
+        bool status = mFBO.Init(baseSize.x, baseSize.y, mSettings.mipCount, mSettings.internalFormat);
+        if (!status) {
+            std::cerr << "Failed to initialize bloom FBO - cannot create bloom renderer!\n";
+            return false;
+        }
+
+        // Shaders
+        mUseCompute = mSettings.useCompute && GLAD_GL_VERSION_4_3;
+        if (mSettings.useCompute && !mUseCompute)
+            std::cout << "BloomRenderer:: compute shaders need OpenGL 4.3, falling back to fragment passes" << std::endl;
+
+        if (mUseCompute)
+        {
+            std::string defines = std::string("#define BLOOM_IMAGE_FORMAT ") + ImageFormatQualifier(mSettings.internalFormat) + "\n";
+            mDownsampleCompute = new ComputeShader((shaderPrefix + "downsample.cs").c_str(), defines.c_str());
+            mUpsampleCompute = new ComputeShader((shaderPrefix + "upsample.cs").c_str(), defines.c_str());
+
+            mDownsampleCompute->use();
+            mDownsampleCompute->setInt("srcTexture", 0);
+            mUpsampleCompute->use();
+            mUpsampleCompute->setInt("srcTexture", 0);
+            glUseProgram(0);
+        }
+        else
+        {
+            mDownsampleShader = new Shader((shaderPrefix + "downsample.vs").c_str(), (shaderPrefix + "downsample.fs").c_str());
+            mUpsampleShader = new Shader((shaderPrefix + "upsample.vs").c_str(), (shaderPrefix + "upsample.fs").c_str());
+
+            // Downsample
+            mDownsampleShader->use();
+            mDownsampleShader->setInt("srcTexture", 0);
+            glUseProgram(0);
+
+            // Upsample
+            mUpsampleShader->use();
+            mUpsampleShader->setInt("srcTexture", 0);
+            glUseProgram(0);
+        }
+
+        mInit = true;
+        return true;
+    }
+
+    void Destroy()
+    {
+        if (!mInit) return;
+        mFBO.Destroy();
+        // Shader doesn't own its program, so each F/M toggle would otherwise leak two
+        if (mDownsampleShader) glDeleteProgram(mDownsampleShader->ID);
+        if (mUpsampleShader) glDeleteProgram(mUpsampleShader->ID);
+        delete mDownsampleShader;
+        delete mUpsampleShader;
+        if (mDownsampleCompute) glDeleteProgram(mDownsampleCompute->ID);
+        if (mUpsampleCompute) glDeleteProgram(mUpsampleCompute->ID);
+        delete mDownsampleCompute;
+        delete mUpsampleCompute;
+        mDownsampleShader = mUpsampleShader = nullptr;
+        mDownsampleCompute = mUpsampleCompute = nullptr;
+        if (mQuadVAO)
+        {
+            glDeleteVertexArrays(1, &mQuadVAO);
+            glDeleteBuffers(1, &mQuadVBO);
+            mQuadVAO = mQuadVBO = 0;
+        }
+        mInit = false;
+    }
+
+    void RenderBloomTexture(unsigned int srcTexture, float filterRadius)
+    {
+        if (mUseCompute)
+        {
+            this->DispatchDownsamples(srcTexture);
+            this->DispatchUpsamples(filterRadius);
+            return;
+        }
+
+        mFBO.BindForWriting();
+
+        this->RenderDownsamples(srcTexture);
+        this->RenderUpsamples(filterRadius);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // Restore viewport
+        glViewport(0, 0, mSrcViewportSize.x, mSrcViewportSize.y);
+    }
+
+    unsigned int BloomTexture()
+    {
+        return mFBO.MipChain()[0].texture;
+    }
+
+    unsigned int BloomMip_i(int index)
+    {
+        const std::vector<bloomMip>& mipChain = mFBO.MipChain();
+        int size = (int)mipChain.size();
+        return mipChain[(index > size-1) ? size-1 : (index < 0) ? 0 : index].texture;
+    }
+
+    bool UsingCompute() const { return mUseCompute; }
+    const BloomSettings& Settings() const { return mSettings; }
+    const std::vector<bloomMip>& MipChain() const { return mFBO.MipChain(); }
+
+    // GLSL image format qualifier matching the mip texture format
+    static const char* ImageFormatQualifier(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_RGBA16F: return "rgba16f";
+        case GL_RGBA32F: return "rgba32f";
+        default:         return "r11f_g11f_b10f";
+        }
+    }
+
+private:
+    // the first downsample reads the full resolution source; in fixed-cost mode mip 0 can be much
+    // smaller than half of it, so the 13 taps are spread over the footprint of the destination texel instead
+    glm::vec2 FirstSourceResolution() const
+    {
+        return mSettings.fixedCost ? mFBO.MipChain()[0].size * 2.0f : mSrcViewportSizeFloat;
+    }
+
+    void RenderDownsamples(unsigned int srcTexture)
+    {
+        const std::vector<bloomMip>& mipChain = mFBO.MipChain();
+
+        mDownsampleShader->use();
+        mDownsampleShader->setVec2("srcResolution", FirstSourceResolution());
+        if (mKarisAverageOnDownsample) {
+            mDownsampleShader->setInt("mipLevel", 0);
+        }
+
+        // Bind srcTexture (HDR color buffer) as initial texture input
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, srcTexture);
+
+        // Progressively downsample through the mip chain
+        for (int i = 0; i < (int)mipChain.size(); i++)
+        {
+            const bloomMip& mip = mipChain[i];
+            glViewport(0, 0, mip.intSize.x, mip.intSize.y);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, mip.texture, 0);
+
+            // Render screen-filled quad of resolution of current mip
+            RenderQuad();
+
+            // Set current mip resolution as srcResolution for next iteration
+            mDownsampleShader->setVec2("srcResolution", mip.size);
+            // Set current mip as texture input for next iteration
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            // Disable Karis average for consequent downsamples
+            if (i == 0) { mDownsampleShader->setInt("mipLevel", 1); }
+        }
+
+        glUseProgram(0);
+    }
+
+    void RenderUpsamples(float filterRadius)
+    {
+        const std::vector<bloomMip>& mipChain = mFBO.MipChain();
+
+        mUpsampleShader->use();
+        mUpsampleShader->setFloat("filterRadius", filterRadius);
+
+        // Enable additive blending
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBlendEquation(GL_FUNC_ADD);
+
+        for (int i = (int)mipChain.size() - 1; i > 0; i--)
+        {
+            const bloomMip& mip = mipChain[i];
+            const bloomMip& nextMip = mipChain[i-1];
+
+            // Bind viewport and texture from where to read
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+
+            // Set framebuffer render target (we write to this texture)
+            glViewport(0, 0, nextMip.intSize.x, nextMip.intSize.y);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, nextMip.texture, 0);
+
+            // Render screen-filled quad of resolution of current mip
+            RenderQuad();
+        }
+
+        // Disable additive blending
+        glDisable(GL_BLEND);
+
+        glUseProgram(0);
+    }
+
+    void DispatchDownsamples(unsigned int srcTexture)
+    {
+        const std::vector<bloomMip>& mipChain = mFBO.MipChain();
+
+        mDownsampleCompute->use();
+        mDownsampleCompute->setVec2("srcResolution", FirstSourceResolution());
+        mDownsampleCompute->setInt("mipLevel", mKarisAverageOnDownsample ? 0 : 1);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, srcTexture);
+
+        for (int i = 0; i < (int)mipChain.size(); i++)
+        {
+            const bloomMip& mip = mipChain[i];
+            glBindImageTexture(0, mip.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, mSettings.internalFormat);
+            glDispatchCompute(GroupCount(mip.intSize.x), GroupCount(mip.intSize.y), 1);
+            // the next dispatch samples the mip we just wrote
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            mDownsampleCompute->setVec2("srcResolution", mip.size);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            if (i == 0) { mDownsampleCompute->setInt("mipLevel", 1); }
+        }
+
+        glUseProgram(0);
+    }
+
+    void DispatchUpsamples(float filterRadius)
+    {
+        const std::vector<bloomMip>& mipChain = mFBO.MipChain();
+
+        mUpsampleCompute->use();
+        mUpsampleCompute->setFloat("filterRadius", filterRadius);
+
+        for (int i = (int)mipChain.size() - 1; i > 0; i--)
+        {
+            const bloomMip& mip = mipChain[i];
+            const bloomMip& nextMip = mipChain[i-1];
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            // read-write: the shader adds the upsampled color to what the downsample left in this mip
+            glBindImageTexture(0, nextMip.texture, 0, GL_FALSE, 0, GL_READ_WRITE, mSettings.internalFormat);
+            glDispatchCompute(GroupCount(nextMip.intSize.x), GroupCount(nextMip.intSize.y), 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+
+        glUseProgram(0);
+    }
+
+    // must match local_size_x/y in the compute shaders
+    static unsigned int GroupCount(int size)
+    {
+        return (unsigned int)(size + 7) / 8;
+    }
+
+    // own quad so the module does not depend on the demo's renderQuad() vertex layout
+    void RenderQuad()
+    {
+        if (mQuadVAO == 0)
+        {
+            float quadVertices[] = {
+                // positions   // texture Coords
+                -1.0f,  1.0f,  0.0f, 1.0f,
+                -1.0f, -1.0f,  0.0f, 0.0f,
+                 1.0f,  1.0f,  1.0f, 1.0f,
+                 1.0f, -1.0f,  1.0f, 0.0f,
+            };
+            glGenVertexArrays(1, &mQuadVAO);
+            glGenBuffers(1, &mQuadVBO);
+            glBindVertexArray(mQuadVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, mQuadVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        }
+        glBindVertexArray(mQuadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+    }
+
+    bool mInit;
+    bool mUseCompute = false;
+    BloomSettings mSettings;
+    bloomFBO mFBO;
+    glm::ivec2 mSrcViewportSize;
+    glm::vec2 mSrcViewportSizeFloat;
+    Shader* mDownsampleShader = nullptr;
+    Shader* mUpsampleShader = nullptr;
+    ComputeShader* mDownsampleCompute = nullptr;
+    ComputeShader* mUpsampleCompute = nullptr;
+    unsigned int mQuadVAO = 0;
+    unsigned int mQuadVBO = 0;
+
+    bool mKarisAverageOnDownsample = true;
+};
+
+// GPU time of one pass (GL_TIME_ELAPSED). Two queries are used in turn and the result of the
+// previous frame is read, so the pipeline never stalls; the average is printed every reportInterval frames
+class BloomPassTimer
+{
+public:
+    BloomPassTimer(unsigned int reportInterval = 60) : mReportInterval(reportInterval)
+    {
+        glGenQueries(2, mQueries);
+    }
+
+    ~BloomPassTimer()
+    {
+        glDeleteQueries(2, mQueries);
+    }
+
+    void Begin()
+    {
+        glBeginQuery(GL_TIME_ELAPSED, mQueries[mFrameIndex % 2]);
+    }
+
+    void End()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        mPending[mFrameIndex % 2] = true;
+        mFrameIndex++;
+    }
+
+    // call once per frame after End(); label changes restart the average (e.g. when switching bloom mode)
+    void Report(const std::string& label)
+    {
+        // the query issued one frame earlier, it is reused by the next Begin()
+        unsigned int previous = mFrameIndex % 2;
+        if (!mPending[previous])
+            return;
+        GLint available = 0;
+        glGetQueryObjectiv(mQueries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(mQueries[previous], GL_QUERY_RESULT, &elapsedNs);
+        mPending[previous] = false;
+
+        if (label != mLabel)
+        {
+            mLabel = label;
+            mAccumulatedMs = 0.0;
+            mAccumulatedFrames = 0;
+            return;
+        }
+        mAccumulatedMs += elapsedNs / 1000000.0;
+        if (++mAccumulatedFrames == mReportInterval)
+        {
+            printf("%s: %.3f ms (avg of %u frames)\n", mLabel.c_str(), mAccumulatedMs / mAccumulatedFrames, mAccumulatedFrames);
+            mAccumulatedMs = 0.0;
+            mAccumulatedFrames = 0;
+        }
+    }
+
+private:
+    unsigned int mQueries[2];
+    bool mPending[2] = { false, false };
+    unsigned int mFrameIndex = 0;
+    unsigned int mReportInterval;
+    std::string mLabel;
+    double mAccumulatedMs = 0.0;
+    unsigned int mAccumulatedFrames = 0;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_resources.h>
+
+#include <algorithm>
+
+// Per-frame / per-view constants shared by every program through one uniform block, instead of
+// setMat4("projection") / setMat4("view") / setVec3("viewPos") on each program every frame.
+//
+// Shaders declare the block exactly like resources/shaders/frame_constants.glsl (paste it, or
+// #include it through ShaderPreprocessor) and read frame.view, frame.cameraPosition.xyz, ...
+// The Shader classes point the block at FrameConstants::BINDING right after linking, so no
+// glUniformBlockBinding calls are needed in the demos (GLSL 330 has no layout(binding = N)).
+//
+// Set writes the next slot of a small ring buffer and binds that range, so a view never overwrites
+// data that draws still in flight may read. Call it once per frame, and again for every extra view
+// (shadow map, cube map face, ...) rendered that frame.
+
+// std140 layout of the block; every member is a mat4 or a vec4, so the C++ layout matches without padding
+struct FrameConstantsData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 cameraPosition; // xyz, w = 1
+    glm::vec4 screenSize;     // width, height, 1 / width, 1 / height
+    glm::vec4 time;           // seconds since start, seconds since last frame, frame number, 0
+};
+
+class FrameConstants
+{
+public:
+    // binding point reserved for the block in every program; the demos' own blocks use the low ones
+    static const unsigned int BINDING = 15;
+
+    FrameConstantsData Data;
+
+    // slots: how many views can be in flight before the ring wraps (e.g. 3 frames of 2 views each)
+    void Create(unsigned int slots = 6)
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        stride = (GLsizeiptr)((sizeof(FrameConstantsData) + alignment - 1) / alignment * alignment);
+        slotCount = std::max(1u, slots);
+        buffer.Create(stride * slotCount, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        next = 0;
+        frame = 0;
+    }
+
+    // starts a new frame: time and frame counter for every view set until the next BeginFrame
+    void BeginFrame(float seconds, float deltaSeconds)
+    {
+        Data.time = glm::vec4(seconds, deltaSeconds, (float)frame++, 0.0f);
+    }
+
+    // fills the derived values, uploads them into the next slot and binds it to BINDING
+    void Set(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, int width, int height)
+    {
+        Data.view = view;
+        Data.projection = projection;
+        Data.viewProjection = projection * view;
+        Data.inverseView = glm::inverse(view);
+        Data.inverseProjection = glm::inverse(projection);
+        Data.inverseViewProjection = glm::inverse(Data.viewProjection);
+        Data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+        Data.screenSize = glm::vec4((float)width, (float)height, 1.0f / std::max(1, width), 1.0f / std::max(1, height));
+
+        GLintptr offset = (GLintptr)next * stride;
+        next = (next + 1) % slotCount;
+        buffer.Update(offset, sizeof(FrameConstantsData), &Data);
+        glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, buffer.ID, offset, sizeof(FrameConstantsData));
+    }
+
+    void Destroy() { buffer.Destroy(); }
+
+    // points the program's FrameConstants block (if it has one) at BINDING; called by the Shader classes after linking
+    static void BindBlock(unsigned int program)
+    {
+        GLuint index = glGetUniformBlockIndex(program, "FrameConstants");
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, BINDING);
+    }
+
+private:
+    GLBuffer buffer;
+    GLsizeiptr stride = 0;
+    unsigned int slotCount = 1, next = 0, frame = 0;
+};
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <vector>
+
+// GPU resources created and edited without binding them: buffers, textures, vertex layouts (VAOs)
+// and framebuffers.
+//
+// On GL 4.5 everything goes through direct state access (glCreate*, glNamed*, glTexture*, glVertexArray*),
+// so loading a model or building a framebuffer never touches the bindings the draw code relies on.
+// Storage is immutable where the context allows it (glBufferStorage 4.4, glTexStorage 4.2): the size
+// and format are fixed at creation and only the contents can change.
+//
+// Older contexts (the 3.3 the demos ask for) fall back to bind-to-edit. The fallback puts back
+// whatever was bound before, and buffers are edited through GL_COPY_WRITE_BUFFER, which no draw reads,
+// so the visible effect is the same; only the extra binds remain.
+//
+// The classes are plain handles like Shader: copying one copies the name, Destroy frees the objects.
+//
+//   GLBuffer vertices;
+//   vertices.Create(sizeof(data), data);
+//   GLVertexLayout layout;
+//   layout.Create();
+//   layout.Attribute(0, 0, 3, GL_FLOAT, 0);
+//   layout.VertexBuffer(0, vertices, 0, 3 * sizeof(float));
+
+struct GLResources
+{
+    // use the bind-to-edit paths even when DSA is available (for comparing both)
+    static inline bool ForceFallback = false;
+
+    static bool DirectStateAccess() { return GLAD_GL_VERSION_4_5 && !ForceFallback; }
+    static bool BufferStorage() { return GLAD_GL_VERSION_4_4 && !ForceFallback; }
+    static bool TextureStorage() { return GLAD_GL_VERSION_4_2 && !ForceFallback; }
+
+    // number of levels of a full mip chain
+    static int MipLevels(int width, int height)
+    {
+        int levels = 1;
+        for (int size = std::max(width, height); size > 1; size >>= 1)
+            ++levels;
+        return levels;
+    }
+};
+
+// restores a binding read with glGetIntegerv when it goes out of scope (fallback paths only)
+class GLBindingScope
+{
+public:
+    typedef void (*Rebind)(GLenum target, GLuint name);
+
+    GLBindingScope(GLenum query, GLenum target, Rebind rebind) : target(target), rebind(rebind)
+    {
+        glGetIntegerv(query, &previous);
+    }
+    ~GLBindingScope() { rebind(target, (GLuint)previous); }
+
+    static void Buffer(GLenum target, GLuint name) { glBindBuffer(target, name); }
+    static void Texture(GLenum target, GLuint name) { glBindTexture(target, name); }
+    static void Framebuffer(GLenum target, GLuint name) { glBindFramebuffer(target, name); }
+    static void Renderbuffer(GLenum target, GLuint name) { glBindRenderbuffer(target, name); }
+    static void VertexArray(GLenum, GLuint name) { glBindVertexArray(name); }
+
+private:
+    GLenum target;
+    Rebind rebind;
+    GLint previous = 0;
+};
+
+class GLBuffer
+{
+public:
+    unsigned int ID = 0;
+    GLsizeiptr Size = 0;
+
+    // flags as for glBufferStorage; GL_DYNAMIC_STORAGE_BIT is needed for Update
+    void Create(GLsizeiptr size, const void* data = nullptr, GLbitfield flags = 0)
+    {
+        Size = size;
+        if (GLResources::DirectStateAccess())
+        {
+            glCreateBuffers(1, &ID);
+            glNamedBufferStorage(ID, size, data, flags);
+            return;
+        }
+        glGenBuffers(1, &ID);
+        GLBindingScope scope(GL_COPY_WRITE_BUFFER_BINDING, GL_COPY_WRITE_BUFFER, GLBindingScope::Buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        if (GLResources::BufferStorage())
+            glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, flags);
+        else
+            glBufferData(GL_COPY_WRITE_BUFFER, size, data, (flags & GL_DYNAMIC_STORAGE_BIT) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    }
+
+    void Update(GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glNamedBufferSubData(ID, offset, size, data);
+            return;
+        }
+        GLBindingScope scope(GL_COPY_WRITE_BUFFER_BINDING, GL_COPY_WRITE_BUFFER, GLBindingScope::Buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    }
+
+    // GPU-side copy, e.g. into a larger buffer that replaces this one
+    void CopyFrom(const GLBuffer& source, GLintptr sourceOffset, GLintptr offset, GLsizeiptr size)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glCopyNamedBufferSubData(source.ID, ID, sourceOffset, offset, size);
+            return;
+        }
+        GLBindingScope readScope(GL_COPY_READ_BUFFER_BINDING, GL_COPY_READ_BUFFER, GLBindingScope::Buffer);
+        GLBindingScope writeScope(GL_COPY_WRITE_BUFFER_BINDING, GL_COPY_WRITE_BUFFER, GLBindingScope::Buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, source.ID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, offset, size);
+    }
+
+    void Destroy()
+    {
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+        Size = 0;
+    }
+};
+
+class GLTexture
+{
+public:
+    unsigned int ID = 0;
+    GLenum Target = GL_TEXTURE_2D;
+    GLenum InternalFormat = GL_RGBA8;
+    int Width = 0, Height = 0, Levels = 1, Samples = 0;
+
+    // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP with a sized internal format; levels 0 means a full mip chain
+    void Create(GLenum target, GLenum internalFormat, int width, int height, int levels = 1)
+    {
+        Target = target;
+        InternalFormat = internalFormat;
+        Width = width;
+        Height = height;
+        Levels = levels > 0 ? levels : GLResources::MipLevels(width, height);
+        Samples = 0;
+        if (GLResources::DirectStateAccess())
+        {
+            glCreateTextures(target, 1, &ID);
+            glTextureStorage2D(ID, Levels, internalFormat, width, height);
+            glTextureParameteri(ID, GL_TEXTURE_MAX_LEVEL, Levels - 1);
+            return;
+        }
+        glGenTextures(1, &ID);
+        GLBindingScope scope(bindingQuery(), target, GLBindingScope::Texture);
+        glBindTexture(target, ID);
+        if (GLResources::TextureStorage())
+            glTexStorage2D(target, Levels, internalFormat, width, height);
+        else
+        {
+            GLenum format, type;
+            uploadFormat(internalFormat, format, type);
+            for (int level = 0; level < Levels; ++level)
+            {
+                int w = std::max(1, width >> level), h = std::max(1, height >> level);
+                if (target == GL_TEXTURE_CUBE_MAP)
+                    for (int face = 0; face < 6; ++face)
+                        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internalFormat, w, h, 0, format, type, nullptr);
+                else
+                    glTexImage2D(target, level, internalFormat, w, h, 0, format, type, nullptr);
+            }
+        }
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, Levels - 1);
+    }
+
+    void CreateMultisample(GLenum internalFormat, int width, int height, int samples)
+    {
+        Target = GL_TEXTURE_2D_MULTISAMPLE;
+        InternalFormat = internalFormat;
+        Width = width;
+        Height = height;
+        Levels = 1;
+        Samples = samples;
+        if (GLResources::DirectStateAccess())
+        {
+            glCreateTextures(Target, 1, &ID);
+            glTextureStorage2DMultisample(ID, samples, internalFormat, width, height, GL_TRUE);
+            return;
+        }
+        glGenTextures(1, &ID);
+        GLBindingScope scope(GL_TEXTURE_BINDING_2D_MULTISAMPLE, Target, GLBindingScope::Texture);
+        glBindTexture(Target, ID);
+        glTexImage2DMultisample(Target, samples, internalFormat, width, height, GL_TRUE);
+    }
+
+    // face is the cube map face (0..5), ignored for 2D textures
+    void Upload(int level, int x, int y, int width, int height, GLenum format, GLenum type, const void* data, int face = 0)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            if (Target == GL_TEXTURE_CUBE_MAP)
+                glTextureSubImage3D(ID, level, x, y, face, width, height, 1, format, type, data);
+            else
+                glTextureSubImage2D(ID, level, x, y, width, height, format, type, data);
+            return;
+        }
+        GLBindingScope scope(bindingQuery(), Target, GLBindingScope::Texture);
+        glBindTexture(Target, ID);
+        glTexSubImage2D(Target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : Target, level, x, y, width, height, format, type, data);
+    }
+
+    // block compressed data in the texture's (compressed) internal format, size bytes
+    void UploadCompressed(int level, int x, int y, int width, int height, GLsizei size, const void* data, int face = 0)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            if (Target == GL_TEXTURE_CUBE_MAP)
+                glCompressedTextureSubImage3D(ID, level, x, y, face, width, height, 1, InternalFormat, size, data);
+            else
+                glCompressedTextureSubImage2D(ID, level, x, y, width, height, InternalFormat, size, data);
+            return;
+        }
+        GLBindingScope scope(bindingQuery(), Target, GLBindingScope::Texture);
+        glBindTexture(Target, ID);
+        glCompressedTexSubImage2D(Target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : Target, level, x, y, width, height, InternalFormat, size, data);
+    }
+
+    void Parameter(GLenum name, GLint value)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glTextureParameteri(ID, name, value);
+            return;
+        }
+        GLBindingScope scope(bindingQuery(), Target, GLBindingScope::Texture);
+        glBindTexture(Target, ID);
+        glTexParameteri(Target, name, value);
+    }
+
+    void SetWrap(GLint wrap)
+    {
+        Parameter(GL_TEXTURE_WRAP_S, wrap);
+        Parameter(GL_TEXTURE_WRAP_T, wrap);
+        if (Target == GL_TEXTURE_CUBE_MAP)
+            Parameter(GL_TEXTURE_WRAP_R, wrap);
+    }
+
+    void SetFilter(GLint minFilter, GLint magFilter)
+    {
+        Parameter(GL_TEXTURE_MIN_FILTER, minFilter);
+        Parameter(GL_TEXTURE_MAG_FILTER, magFilter);
+    }
+
+    void GenerateMipmaps()
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glGenerateTextureMipmap(ID);
+            return;
+        }
+        GLBindingScope scope(bindingQuery(), Target, GLBindingScope::Texture);
+        glBindTexture(Target, ID);
+        glGenerateMipmap(Target);
+    }
+
+    void Destroy()
+    {
+        glDeleteTextures(1, &ID);
+        ID = 0;
+    }
+
+private:
+    GLenum bindingQuery() const
+    {
+        switch (Target)
+        {
+        case GL_TEXTURE_CUBE_MAP:          return GL_TEXTURE_BINDING_CUBE_MAP;
+        case GL_TEXTURE_2D_MULTISAMPLE:    return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+        default:                           return GL_TEXTURE_BINDING_2D;
+        }
+    }
+
+    // glTexImage2D without data still wants a format/type pair that matches the internal format
+    static void uploadFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+    {
+        type = GL_UNSIGNED_BYTE;
+        switch (internalFormat)
+        {
+        case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F:
+            format = GL_DEPTH_COMPONENT;
+            type = GL_FLOAT;
+            break;
+        case GL_DEPTH24_STENCIL8:
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+            break;
+        case GL_DEPTH32F_STENCIL8:
+            format = GL_DEPTH_STENCIL;
+            type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+            break;
+        case GL_R8: case GL_R16F: case GL_R32F:
+            format = GL_RED;
+            break;
+        case GL_RG8: case GL_RG16F: case GL_RG32F:
+            format = GL_RG;
+            break;
+        case GL_RGB8: case GL_SRGB8: case GL_RGB16F: case GL_RGB32F: case GL_R11F_G11F_B10F:
+            format = GL_RGB;
+            break;
+        default:
+            format = GL_RGBA;
+            break;
+        }
+    }
+};
+
+// a VAO described by attribute formats and buffer binding points (the GL 4.3 vertex binding model);
+// without DSA every attribute is turned into a glVertexAttribPointer once its buffer is known
+class GLVertexLayout
+{
+public:
+    unsigned int ID = 0;
+
+    void Create()
+    {
+        if (GLResources::DirectStateAccess())
+            glCreateVertexArrays(1, &ID);
+        else
+            glGenVertexArrays(1, &ID);
+    }
+
+    // attribute index reads size components of type at offset inside each vertex of binding point binding;
+    // integer attributes reach the shader as ivec (glVertexAttribIPointer)
+    void Attribute(unsigned int index, unsigned int binding, int size, GLenum type, unsigned int offset, bool normalized = false, bool integer = false)
+    {
+        AttributeFormat attribute = { index, binding, size, type, offset, normalized, integer };
+        attributes.push_back(attribute);
+        if (GLResources::DirectStateAccess())
+        {
+            glEnableVertexArrayAttrib(ID, index);
+            if (integer)
+                glVertexArrayAttribIFormat(ID, index, size, type, offset);
+            else
+                glVertexArrayAttribFormat(ID, index, size, type, normalized ? GL_TRUE : GL_FALSE, offset);
+            glVertexArrayAttribBinding(ID, index, binding);
+            return;
+        }
+        const BufferBinding* buffer = findBinding(binding);
+        if (buffer)
+            apply(attribute, *buffer);
+    }
+
+    // divisor 1 advances the binding once per instance instead of once per vertex
+    void VertexBuffer(unsigned int binding, const GLBuffer& buffer, GLintptr offset, GLsizei stride, unsigned int divisor = 0)
+    {
+        BufferBinding entry = { binding, buffer.ID, offset, stride, divisor };
+        bindings.erase(std::remove_if(bindings.begin(), bindings.end(), [binding](const BufferBinding& b) { return b.binding == binding; }), bindings.end());
+        bindings.push_back(entry);
+        if (GLResources::DirectStateAccess())
+        {
+            glVertexArrayVertexBuffer(ID, binding, buffer.ID, offset, stride);
+            glVertexArrayBindingDivisor(ID, binding, divisor);
+            return;
+        }
+        for (const AttributeFormat& attribute : attributes)
+            if (attribute.binding == binding)
+                apply(attribute, entry);
+    }
+
+    void IndexBuffer(const GLBuffer& buffer)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glVertexArrayElementBuffer(ID, buffer.ID);
+            return;
+        }
+        GLBindingScope scope(GL_VERTEX_ARRAY_BINDING, 0, GLBindingScope::VertexArray);
+        glBindVertexArray(ID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.ID);
+    }
+
+    void Destroy()
+    {
+        glDeleteVertexArrays(1, &ID);
+        ID = 0;
+        attributes.clear();
+        bindings.clear();
+    }
+
+private:
+    struct AttributeFormat
+    {
+        unsigned int index, binding;
+        int size;
+        GLenum type;
+        unsigned int offset;
+        bool normalized, integer;
+    };
+    struct BufferBinding
+    {
+        unsigned int binding, buffer;
+        GLintptr offset;
+        GLsizei stride;
+        unsigned int divisor;
+    };
+    std::vector<AttributeFormat> attributes;
+    std::vector<BufferBinding> bindings;
+
+    const BufferBinding* findBinding(unsigned int binding) const
+    {
+        for (const BufferBinding& entry : bindings)
+            if (entry.binding == binding)
+                return &entry;
+        return nullptr;
+    }
+
+    void apply(const AttributeFormat& attribute, const BufferBinding& buffer)
+    {
+        GLBindingScope vertexArray(GL_VERTEX_ARRAY_BINDING, 0, GLBindingScope::VertexArray);
+        GLBindingScope arrayBuffer(GL_ARRAY_BUFFER_BINDING, GL_ARRAY_BUFFER, GLBindingScope::Buffer);
+        glBindVertexArray(ID);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.buffer);
+        const void* pointer = (const void*)(buffer.offset + attribute.offset);
+        glEnableVertexAttribArray(attribute.index);
+        if (attribute.integer)
+            glVertexAttribIPointer(attribute.index, attribute.size, attribute.type, buffer.stride, pointer);
+        else
+            glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, buffer.stride, pointer);
+        glVertexAttribDivisor(attribute.index, buffer.divisor);
+    }
+};
+
+class GLFramebuffer
+{
+public:
+    unsigned int ID = 0;
+
+    void Create()
+    {
+        if (GLResources::DirectStateAccess())
+            glCreateFramebuffers(1, &ID);
+        else
+            glGenFramebuffers(1, &ID);
+    }
+
+    void Attach(GLenum attachment, const GLTexture& texture, int level = 0)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glNamedFramebufferTexture(ID, attachment, texture.ID, level);
+            return;
+        }
+        GLBindingScope scope(GL_DRAW_FRAMEBUFFER_BINDING, GL_DRAW_FRAMEBUFFER, GLBindingScope::Framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ID);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, attachment, texture.Target, texture.ID, level);
+    }
+
+    // a renderbuffer owned by the framebuffer (freed by Destroy), for attachments that are never sampled
+    void AttachRenderbuffer(GLenum attachment, GLenum internalFormat, int width, int height, int samples = 0)
+    {
+        unsigned int renderbuffer;
+        if (GLResources::DirectStateAccess())
+        {
+            glCreateRenderbuffers(1, &renderbuffer);
+            glNamedRenderbufferStorageMultisample(renderbuffer, samples, internalFormat, width, height);
+            glNamedFramebufferRenderbuffer(ID, attachment, GL_RENDERBUFFER, renderbuffer);
+        }
+        else
+        {
+            glGenRenderbuffers(1, &renderbuffer);
+            {
+                GLBindingScope scope(GL_RENDERBUFFER_BINDING, GL_RENDERBUFFER, GLBindingScope::Renderbuffer);
+                glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+                glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internalFormat, width, height);
+            }
+            GLBindingScope scope(GL_DRAW_FRAMEBUFFER_BINDING, GL_DRAW_FRAMEBUFFER, GLBindingScope::Framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ID);
+            glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, attachment, GL_RENDERBUFFER, renderbuffer);
+        }
+        renderbuffers.push_back(renderbuffer);
+    }
+
+    void DrawBuffers(const std::vector<GLenum>& attachments)
+    {
+        if (GLResources::DirectStateAccess())
+        {
+            glNamedFramebufferDrawBuffers(ID, (GLsizei)attachments.size(), attachments.data());
+            return;
+        }
+        GLBindingScope scope(GL_DRAW_FRAMEBUFFER_BINDING, GL_DRAW_FRAMEBUFFER, GLBindingScope::Framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ID);
+        glDrawBuffers((GLsizei)attachments.size(), attachments.data());
+    }
+
+    bool Complete()
+    {
+        if (GLResources::DirectStateAccess())
+            return glCheckNamedFramebufferStatus(ID, GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        GLBindingScope scope(GL_DRAW_FRAMEBUFFER_BINDING, GL_DRAW_FRAMEBUFFER, GLBindingScope::Framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ID);
+        return glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    void Destroy()
+    {
+        if (!renderbuffers.empty())
+            glDeleteRenderbuffers((GLsizei)renderbuffers.size(), renderbuffers.data());
+        renderbuffers.clear();
+        glDeleteFramebuffers(1, &ID);
+        ID = 0;
+    }
+
+private:
+    std::vector<unsigned int> renderbuffers;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the GL state the draw paths touch most: bound program, VAO, textures per
+// unit, active unit, framebuffers, blend/depth/cull switches, blend and depth functions.
+//
+// Every call goes through the cache and is counted. With Filter on, calls that would set the
+// state to what it already is are skipped; with Filter off (the default) every call reaches GL,
+// so code that still mixes in raw gl* calls keeps working, and Frame.filtered tells how many of
+// them were redundant.
+//
+// An app that turns Filter on must route all changes to the shadowed state through GLState
+// (including glDelete*, since deleting a bound object unbinds it), or call Invalidate after raw
+// GL code. Single context only.
+
+struct GLStateCounters
+{
+    unsigned int issued = 0;   // calls that reached GL
+    unsigned int filtered = 0; // redundant calls (skipped when Filter is on)
+};
+
+class GLState
+{
+public:
+    static inline bool Filter = false;
+    static inline GLStateCounters Frame, LastFrame;
+
+    static const unsigned int UNITS = 32;
+
+    static void UseProgram(unsigned int program)
+    {
+        if (change(state().program, program))
+            glUseProgram(program);
+    }
+
+    static void BindVertexArray(unsigned int vao)
+    {
+        if (change(state().vertexArray, vao))
+            glBindVertexArray(vao);
+    }
+
+    static void ActiveTexture(GLenum unit)
+    {
+        if (change(state().activeUnit, unit - GL_TEXTURE0))
+            glActiveTexture(unit);
+    }
+
+    // binds to the active unit
+    static void BindTexture(GLenum target, unsigned int texture)
+    {
+        State& s = state();
+        int slot = targetSlot(target);
+        if (slot < 0 || s.activeUnit >= UNITS)
+        {
+            ++Frame.issued;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (change(s.textures[s.activeUnit][slot], texture))
+            glBindTexture(target, texture);
+    }
+
+    // binds to the given unit, activating it only when the binding actually changes
+    static void BindTexture(GLenum unit, GLenum target, unsigned int texture)
+    {
+        State& s = state();
+        int slot = targetSlot(target);
+        unsigned int index = unit - GL_TEXTURE0;
+        if (Filter && slot >= 0 && index < UNITS && s.textures[index][slot] == texture)
+        {
+            ++Frame.filtered;
+            return;
+        }
+        ActiveTexture(unit);
+        BindTexture(target, texture);
+    }
+
+    static void BindFramebuffer(GLenum target, unsigned int framebuffer)
+    {
+        State& s = state();
+        bool draw = target != GL_READ_FRAMEBUFFER, read = target != GL_DRAW_FRAMEBUFFER;
+        if ((!draw || s.drawFramebuffer == framebuffer) && (!read || s.readFramebuffer == framebuffer))
+        {
+            ++Frame.filtered;
+            if (Filter)
+                return;
+        }
+        ++Frame.issued;
+        if (draw)
+            s.drawFramebuffer = framebuffer;
+        if (read)
+            s.readFramebuffer = framebuffer;
+        glBindFramebuffer(target, framebuffer);
+    }
+
+    // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST are cached, others pass through
+    static void Enable(GLenum capability) { setCapability(capability, true); }
+    static void Disable(GLenum capability) { setCapability(capability, false); }
+
+    static void BlendFunc(GLenum source, GLenum destination)
+    {
+        State& s = state();
+        bool changed = change(s.blendSource, source, false);
+        changed = change(s.blendDestination, destination, false) || changed;
+        if (count(changed))
+            glBlendFunc(source, destination);
+    }
+
+    static void DepthFunc(GLenum function)
+    {
+        if (change(state().depthFunction, function))
+            glDepthFunc(function);
+    }
+
+    static void DepthMask(bool write)
+    {
+        if (change(state().depthMask, write ? 1u : 0u))
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+
+    // deleting a bound object makes GL bind 0 in its place, so the cache has to forget it too
+    static void DeleteProgram(unsigned int program)
+    {
+        State& s = state();
+        if (s.program == program)
+            s.program = UNKNOWN;
+        glDeleteProgram(program);
+    }
+    static void DeleteVertexArray(unsigned int vao)
+    {
+        State& s = state();
+        if (s.vertexArray == vao)
+            s.vertexArray = UNKNOWN;
+        glDeleteVertexArrays(1, &vao);
+    }
+    static void DeleteTexture(unsigned int texture)
+    {
+        State& s = state();
+        for (auto& unit : s.textures)
+            for (unsigned int& bound : unit)
+                if (bound == texture)
+                    bound = UNKNOWN;
+        glDeleteTextures(1, &texture);
+    }
+    static void DeleteFramebuffer(unsigned int framebuffer)
+    {
+        State& s = state();
+        if (s.drawFramebuffer == framebuffer)
+            s.drawFramebuffer = UNKNOWN;
+        if (s.readFramebuffer == framebuffer)
+            s.readFramebuffer = UNKNOWN;
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    // forget everything, the next call of each kind always reaches GL; use after raw GL code
+    static void Invalidate() { state() = State(); }
+
+    // call once per frame: LastFrame receives the counts of the frame that just ended
+    static void EndFrame()
+    {
+        LastFrame = Frame;
+        Frame = GLStateCounters();
+    }
+
+private:
+    static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+    static const int TARGETS = 5;
+
+    struct State
+    {
+        unsigned int program = UNKNOWN, vertexArray = UNKNOWN, activeUnit = UNKNOWN;
+        unsigned int textures[UNITS][TARGETS];
+        unsigned int drawFramebuffer = UNKNOWN, readFramebuffer = UNKNOWN;
+        unsigned int capabilities[5] = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN };
+        unsigned int blendSource = UNKNOWN, blendDestination = UNKNOWN, depthFunction = UNKNOWN, depthMask = UNKNOWN;
+
+        State()
+        {
+            for (auto& unit : textures)
+                for (unsigned int& bound : unit)
+                    bound = UNKNOWN;
+        }
+    };
+
+    static State& state()
+    {
+        static State current;
+        return current;
+    }
+
+    static int targetSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D:             return 0;
+        case GL_TEXTURE_CUBE_MAP:       return 1;
+        case GL_TEXTURE_2D_MULTISAMPLE: return 2;
+        case GL_TEXTURE_2D_ARRAY:       return 3;
+        case GL_TEXTURE_3D:             return 4;
+        default:                        return -1;
+        }
+    }
+
+    static int capabilitySlot(GLenum capability)
+    {
+        switch (capability)
+        {
+        case GL_BLEND:        return 0;
+        case GL_DEPTH_TEST:   return 1;
+        case GL_CULL_FACE:    return 2;
+        case GL_SCISSOR_TEST: return 3;
+        case GL_STENCIL_TEST: return 4;
+        default:              return -1;
+        }
+    }
+
+    // updates the shadow value; true if the GL call has to be made (and counts it either way)
+    static bool change(unsigned int& current, unsigned int value, bool counted = true)
+    {
+        bool changed = current != value;
+        current = value;
+        return counted ? count(changed) : changed;
+    }
+
+    static bool count(bool changed)
+    {
+        if (changed)
+        {
+            ++Frame.issued;
+            return true;
+        }
+        ++Frame.filtered;
+        if (Filter)
+            return false;
+        ++Frame.issued;
+        return true;
+    }
+
+    static void setCapability(GLenum capability, bool enabled)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot < 0)
+        {
+            ++Frame.issued;
+            enabled ? glEnable(capability) : glDisable(capability);
+            return;
+        }
+        if (change(state().capabilities[slot], enabled ? 1u : 0u))
+            enabled ? glEnable(capability) : glDisable(capability);
+    }
+};
+
+#endif
@@ -0,0 +1,389 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// On-demand glyph cache for large character sets (CJK).
+//
+// Glyphs are rasterized by FreeType the first time they are requested and stored in
+// fixed-size slots of atlas pages (GL_RED textures). Memory is bounded by maxPages:
+// once every slot is taken, the least recently used glyph's slot is reused.
+//
+// With worker threads, a missing glyph is queued and rasterized in the background
+// (each worker owns its own FT_Library/FT_Face, FreeType faces are not thread safe);
+// Get returns it as pending until Update uploads the finished bitmaps, once per frame.
+// Without workers, glyphs are rasterized and uploaded inside Get.
+//
+// A hit costs one hash lookup plus relinking the slot at the front of the LRU list.
+
+struct CachedGlyph
+{
+    glm::ivec2   Size;      // size of glyph bitmap
+    glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
+    unsigned int Advance;   // horizontal offset to advance to next glyph (1/64 pixels)
+    unsigned int Page;      // atlas page holding the glyph
+    glm::vec4    UVRect;    // uv offset, uv scale inside the page
+    bool         Ready;     // false while the bitmap is still being rasterized
+};
+
+struct GlyphCacheStats
+{
+    unsigned int hits = 0, misses = 0, evictions = 0, uploads = 0, dropped = 0, failed = 0;
+};
+
+class GlyphCache
+{
+public:
+    GlyphCacheStats Stats;
+
+    GlyphCache() : mPixelSize(0), mPageSize(0), mSlotSize(0), mSlotsPerPage(0), mMaxPages(0), mPlaceholderAdvance(0),
+                   mLruHead(NONE), mLruTail(NONE), mBatch(1), mLibrary(nullptr), mFace(nullptr), mStop(false) {}
+    ~GlyphCache() { Destroy(); }
+
+    // pageSize: atlas page width/height; maxPages bounds memory (maxPages * pageSize^2 bytes);
+    // workerCount 0 rasterizes on the calling thread
+    bool Init(const std::string &font, unsigned int pixelSize, unsigned int pageSize = 1024, unsigned int maxPages = 4, unsigned int workerCount = 2)
+    {
+        Destroy();
+        if (FT_Init_FreeType(&mLibrary))
+        {
+            std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+            return false;
+        }
+        if (FT_New_Face(mLibrary, font.c_str(), 0, &mFace))
+        {
+            std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+            return false;
+        }
+        FT_Set_Pixel_Sizes(mFace, 0, pixelSize);
+        mFont = font;
+        mPixelSize = pixelSize;
+        mPageSize = pageSize;
+        // a slot fits the largest glyph of the face plus one texel of padding on each side
+        unsigned int lineHeight = (unsigned int)((mFace->size->metrics.height + 63) >> 6);
+        unsigned int maxAdvance = (unsigned int)((mFace->size->metrics.max_advance + 63) >> 6);
+        mSlotSize = std::max(lineHeight, maxAdvance) + 2;
+        // pending/missing glyphs still take up room on the line: the width of a space, or half the widest glyph
+        if (FT_Load_Char(mFace, ' ', FT_LOAD_DEFAULT) == 0 && mFace->glyph->advance.x > 0)
+            mPlaceholderAdvance = (unsigned int)mFace->glyph->advance.x;
+        else
+            mPlaceholderAdvance = (unsigned int)(mFace->size->metrics.max_advance / 2);
+        mSlotsPerPage = (pageSize / mSlotSize) * (pageSize / mSlotSize);
+        mMaxPages = maxPages;
+        mSlots.clear();
+        mSlots.reserve(mSlotsPerPage * maxPages);
+        for (unsigned int i = 0; i < workerCount; ++i)
+            mWorkers.emplace_back(&GlyphCache::workerLoop, this);
+        return true;
+    }
+
+    void Destroy()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWakeWorkers.notify_all();
+        for (std::thread &worker : mWorkers)
+            worker.join();
+        mWorkers.clear();
+        mStop = false;
+        mJobs.clear();
+        mResults.clear();
+        if (!mPages.empty())
+            glDeleteTextures((GLsizei)mPages.size(), mPages.data());
+        mPages.clear();
+        mSlots.clear();
+        mLookup.clear();
+        mLruHead = mLruTail = NONE;
+        if (mFace)
+            FT_Done_Face(mFace);
+        if (mLibrary)
+            FT_Done_FreeType(mLibrary);
+        mFace = nullptr;
+        mLibrary = nullptr;
+    }
+
+    // the glyph for a code point, rasterizing (or queueing) it on a miss; null if it can't be cached
+    // right now (every slot is used by the current batch). The pointer stays valid until the next Get.
+    const CachedGlyph *Get(char32_t codePoint)
+    {
+        auto found = mLookup.find(codePoint);
+        if (found != mLookup.end())
+        {
+            ++Stats.hits;
+            touch(found->second);
+            return &mSlots[found->second].glyph;
+        }
+        ++Stats.misses;
+        unsigned int slot = allocateSlot();
+        if (slot == NONE)
+        {
+            ++Stats.dropped;
+            return nullptr;
+        }
+        Slot &s = mSlots[slot];
+        s.codePoint = codePoint;
+        s.generation++;
+        s.glyph.Ready = false;
+        s.glyph.Size = glm::ivec2(0);
+        s.glyph.Bearing = glm::ivec2(0);
+        s.glyph.Advance = 0;
+        mLookup[codePoint] = slot;
+        touch(slot);
+        if (mWorkers.empty())
+        {
+            Result result;
+            result.slot = slot;
+            result.generation = s.generation;
+            rasterize(mFace, codePoint, result);
+            upload(result);
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mJobs.push_back(Job{ codePoint, slot, s.generation });
+            }
+            mWakeWorkers.notify_one();
+        }
+        return &s.glyph;
+    }
+
+    // uploads every glyph the workers finished since the last call; call once per frame
+    void Update()
+    {
+        std::vector<Result> finished;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            finished.swap(mResults);
+        }
+        for (Result &result : finished)
+            upload(result);
+    }
+
+    // glyphs returned by Get after this call may evict the ones returned before it;
+    // call it once the quads using them have been drawn
+    void EndBatch() { ++mBatch; }
+
+    unsigned int PageTexture(unsigned int page) const { return mPages[page]; }
+    unsigned int PageCount() const { return (unsigned int)mPages.size(); }
+    unsigned int SlotCapacity() const { return mSlotsPerPage * mMaxPages; }
+    unsigned int CachedCount() const { return (unsigned int)mLookup.size(); }
+    unsigned int PixelSize() const { return mPixelSize; }
+    // advance (1/64 pixels) to use for a glyph that isn't ready yet, so the rest of the line doesn't shift
+    unsigned int PlaceholderAdvance() const { return mPlaceholderAdvance; }
+
+private:
+    static const unsigned int NONE = 0xFFFFFFFFu;
+
+    struct Slot
+    {
+        char32_t     codePoint;
+        unsigned int generation; // bumped on every reuse, so late worker results for an evicted glyph are ignored
+        unsigned int batch;      // last batch the glyph was used in
+        unsigned int prev, next; // LRU list, most recently used first
+        CachedGlyph  glyph;
+    };
+    struct Job
+    {
+        char32_t     codePoint;
+        unsigned int slot, generation;
+    };
+    struct Result
+    {
+        unsigned int slot, generation;
+        glm::ivec2   size, bearing;
+        unsigned int advance;
+        std::vector<unsigned char> pixels;
+        bool         failed = false; // the worker couldn't open the font; the glyph is left blank
+    };
+
+    std::string mFont;
+    unsigned int mPixelSize, mPageSize, mSlotSize, mSlotsPerPage, mMaxPages, mPlaceholderAdvance;
+    std::vector<unsigned int> mPages;
+    std::vector<Slot> mSlots;
+    std::unordered_map<char32_t, unsigned int> mLookup;
+    unsigned int mLruHead, mLruTail;
+    unsigned int mBatch;
+    FT_Library mLibrary;
+    FT_Face mFace;
+    // worker state
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWakeWorkers;
+    std::deque<Job> mJobs;
+    std::vector<Result> mResults;
+    bool mStop;
+
+    void unlink(unsigned int slot)
+    {
+        Slot &s = mSlots[slot];
+        if (s.prev != NONE) mSlots[s.prev].next = s.next; else mLruHead = s.next;
+        if (s.next != NONE) mSlots[s.next].prev = s.prev; else mLruTail = s.prev;
+        s.prev = s.next = NONE;
+    }
+
+    void touch(unsigned int slot)
+    {
+        Slot &s = mSlots[slot];
+        s.batch = mBatch;
+        if (mLruHead == slot)
+            return;
+        if (s.prev != NONE || s.next != NONE || mLruTail == slot)
+            unlink(slot);
+        s.next = mLruHead;
+        if (mLruHead != NONE)
+            mSlots[mLruHead].prev = slot;
+        mLruHead = slot;
+        if (mLruTail == NONE)
+            mLruTail = slot;
+    }
+
+    unsigned int allocateSlot()
+    {
+        // a free slot in the allocated pages, or a new page while under the limit
+        if (mSlots.size() == mPages.size() * mSlotsPerPage && mPages.size() < mMaxPages)
+            addPage();
+        if (mSlots.size() < mPages.size() * mSlotsPerPage)
+        {
+            unsigned int index = (unsigned int)mSlots.size();
+            Slot slot;
+            slot.codePoint = 0;
+            slot.generation = 0;
+            slot.batch = 0;
+            slot.prev = slot.next = NONE;
+            unsigned int page = index / mSlotsPerPage, cell = index % mSlotsPerPage, perRow = mPageSize / mSlotSize;
+            glm::vec2 origin = glm::vec2((cell % perRow) * mSlotSize + 1, (cell / perRow) * mSlotSize + 1);
+            slot.glyph.Page = page;
+            slot.glyph.UVRect = glm::vec4(origin / (float)mPageSize, 0.0f, 0.0f);
+            mSlots.push_back(slot);
+            return index;
+        }
+        // full: evict the least recently used glyph, unless the current batch still needs it
+        unsigned int victim = mLruTail;
+        if (victim == NONE || mSlots[victim].batch == mBatch)
+            return NONE;
+        ++Stats.evictions;
+        mLookup.erase(mSlots[victim].codePoint);
+        return victim;
+    }
+
+    void addPage()
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, mPageSize, mPageSize, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        mPages.push_back(texture);
+    }
+
+    void rasterize(FT_Face face, char32_t codePoint, Result &result) const
+    {
+        result.size = result.bearing = glm::ivec2(0);
+        result.advance = 0;
+        result.pixels.clear();
+        if (FT_Load_Char(face, codePoint, FT_LOAD_RENDER))
+            return;
+        FT_Bitmap &bitmap = face->glyph->bitmap;
+        // clip to the slot (only happens for glyphs larger than the face's advertised metrics)
+        unsigned int width = std::min(bitmap.width, mSlotSize - 2), rows = std::min(bitmap.rows, mSlotSize - 2);
+        result.size = glm::ivec2(width, rows);
+        result.bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+        result.advance = (unsigned int)face->glyph->advance.x;
+        result.pixels.resize(width * rows);
+        for (unsigned int row = 0; row < rows; ++row)
+            std::copy(bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + width, result.pixels.begin() + row * width);
+    }
+
+    void upload(Result &result)
+    {
+        Slot &s = mSlots[result.slot];
+        if (s.generation != result.generation)
+            return; // evicted (and reused) while it was being rasterized
+        CachedGlyph &glyph = s.glyph;
+        glyph.Size = result.size;
+        glyph.Bearing = result.bearing;
+        glyph.Advance = result.advance;
+        glyph.UVRect.z = result.size.x / (float)mPageSize;
+        glyph.UVRect.w = result.size.y / (float)mPageSize;
+        glyph.Ready = true;
+        if (result.failed)
+            ++Stats.failed;
+        // the whole slot, padding included, so a reused slot keeps none of the previous glyph's texels
+        // (bilinear filtering at the glyph's edges reads one texel past them)
+        std::vector<unsigned char> pixels(mSlotSize * mSlotSize, 0);
+        for (int row = 0; row < result.size.y; ++row)
+            std::copy(result.pixels.begin() + row * result.size.x, result.pixels.begin() + (row + 1) * result.size.x, pixels.begin() + (row + 1) * mSlotSize + 1);
+        glm::ivec2 texel = glm::ivec2(glm::vec2(glyph.UVRect.x, glyph.UVRect.y) * (float)mPageSize + 0.5f) - 1;
+        glBindTexture(GL_TEXTURE_2D, mPages[glyph.Page]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, texel.x, texel.y, mSlotSize, mSlotSize, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        ++Stats.uploads;
+    }
+
+    void workerLoop()
+    {
+        FT_Library library = nullptr;
+        FT_Face face = nullptr;
+        // without a face the worker keeps taking jobs and reports them as failed, so Get's callers
+        // don't wait forever for glyphs that would never be rasterized
+        bool loaded = !FT_Init_FreeType(&library) && !FT_New_Face(library, mFont.c_str(), 0, &face);
+        if (!loaded)
+            std::cout << "ERROR::FREETYPE: Glyph cache worker failed to load font" << std::endl;
+        else
+            FT_Set_Pixel_Sizes(face, 0, mPixelSize);
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWakeWorkers.wait(lock, [this] { return mStop || !mJobs.empty(); });
+                if (mStop)
+                    break;
+                job = mJobs.front();
+                mJobs.pop_front();
+            }
+            Result result;
+            result.slot = job.slot;
+            result.generation = job.generation;
+            if (loaded)
+                rasterize(face, job.codePoint, result);
+            else
+            {
+                result.size = result.bearing = glm::ivec2(0);
+                result.advance = 0;
+                result.failed = true;
+            }
+            std::lock_guard<std::mutex> lock(mMutex);
+            mResults.push_back(std::move(result));
+        }
+        if (face)
+            FT_Done_Face(face);
+        if (library)
+            FT_Done_FreeType(library);
+    }
+};
+
+#endif
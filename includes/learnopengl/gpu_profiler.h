@@ -0,0 +1,358 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Hierarchical GPU + CPU timings of named passes, without stalling the pipeline.
+//
+//   profiler.BeginFrame();
+//   profiler.Begin("shadows");  ...  profiler.End();
+//   { GpuProfiler::Scope scope(profiler, "gbuffer"); ... }
+//   profiler.EndFrame();
+//   std::cout << profiler.Report();
+//
+// Every Begin/End issues a GL_TIMESTAMP query (glQueryCounter, core since 3.3) rather than
+// GL_TIME_ELAPSED, because elapsed-time queries can't be nested. The queries of a frame are read
+// LATENCY frames later, when the GPU has long finished them; a frame whose results still aren't
+// available by then is dropped rather than waited for. Implementations without a timestamp
+// counter (GL_QUERY_COUNTER_BITS 0) only get CPU times. Scopes also become debug groups on GL 4.3,
+// so they show up in RenderDoc & co.
+//
+// With KeepHistory every resolved frame is kept for WriteCSV / WriteChromeTrace (chrome://tracing,
+// Perfetto); CPU scopes are on thread 1, GPU scopes on thread 2. Call Flush before writing them,
+// so the last LATENCY frames are resolved as well.
+
+class GpuProfiler
+{
+public:
+    static const unsigned int LATENCY = 3;
+
+    struct Result
+    {
+        std::string name;
+        std::string path; // the enclosing scopes' names and this one, e.g. "frame/bloom/blur"
+        int depth;
+        double gpuStart, gpuMs; // ms, relative to the frame's GPU start (-1 without GPU timing)
+        double cpuStart, cpuMs; // ms, relative to the frame's CPU start
+    };
+
+    struct Frame
+    {
+        unsigned long long index = 0;
+        double cpuStart = 0.0; // ms since the profiler was created
+        std::vector<Result> results;
+    };
+
+    bool KeepHistory = false;
+    // frames whose queries weren't available when their slot was needed again
+    unsigned int Dropped = 0;
+
+    GpuProfiler() : epoch(std::chrono::steady_clock::now()) {}
+
+    // deletes the queries; call while the context is still current
+    void Destroy()
+    {
+        for (FrameSlot& slot : slots)
+        {
+            if (!slot.queries.empty())
+                glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+            slot.queries.clear();
+            slot.usedQueries = 0;
+            slot.pending = false;
+        }
+    }
+
+    // resolves every frame still in flight, waiting for its queries; for the end of a capture
+    void Flush()
+    {
+        if (!open.empty())
+            EndFrame();
+        // oldest first, so History stays in frame order
+        for (unsigned long long frame = frameIndex > LATENCY ? frameIndex - LATENCY : 0; frame < frameIndex; ++frame)
+        {
+            FrameSlot& slot = slots[frame % LATENCY];
+            if (slot.pending && slot.frame == frame)
+                resolve(slot, true);
+        }
+    }
+
+    // the whole frame is the root scope "frame"; the other scopes nest inside it
+    void BeginFrame()
+    {
+        if (!initialized)
+            init();
+        FrameSlot& slot = slots[frameIndex % LATENCY];
+        if (slot.pending)
+            resolve(slot);
+        slot.scopes.clear();
+        slot.usedQueries = 0;
+        slot.frame = frameIndex;
+        slot.cpuStart = now();
+        slot.pending = true;
+        open.clear();
+        Begin("frame");
+    }
+
+    void EndFrame()
+    {
+        while (!open.empty())
+            End();
+        ++frameIndex;
+    }
+
+    void Begin(const std::string& name)
+    {
+        FrameSlot& slot = current();
+        ScopeRecord scope;
+        scope.name = name;
+        scope.path = open.empty() ? name : slot.scopes[open.back()].path + "/" + name;
+        scope.depth = (int)open.size();
+        scope.cpuStart = now();
+        scope.startQuery = timestamp(slot);
+        open.push_back(slot.scopes.size());
+        slot.scopes.push_back(scope);
+        if (GLAD_GL_VERSION_4_3)
+            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str());
+    }
+
+    void End()
+    {
+        if (open.empty())
+            return;
+        FrameSlot& slot = current();
+        ScopeRecord& scope = slot.scopes[open.back()];
+        open.pop_back();
+        if (GLAD_GL_VERSION_4_3)
+            glPopDebugGroup();
+        scope.endQuery = timestamp(slot);
+        scope.cpuEnd = now();
+    }
+
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler& profiler, const std::string& name) : profiler(profiler) { profiler.Begin(name); }
+        ~Scope() { profiler.End(); }
+    private:
+        GpuProfiler& profiler;
+    };
+
+    bool GpuTiming() const { return gpuTiming; }
+    // the most recently resolved frame (LATENCY frames old)
+    const Frame& Last() const { return last; }
+    const std::vector<Frame>& History() const { return history; }
+
+    // one line per scope of the last resolved frame, indented by depth, times averaged over recent frames
+    std::string Report() const
+    {
+        std::ostringstream report;
+        char line[160];
+        for (const Result& result : last.results)
+        {
+            auto average = averages.find(key(result));
+            double gpu = average != averages.end() ? average->second.gpu : result.gpuMs;
+            double cpu = average != averages.end() ? average->second.cpu : result.cpuMs;
+            std::string name = std::string(result.depth * 2, ' ') + result.name;
+            if (gpuTiming)
+                snprintf(line, sizeof(line), "%-20s %6.2f ms gpu %6.2f ms cpu\n", name.c_str(), gpu, cpu);
+            else
+                snprintf(line, sizeof(line), "%-20s %6.2f ms cpu\n", name.c_str(), cpu);
+            report << line;
+        }
+        return report.str();
+    }
+
+    // frame,scope,depth,gpu_ms,cpu_ms (gpu_ms is -1 without GPU timing); scope is the quoted path, e.g. "frame/bloom/blur"
+    bool WriteCSV(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << "frame,scope,depth,gpu_ms,cpu_ms\n";
+        for (const Frame& frame : history)
+            for (const Result& result : frame.results)
+                file << frame.index << "," << quote(result.path) << "," << result.depth << "," << result.gpuMs << "," << result.cpuMs << "\n";
+        return (bool)file;
+    }
+
+    // Chrome trace event format; GPU scopes are drawn relative to the CPU start of their frame
+    bool WriteChromeTrace(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto event = [&](const std::string& name, int thread, double startMs, double durationMs)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"" << escape(name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+                 << ",\"ts\":" << (long long)(startMs * 1000.0) << ",\"dur\":" << (long long)(durationMs * 1000.0) << "}";
+            first = false;
+        };
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+        first = false;
+        for (const Frame& frame : history)
+            for (const Result& result : frame.results)
+            {
+                event(result.name, 1, frame.cpuStart + result.cpuStart, result.cpuMs);
+                if (result.gpuMs >= 0.0)
+                    event(result.name, 2, frame.cpuStart + result.gpuStart, result.gpuMs);
+            }
+        file << "\n]}\n";
+        return (bool)file;
+    }
+
+private:
+    struct ScopeRecord
+    {
+        std::string name;
+        std::string path;
+        int depth = 0;
+        int startQuery = -1, endQuery = -1;
+        double cpuStart = 0.0, cpuEnd = 0.0;
+    };
+    struct FrameSlot
+    {
+        std::vector<ScopeRecord> scopes;
+        std::vector<GLuint> queries; // grows to the largest number of scopes seen, never shrinks
+        unsigned int usedQueries = 0;
+        unsigned long long frame = 0;
+        double cpuStart = 0.0;
+        bool pending = false;
+    };
+    struct Average
+    {
+        double gpu, cpu;
+    };
+
+    std::chrono::steady_clock::time_point epoch;
+    FrameSlot slots[LATENCY];
+    std::vector<size_t> open;
+    unsigned long long frameIndex = 0;
+    bool initialized = false, gpuTiming = false;
+    Frame last;
+    std::vector<Frame> history;
+    std::map<std::string, Average> averages;
+
+    void init()
+    {
+        initialized = true;
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        gpuTiming = bits > 0;
+    }
+
+    double now() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    FrameSlot& current() { return slots[frameIndex % LATENCY]; }
+
+    int timestamp(FrameSlot& slot)
+    {
+        if (!gpuTiming)
+            return -1;
+        if (slot.usedQueries == slot.queries.size())
+        {
+            slot.queries.push_back(0);
+            glGenQueries(1, &slot.queries.back());
+        }
+        glQueryCounter(slot.queries[slot.usedQueries], GL_TIMESTAMP);
+        return (int)slot.usedQueries++;
+    }
+
+    // scopes are told apart by their parents as well, so "blur" under "ssao" and under "bloom" average separately
+    static const std::string& key(const Result& result) { return result.path; }
+
+    // CSV field: in double quotes, with quotes doubled
+    static std::string quote(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"')
+                quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    static std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    // wait: block on the queries instead of dropping the frame if they aren't available yet
+    void resolve(FrameSlot& slot, bool wait = false)
+    {
+        slot.pending = false;
+        std::vector<GLuint64> times(slot.usedQueries, 0);
+        if (slot.usedQueries > 0)
+        {
+            // timestamps complete in submission order: if the last one is done, all of them are
+            GLint available = wait ? 1 : 0;
+            if (!wait)
+                glGetQueryObjectiv(slot.queries[slot.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                ++Dropped;
+                return;
+            }
+            for (unsigned int i = 0; i < slot.usedQueries; ++i)
+                glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &times[i]);
+        }
+
+        Frame frame;
+        frame.index = slot.frame;
+        frame.cpuStart = slot.cpuStart;
+        GLuint64 gpuFrameStart = !times.empty() ? times[0] : 0;
+        for (const ScopeRecord& scope : slot.scopes)
+        {
+            Result result;
+            result.name = scope.name;
+            result.path = scope.path;
+            result.depth = scope.depth;
+            result.cpuStart = scope.cpuStart - slot.cpuStart;
+            result.cpuMs = scope.cpuEnd - scope.cpuStart;
+            result.gpuStart = result.gpuMs = -1.0;
+            if (scope.startQuery >= 0 && scope.endQuery >= 0)
+            {
+                result.gpuStart = (double)(times[scope.startQuery] - gpuFrameStart) / 1.0e6;
+                result.gpuMs = (double)(times[scope.endQuery] - times[scope.startQuery]) / 1.0e6;
+            }
+            // exponential moving average over roughly the last 20 frames
+            auto average = averages.find(key(result));
+            if (average == averages.end())
+                averages[key(result)] = { result.gpuMs, result.cpuMs };
+            else
+            {
+                average->second.gpu += (result.gpuMs - average->second.gpu) * 0.1;
+                average->second.cpu += (result.cpuMs - average->second.cpu) * 0.1;
+            }
+            frame.results.push_back(result);
+        }
+        last = frame;
+        if (KeepHistory)
+            history.push_back(frame);
+    }
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/gl_resources.h>
+#include <learnopengl/gl_state.h>
 #include <learnopengl/shader.h>
 
 #include <string>
@@ -63,6 +65,24 @@ public:
 
     // render the mesh
     void Draw(Shader &shader) 
+    {
+        BindMaterial(shader);
+
+        // draw mesh
+        GLState::BindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+
+        // always good practice to set everything back to defaults once configured,
+        // unless the app filters GL state (then everything goes through GLState and the resets are pure overhead)
+        if (!GLState::Filter)
+        {
+            GLState::BindVertexArray(0);
+            GLState::ActiveTexture(GL_TEXTURE0);
+        }
+    }
+
+    // binds the textures and sets the material uniforms, everything Draw does except the draw itself
+    void BindMaterial(Shader &shader)
     {
         //
         // shader开发者也可以自由选择需要使用的数量，他只需要定义正确的采样器就可以了
@@ -78,7 +98,7 @@ public:
         
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding 纹理单元从 GL_TEXTURE0 开始, 对应uniform从0开始
+            // texture unit i is activated by GLState::BindTexture below 纹理单元从 GL_TEXTURE0 开始, 对应uniform从0开始
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -107,7 +127,7 @@ public:
             glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
             
             // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            GLState::BindTexture(GL_TEXTURE0 + i, GL_TEXTURE_2D, textures[i].id);
         }
         
    
@@ -115,73 +135,71 @@ public:
         glUniform3f(glGetUniformLocation(shader.ID, "Kd"),  kd.x, kd.y, kd.z );
         glUniform3f(glGetUniformLocation(shader.ID, "Ks"),  ks.x, ks.y, ks.z );
         glUniform1f(glGetUniformLocation(shader.ID, "shininess"), shininess);
-        
-        
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    }
+
+    // true if both meshes bind the same textures and material values (they can share one multi-draw)
+    bool SameMaterial(const Mesh &other) const
+    {
+        if (ka != other.ka || kd != other.kd || ks != other.ks || shininess != other.shininess || textures.size() != other.textures.size())
+            return false;
+        for (unsigned int i = 0; i < textures.size(); i++)
+            if (textures[i].id != other.textures[i].id || textures[i].type != other.textures[i].type)
+                return false;
+        return true;
+    }
+
+    // the Vertex attributes on binding point 0, shared by every mesh VAO and the MeshPool VAO
+    static void DescribeVertex(GLVertexLayout &layout)
+    {
+        // vertex Positions
+        layout.Attribute(0, 0, 3, GL_FLOAT, 0);
+        // vertex normals
+        layout.Attribute(1, 0, 3, GL_FLOAT, offsetof(Vertex, Normal)); // offsetof 结构体成员的偏移
+        // vertex texture coords
+        layout.Attribute(2, 0, 2, GL_FLOAT, offsetof(Vertex, TexCoords));
+        // vertex tangent
+        layout.Attribute(3, 0, 3, GL_FLOAT, offsetof(Vertex, Tangent));
+        // vertex bitangent
+        layout.Attribute(4, 0, 3, GL_FLOAT, offsetof(Vertex, Bitangent));
+		// ids
+		layout.Attribute(5, 0, 4, GL_INT, offsetof(Vertex, m_BoneIDs), false, true);           // ??? 骨骼id ???
+		// weights
+		layout.Attribute(6, 0, 4, GL_FLOAT, offsetof(Vertex, m_Weights));                      // ??? 骨骼权重 ???
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // frees the mesh's own buffers and VAO once its data lives in a MeshPool (VAO becomes 0)
+    void ReleaseBuffers()
+    {
+        layout.Destroy();
+        vertexBuffer.Destroy();
+        indexBuffer.Destroy();
+        VAO = 0;
     }
 
 private:
     // render data 
-    unsigned int VBO, EBO;
+    GLBuffer vertexBuffer, indexBuffer;
+    GLVertexLayout layout;
 
     // initializes all the buffer objects/arrays
+    // (immutable storage filled at creation; with DSA nothing is bound, so loading doesn't disturb the draw state)
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        
         // C++结构体有一个很棒的特性，它们的内存布局是连续的(Sequential)。 ??? 应该是有对齐 ???
         // structs 的一大优点是它们的内存布局对于它的所有项目都是连续的。
         // 效果是我们可以简单地传递一个指向结构的指针，它完美地转换为 glm::vec3/2 数组，该数组再次转换为 3/2 浮点数，后者转换为字节数组。
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); // 指定了索引buffer 这样glDrawElements不用传buffer参数,而是根据VAO中 GL_ELEMENT_ARRAY_BUFFER 绑定的ebo
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal)); // offsetof 结构体成员的偏移
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords)); // sizeof 每个顶点的对齐
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-        
-        
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));           // ??? 骨骼id ???
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights)); // ??? 骨骼权重 ???
-        
-        
-        glBindVertexArray(0);
+        vertexBuffer.Create(vertices.size() * sizeof(Vertex), &vertices[0]);
+        indexBuffer.Create(indices.size() * sizeof(unsigned int), &indices[0]);
+
+        // every attribute reads from binding point 0, the vertex buffer
+        layout.Create();
+        DescribeVertex(layout);
+        layout.VertexBuffer(0, vertexBuffer, 0, sizeof(Vertex)); // sizeof 每个顶点的对齐
+        layout.IndexBuffer(indexBuffer); // 指定了索引buffer 这样glDrawElements不用传buffer参数,而是根据VAO中 GL_ELEMENT_ARRAY_BUFFER 绑定的ebo
+        VAO = layout.ID;
     }
 };
 #endif
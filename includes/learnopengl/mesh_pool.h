@@ -0,0 +1,230 @@
+#ifndef MESH_POOL_H
+#define MESH_POOL_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_resources.h>
+#include <learnopengl/gl_state.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// Shared vertex/index storage for many meshes: one vertex buffer, one index buffer and one VAO,
+// so switching between meshes is a change of offsets instead of a change of vertex state.
+//
+// A mesh gets a range of each buffer; its indices stay relative to its own vertices and are drawn
+// with baseVertex = first vertex of the range and firstIndex = first index of the range
+// (glDrawElementsBaseVertex, glMultiDrawElementsBaseVertex or an indirect command).
+// Free space is tracked by a first-fit free list (RangeAllocator, no OpenGL involved); when a mesh
+// doesn't fit, the buffers are replaced by ones twice as large and the old contents are copied over on the GPU.
+//
+// Templated on the vertex type; the layout callback declares its attributes on binding point 0:
+//   MeshPool<Vertex> pool(describeVertex);
+//   pool.Create(1 << 20, 3 << 20);
+
+// first-fit free list over [0, Capacity), neighbouring free blocks are merged
+class RangeAllocator
+{
+public:
+    static const unsigned int INVALID = 0xFFFFFFFFu;
+
+    explicit RangeAllocator(unsigned int capacity = 0) { Reset(capacity); }
+
+    void Reset(unsigned int capacity)
+    {
+        free.clear();
+        capacityValue = capacity;
+        used = 0;
+        if (capacity > 0)
+            free[0] = capacity;
+    }
+
+    // offset of the block, or INVALID when no free block is large enough
+    unsigned int Allocate(unsigned int size)
+    {
+        if (size == 0)
+            return 0;
+        for (auto block = free.begin(); block != free.end(); ++block)
+        {
+            if (block->second < size)
+                continue;
+            unsigned int offset = block->first, remaining = block->second - size;
+            free.erase(block);
+            if (remaining > 0)
+                free[offset + size] = remaining;
+            used += size;
+            return offset;
+        }
+        return INVALID;
+    }
+
+    void Free(unsigned int offset, unsigned int size)
+    {
+        if (size == 0 || offset == INVALID)
+            return;
+        used -= size;
+        auto next = free.lower_bound(offset);
+        // merge with the block right after
+        if (next != free.end() && offset + size == next->first)
+        {
+            size += next->second;
+            next = free.erase(next);
+        }
+        // merge with the block right before
+        if (next != free.begin())
+        {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset)
+            {
+                previous->second += size;
+                return;
+            }
+        }
+        free[offset] = size;
+    }
+
+    // adds [Capacity, capacity) to the free space
+    void Grow(unsigned int capacity)
+    {
+        if (capacity <= capacityValue)
+            return;
+        unsigned int added = capacity - capacityValue;
+        unsigned int offset = capacityValue;
+        capacityValue = capacity;
+        used += added; // Free subtracts it again
+        Free(offset, added);
+    }
+
+    unsigned int Capacity() const { return capacityValue; }
+    unsigned int Used() const { return used; }
+    unsigned int FreeBlocks() const { return (unsigned int)free.size(); }
+    unsigned int LargestFree() const
+    {
+        unsigned int largest = 0;
+        for (const auto& block : free)
+            largest = std::max(largest, block.second);
+        return largest;
+    }
+
+private:
+    std::map<unsigned int, unsigned int> free; // offset -> size
+    unsigned int capacityValue = 0, used = 0;
+};
+
+// GL layout of an indirect draw (glDrawElementsIndirect / glMultiDrawElementsIndirect)
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int          baseVertex;
+    unsigned int baseInstance;
+};
+
+template <typename VertexType>
+class MeshPool
+{
+public:
+    typedef void (*LayoutCallback)(GLVertexLayout& layout);
+
+    struct Range
+    {
+        unsigned int baseVertex = RangeAllocator::INVALID, vertexCount = 0;
+        unsigned int firstIndex = RangeAllocator::INVALID, indexCount = 0;
+    };
+
+    explicit MeshPool(LayoutCallback describe) : describe(describe) {}
+
+    void Create(unsigned int vertexCapacity, unsigned int indexCapacity)
+    {
+        vertexSpace.Reset(vertexCapacity);
+        indexSpace.Reset(indexCapacity);
+        vertexBuffer.Create((GLsizeiptr)vertexCapacity * sizeof(VertexType), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        indexBuffer.Create((GLsizeiptr)indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        layout.Create();
+        describe(layout);
+        layout.VertexBuffer(0, vertexBuffer, 0, sizeof(VertexType));
+        layout.IndexBuffer(indexBuffer);
+    }
+
+    Range Add(const std::vector<VertexType>& vertices, const std::vector<unsigned int>& indices)
+    {
+        Range range;
+        range.vertexCount = (unsigned int)vertices.size();
+        range.indexCount = (unsigned int)indices.size();
+        range.baseVertex = vertexSpace.Allocate(range.vertexCount);
+        if (range.baseVertex == RangeAllocator::INVALID)
+        {
+            growVertices(range.vertexCount);
+            range.baseVertex = vertexSpace.Allocate(range.vertexCount);
+        }
+        range.firstIndex = indexSpace.Allocate(range.indexCount);
+        if (range.firstIndex == RangeAllocator::INVALID)
+        {
+            growIndices(range.indexCount);
+            range.firstIndex = indexSpace.Allocate(range.indexCount);
+        }
+        if (range.vertexCount > 0)
+            vertexBuffer.Update((GLintptr)range.baseVertex * sizeof(VertexType), (GLsizeiptr)range.vertexCount * sizeof(VertexType), vertices.data());
+        if (range.indexCount > 0)
+            indexBuffer.Update((GLintptr)range.firstIndex * sizeof(unsigned int), (GLsizeiptr)range.indexCount * sizeof(unsigned int), indices.data());
+        return range;
+    }
+
+    void Remove(const Range& range)
+    {
+        vertexSpace.Free(range.baseVertex, range.vertexCount);
+        indexSpace.Free(range.firstIndex, range.indexCount);
+    }
+
+    static DrawElementsIndirectCommand Command(const Range& range, unsigned int instanceCount = 1)
+    {
+        return { range.indexCount, instanceCount, range.firstIndex, (int)range.baseVertex, 0 };
+    }
+
+    // the shared VAO; its buffers change when the pool grows, the VAO itself never does
+    unsigned int VAO() const { return layout.ID; }
+    const RangeAllocator& Vertices() const { return vertexSpace; }
+    const RangeAllocator& Indices() const { return indexSpace; }
+
+    void Destroy()
+    {
+        layout.Destroy();
+        vertexBuffer.Destroy();
+        indexBuffer.Destroy();
+    }
+
+private:
+    LayoutCallback describe;
+    GLBuffer vertexBuffer, indexBuffer;
+    GLVertexLayout layout;
+    RangeAllocator vertexSpace, indexSpace;
+
+    static void grow(GLBuffer& buffer, RangeAllocator& space, unsigned int needed, size_t elementSize)
+    {
+        unsigned int capacity = std::max(space.Capacity() * 2, space.Capacity() + needed);
+        GLBuffer larger;
+        larger.Create((GLsizeiptr)capacity * elementSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        if (space.Capacity() > 0)
+            larger.CopyFrom(buffer, 0, 0, (GLsizeiptr)space.Capacity() * elementSize);
+        buffer.Destroy();
+        buffer = larger;
+        space.Grow(capacity);
+    }
+
+    void growVertices(unsigned int needed)
+    {
+        grow(vertexBuffer, vertexSpace, needed, sizeof(VertexType));
+        layout.VertexBuffer(0, vertexBuffer, 0, sizeof(VertexType));
+    }
+
+    void growIndices(unsigned int needed)
+    {
+        grow(indexBuffer, indexSpace, needed, sizeof(unsigned int));
+        layout.IndexBuffer(indexBuffer);
+    }
+};
+
+#endif
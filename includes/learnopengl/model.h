@@ -12,6 +12,7 @@
 #include <assimp/postprocess.h>  // assimp 模型导入后处理
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_pool.h>
 #include <learnopengl/shader.h>
 
 #include <string>
@@ -44,11 +45,95 @@ public:
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        if (pool)
+        {
+            drawPooled(shader);
+            return;
+        }
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // moves the vertices and indices of every mesh into the shared pool (freeing the meshes' own buffers);
+    // Draw then binds the pool's VAO once and issues one multi-draw per distinct material,
+    // indirect on GL 4.3 (glMultiDrawElementsIndirect), glMultiDrawElementsBaseVertex before that
+    void UsePool(MeshPool<Vertex> &meshPool)
+    {
+        pool = &meshPool;
+        // group the meshes by material, each group becomes one multi-draw
+        vector<vector<DrawElementsIndirectCommand>> groupCommands;
+        drawGroups.clear();
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            MeshPool<Vertex>::Range range = pool->Add(meshes[i].vertices, meshes[i].indices);
+            meshes[i].ReleaseBuffers();
+            unsigned int group = 0;
+            while (group < drawGroups.size() && !meshes[drawGroups[group].mesh].SameMaterial(meshes[i]))
+                group++;
+            if (group == drawGroups.size())
+            {
+                drawGroups.push_back(DrawGroup());
+                drawGroups.back().mesh = i;
+                groupCommands.push_back(vector<DrawElementsIndirectCommand>());
+            }
+            DrawGroup &drawGroup = drawGroups[group];
+            drawGroup.counts.push_back((GLsizei)range.indexCount);
+            drawGroup.offsets.push_back((const void*)((size_t)range.firstIndex * sizeof(unsigned int)));
+            drawGroup.baseVertices.push_back((GLint)range.baseVertex);
+            groupCommands[group].push_back(MeshPool<Vertex>::Command(range));
+        }
+        // the commands of a group are contiguous in the indirect buffer
+        vector<DrawElementsIndirectCommand> commands;
+        for (unsigned int group = 0; group < drawGroups.size(); group++)
+        {
+            drawGroups[group].firstCommand = (unsigned int)commands.size();
+            commands.insert(commands.end(), groupCommands[group].begin(), groupCommands[group].end());
+        }
+        if (GLAD_GL_VERSION_4_3 && !commands.empty())
+            indirectCommands.Create(commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+    }
+
+    // draw calls per Draw: one per mesh, or one per material group once the model uses a pool
+    unsigned int DrawCalls() const { return pool ? (unsigned int)drawGroups.size() : (unsigned int)meshes.size(); }
     
 private:
+    // meshes sharing a material, drawn with a single multi-draw from the pool
+    struct DrawGroup
+    {
+        unsigned int mesh = 0;         // the mesh whose material is bound
+        unsigned int firstCommand = 0; // in indirectCommands
+        vector<GLsizei> counts;
+        vector<const void*> offsets;
+        vector<GLint> baseVertices;
+    };
+    MeshPool<Vertex> *pool = nullptr;
+    vector<DrawGroup> drawGroups;
+    GLBuffer indirectCommands;
+
+    void drawPooled(Shader &shader)
+    {
+        GLState::BindVertexArray(pool->VAO());
+        bool indirect = indirectCommands.ID != 0;
+        if (indirect)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectCommands.ID);
+        for (const DrawGroup &group : drawGroups)
+        {
+            meshes[group.mesh].BindMaterial(shader);
+            GLsizei drawCount = (GLsizei)group.counts.size();
+            if (indirect)
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(group.firstCommand * sizeof(DrawElementsIndirectCommand)), drawCount, 0);
+            else
+                glMultiDrawElementsBaseVertex(GL_TRIANGLES, group.counts.data(), GL_UNSIGNED_INT, group.offsets.data(), drawCount, group.baseVertices.data());
+        }
+        if (indirect)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        if (!GLState::Filter)
+        {
+            GLState::BindVertexArray(0);
+            GLState::ActiveTexture(GL_TEXTURE0);
+        }
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
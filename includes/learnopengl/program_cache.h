@@ -0,0 +1,176 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Program binary cache for the shader classes (shader.h, shader_m.h, shader_t.h, shader_c.h).
+//
+// After a program is linked from source its driver binary is saved with glGetProgramBinary;
+// the next launch hands it back with glProgramBinary and skips compiling and linking.
+// The cache key hashes every (define-injected) stage source together with the GL vendor,
+// renderer and version strings, so editing a shader or updating the driver misses the cache.
+// A driver may still reject a binary (e.g. after a silent driver change); the file is then
+// deleted and the caller compiles from source as usual.
+//
+// Needs GL 4.1 (or ARB_get_program_binary) and at least one binary format; without them every
+// call is a no-op and the shaders behave exactly as before.
+
+struct ProgramCacheStats
+{
+    unsigned int hits = 0, misses = 0, rejected = 0, stored = 0;
+};
+
+class ProgramCache
+{
+public:
+    static inline bool Enabled = true;
+    static inline std::string Directory = "shader_cache";
+    static inline ProgramCacheStats Stats;
+
+    static bool Supported()
+    {
+        if (!Enabled || glad_glProgramBinary == nullptr || glad_glGetProgramBinary == nullptr || glad_glProgramParameteri == nullptr)
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // hex hash of the stage sources and the driver identification; stages that aren't used pass an empty string
+    static std::string Key(std::initializer_list<const std::string*> sources)
+    {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        auto mix = [&hash](const char* data, size_t length)
+        {
+            // length first, so moving text from one stage to the next changes the key
+            for (size_t i = 0; i < sizeof(length); ++i)
+                hash = (hash ^ ((length >> (i * 8)) & 0xFF)) * 1099511628211ull;
+            for (size_t i = 0; i < length; ++i)
+                hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+        };
+        for (const std::string* source : sources)
+            mix(source->data(), source->size());
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const char* value = reinterpret_cast<const char*>(glGetString(name));
+            std::string driver = value ? value : "";
+            mix(driver.data(), driver.size());
+        }
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+        return text;
+    }
+
+    // loads the cached binary into program; false if there is none or the driver rejected it
+    static bool Load(unsigned int program, const std::string& key)
+    {
+        if (!Supported())
+        {
+            ++Stats.misses;
+            return false;
+        }
+        std::ifstream file(path(key), std::ios::binary);
+        Header header;
+        if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != MAGIC || header.version != VERSION)
+        {
+            ++Stats.misses;
+            return false;
+        }
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+        {
+            ++Stats.misses;
+            return false;
+        }
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            ++Stats.rejected;
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(path(key), error);
+            return false;
+        }
+        ++Stats.hits;
+        return true;
+    }
+
+    // call before glLinkProgram, some drivers only keep a retrievable binary when asked to
+    static void PrepareLink(unsigned int program)
+    {
+        if (Supported())
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // saves the binary of a successfully linked program
+    static void Store(unsigned int program, const std::string& key)
+    {
+        if (!Supported())
+            return;
+        GLint success, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!success || length <= 0)
+            return;
+        Header header = { MAGIC, VERSION, 0, 0 };
+        std::vector<char> binary(length);
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &header.format, binary.data());
+        header.length = (unsigned int)written;
+
+        std::error_code error;
+        std::filesystem::create_directories(Directory, error);
+        // write next to the final file and rename, so a crash never leaves a truncated binary behind
+        std::string target = path(key), temporary = target + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), written);
+            if (!file)
+                return;
+        }
+        std::filesystem::rename(temporary, target, error);
+        if (error)
+            std::cout << "ERROR::PROGRAM_CACHE: could not write " << target << ": " << error.message() << std::endl;
+        else
+            ++Stats.stored;
+    }
+
+    // removes every cached binary (forces a cold start)
+    static void Clear()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(Directory, error);
+    }
+
+private:
+    static const unsigned int MAGIC = 0x47525050; // "PPRG"
+    static const unsigned int VERSION = 1;
+
+    struct Header
+    {
+        unsigned int magic, version;
+        GLenum       format;
+        unsigned int length;
+    };
+
+    static std::string path(const std::string& key)
+    {
+        return Directory + "/" + key + ".bin";
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <learnopengl/gl_state.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Collects draws during the frame, sorts them by a 64-bit key and only then issues them,
+// so the submission order of the objects doesn't decide the state changes.
+//
+// Key layout (most significant bits first):
+//     opaque:       pass:2 | program:12 | material:16 | depth:24 | unused:10
+//     transparent:  pass:2 | ~depth:24  | program:12  | material:16 | unused:10
+// Opaque draws are grouped by state and go front to back inside a group (cheap early-z rejects);
+// transparent draws go strictly back to front, state only breaks ties. The depth is the float bit
+// pattern of the distance to the camera, which orders like the float itself for values >= 0.
+//
+// The keys are sorted with an LSD radix sort (8 bits per pass, passes where every key has the
+// same byte are skipped), which is stable, so equal keys keep their submission order.
+//
+//   queue.Submit(RenderQueue::OPAQUE_PASS, draw, glm::length(camera.Position - position));
+//   queue.Sort();
+//   queue.Execute();
+//   queue.Clear();
+
+class RenderQueue
+{
+public:
+    enum Pass { OPAQUE_PASS = 0, TRANSPARENT_PASS = 1 };
+
+    struct Draw
+    {
+        unsigned int program = 0, vertexArray = 0;
+        unsigned int texture = 0;   // bound to unit 0 as GL_TEXTURE_2D, 0 leaves the unit alone
+        unsigned int material = 0;  // sort id, defaults to the texture
+        GLenum mode = GL_TRIANGLES;
+        GLint first = 0;
+        GLsizei count = 0;
+        bool indexed = false;       // glDrawElements with GL_UNSIGNED_INT indices starting at first
+        glm::mat4 model = glm::mat4(1.0f);
+    };
+
+    struct Stats
+    {
+        unsigned int draws = 0, programChanges = 0, vertexArrayChanges = 0, textureChanges = 0;
+    };
+
+    // uniform receiving Draw::model; the location is looked up once per program
+    std::string ModelUniform = "model";
+
+    void Submit(Pass pass, const Draw& draw, float depth)
+    {
+        unsigned int material = draw.material ? draw.material : draw.texture;
+        entries.push_back({ MakeKey(pass, draw.program, material, depth), (uint32_t)draws.size() });
+        draws.push_back(draw);
+    }
+
+    static uint64_t MakeKey(Pass pass, unsigned int program, unsigned int material, float depth)
+    {
+        uint64_t depthBits = quantizeDepth(depth);
+        uint64_t state = ((uint64_t)(program & 0xFFFu) << 16) | (material & 0xFFFFu);
+        uint64_t key = (uint64_t)pass << 62;
+        if (pass == TRANSPARENT_PASS)
+            key |= ((~depthBits & 0xFFFFFFu) << 38) | (state << 10);
+        else
+            key |= (state << 34) | (depthBits << 10);
+        return key;
+    }
+
+    void Sort() { RadixSort(entries, scratch); }
+
+    // issues the sorted draws: blending off and depth writes on for opaque draws,
+    // blending on and depth writes off for transparent ones (the blend function is left to the app)
+    void Execute()
+    {
+        stats = Stats();
+        int pass = -1;
+        unsigned int program = 0, vertexArray = 0, texture = 0;
+        GLint modelLocation = -1;
+        for (const Entry& entry : entries)
+        {
+            const Draw& draw = draws[entry.index];
+            int drawPass = (int)(entry.key >> 62);
+            if (drawPass != pass)
+            {
+                pass = drawPass;
+                if (pass == TRANSPARENT_PASS)
+                {
+                    GLState::Enable(GL_BLEND);
+                    GLState::DepthMask(false);
+                }
+                else
+                {
+                    GLState::Disable(GL_BLEND);
+                    GLState::DepthMask(true);
+                }
+            }
+            if (stats.draws == 0 || draw.program != program)
+            {
+                program = draw.program;
+                GLState::UseProgram(program);
+                modelLocation = uniformLocation(program);
+                ++stats.programChanges;
+            }
+            if (stats.draws == 0 || draw.vertexArray != vertexArray)
+            {
+                vertexArray = draw.vertexArray;
+                GLState::BindVertexArray(vertexArray);
+                ++stats.vertexArrayChanges;
+            }
+            if (draw.texture != 0 && (stats.draws == 0 || draw.texture != texture))
+            {
+                texture = draw.texture;
+                GLState::BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+                ++stats.textureChanges;
+            }
+            if (modelLocation >= 0)
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(draw.model));
+            if (draw.indexed)
+                glDrawElements(draw.mode, draw.count, GL_UNSIGNED_INT, (void*)(draw.first * sizeof(unsigned int)));
+            else
+                glDrawArrays(draw.mode, draw.first, draw.count);
+            ++stats.draws;
+        }
+        if (pass == TRANSPARENT_PASS)
+            GLState::DepthMask(true);
+    }
+
+    void Clear()
+    {
+        entries.clear();
+        draws.clear();
+    }
+
+    size_t Size() const { return draws.size(); }
+    // the submitted draw at sorted position i (valid after Sort)
+    const Draw& Sorted(size_t i) const { return draws[entries[i].index]; }
+    uint64_t SortedKey(size_t i) const { return entries[i].key; }
+    const Stats& LastStats() const { return stats; }
+
+    // key + index of the draw it belongs to; sorting these instead of the draws moves 16 bytes per element
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // stable LSD radix sort on Entry::key, scratch is resized as needed and can be kept between frames
+    static void RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch)
+    {
+        size_t count = entries.size();
+        if (count < 2)
+            return;
+        scratch.resize(count);
+
+        // histograms of all 8 bytes in one pass over the keys
+        uint32_t histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+        for (const Entry& entry : entries)
+            for (int byte = 0; byte < 8; ++byte)
+                ++histograms[byte][(entry.key >> (byte * 8)) & 0xFF];
+
+        Entry* source = entries.data();
+        Entry* target = scratch.data();
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            uint32_t* histogram = histograms[byte];
+            // every key has the same value in this byte: the pass wouldn't change the order
+            if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count)
+                continue;
+            uint32_t offset = 0;
+            for (int digit = 0; digit < 256; ++digit)
+            {
+                uint32_t size = histogram[digit];
+                histogram[digit] = offset;
+                offset += size;
+            }
+            for (size_t i = 0; i < count; ++i)
+                target[histogram[(source[i].key >> (byte * 8)) & 0xFF]++] = source[i];
+            std::swap(source, target);
+        }
+        if (source != entries.data())
+            memcpy(entries.data(), source, count * sizeof(Entry));
+    }
+
+private:
+    std::vector<Entry> entries, scratch;
+    std::vector<Draw> draws;
+    std::unordered_map<unsigned int, GLint> modelLocations;
+    Stats stats;
+
+    // top 24 bits of the float (sign, exponent and 15 mantissa bits); negative distances count as 0
+    static uint32_t quantizeDepth(float depth)
+    {
+        if (!(depth > 0.0f))
+            return 0;
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 8;
+    }
+
+    GLint uniformLocation(unsigned int program)
+    {
+        auto found = modelLocations.find(program);
+        if (found != modelLocations.end())
+            return found->second;
+        GLint location = glGetUniformLocation(program, ModelUniform.c_str());
+        modelLocations[program] = location;
+        return location;
+    }
+};
+
+#endif
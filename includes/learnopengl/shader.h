@@ -8,15 +8,42 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <vector>
+
+#include <learnopengl/frame_constants.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_preprocessor.h>
+
+class ShaderBuildQueue;
+
+// a link issued by ShaderBuildQueue whose status hasn't been checked yet; shared by every copy of
+// the Shader, so exactly one of them (or ShaderBuildQueue::Finish) checks it and deletes the stages
+struct PendingShaderBuild
+{
+    unsigned int program = 0;
+    std::string cacheKey;
+    std::vector<unsigned int> stages;
+    bool finished = false;
+};
 
 class Shader
 {
 public:
     unsigned int ID;
+    // empty shader, to be built by a ShaderBuildQueue (see shader_build_queue.h)
+    // ------------------------------------------------------------------------
+    Shader() : ID(0) {}
     // constructor generates the shader on the fly
+    // defines (e.g. "#define KERNEL_SIZE 16\n") are inserted after the #version line of every stage
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* defines = nullptr)
     {
+        // remembered for hot reloading (see shader_reload.h)
+        sourcePaths = { vertexPath, fragmentPath };
+        if (geometryPath != nullptr)
+            sourcePaths.push_back(geometryPath);
+        sourceDefines = defines != nullptr ? defines : "";
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -57,72 +84,52 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-
-
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-
-
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-
-
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-
-
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        if (defines != nullptr)
         {
-			/*
-			几何着色器的输入是一个图元（如点或三角形）的一组顶点。
-
-			1. 几何着色器可以在顶点发送到下一着色器阶段之前对它们随意变换。
-			2. 几何着色器最有趣的地方在于，它能够将（这一组）顶点变换为完全不同的图元，
-			3. 并且还能生成比原来更多的顶点
-			
-			*/
-
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            vertexCode = ShaderPreprocessor::injectDefines(vertexCode, defines);
+            fragmentCode = ShaderPreprocessor::injectDefines(fragmentCode, defines);
+            geometryCode = ShaderPreprocessor::injectDefines(geometryCode, defines);
         }
-
-
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry); // 几何着色器shader也可以附着上program 
-
-
-        glLinkProgram(ID); // 最后program连接上所有附着的shader
-        checkCompileErrors(ID, "PROGRAM");
-
-
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        build(vertexCode, fragmentCode, geometryPath != nullptr ? &geometryCode : nullptr);
+    }
+    // program from already loaded (e.g. preprocessed) sources; geometryCode may be empty
+    // ------------------------------------------------------------------------
+    static Shader FromSource(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode = std::string())
+    {
+        Shader shader;
+        shader.build(vertexCode, fragmentCode, geometryCode.empty() ? nullptr : &geometryCode);
+        return shader;
     }
+    // program from files that #include others (see shader_preprocessor.h), e.g. frame_constants.glsl;
+    // the paths are remembered, so ShaderHotReload (given the same include dirs) can watch it
+    // ------------------------------------------------------------------------
+    Shader(ShaderPreprocessor& preprocessor, const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    {
+        sourcePaths = { vertexPath, fragmentPath };
+        if (geometryPath != nullptr)
+            sourcePaths.push_back(geometryPath);
+        std::string code[3];
+        for (size_t stage = 0; stage < sourcePaths.size(); ++stage)
+        {
+            code[stage] = preprocessor.Expand(sourcePaths[stage]);
+            if (code[stage].empty())
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << preprocessor.Error() << std::endl;
+        }
+        build(code[0], code[1], geometryPath != nullptr ? &code[2] : nullptr);
+    }
+    // the files this shader was loaded from (vertex, fragment[, geometry]) and its defines; empty for FromSource
+    // ------------------------------------------------------------------------
+    const std::vector<std::string>& SourcePaths() const { return sourcePaths; }
+    const std::string& SourceDefines() const { return sourceDefines; }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
+        if (pendingBuild)
+        {
+            finishBuild(*pendingBuild);
+            pendingBuild.reset();
+        }
         glUseProgram(ID); 
     }
     // utility uniform functions
@@ -185,9 +192,116 @@ public:
     }
 
 private:
+    friend class ShaderBuildQueue;
+    std::vector<std::string> sourcePaths;
+    std::string sourceDefines;
+    // set by ShaderBuildQueue, which doesn't wait for the compile/link status
+    std::shared_ptr<PendingShaderBuild> pendingBuild;
+
+    // the part of a queued build that waits for the driver, done on first use (or by ShaderBuildQueue::Finish)
+    // ------------------------------------------------------------------------
+    static void finishBuild(PendingShaderBuild& build)
+    {
+        if (build.finished)
+            return;
+        build.finished = true;
+        GLint success;
+        glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            // the link log rarely says more than "a stage failed", so report the stages as well
+            for (unsigned int stage : build.stages)
+                checkCompileErrors(stage, "STAGE");
+            checkCompileErrors(build.program, "PROGRAM");
+        }
+        else
+        {
+            ProgramCache::Store(build.program, build.cacheKey);
+            FrameConstants::BindBlock(build.program);
+        }
+        for (unsigned int stage : build.stages)
+            glDeleteShader(stage);
+        build.stages.clear();
+    }
+    // compiles and links the program (or loads it from the program binary cache)
+    // ------------------------------------------------------------------------
+    void build(const std::string& vertexCode, const std::string& fragmentCode, const std::string* geometryCode)
+    {
+        std::string noGeometry;
+        // reuse the driver binary if these exact sources were linked before (see program_cache.h)
+        std::string cacheKey = ProgramCache::Key({ &vertexCode, &fragmentCode, geometryCode != nullptr ? geometryCode : &noGeometry });
+        ID = glCreateProgram();
+        if (ProgramCache::Load(ID, cacheKey))
+        {
+            FrameConstants::BindBlock(ID);
+            return;
+        }
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+
+
+        // 2. compile shaders
+        unsigned int vertex, fragment;
+
+
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+
+
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+
+
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(geometryCode != nullptr)
+        {
+			/*
+			几何着色器的输入是一个图元（如点或三角形）的一组顶点。
+
+			1. 几何着色器可以在顶点发送到下一着色器阶段之前对它们随意变换。
+			2. 几何着色器最有趣的地方在于，它能够将（这一组）顶点变换为完全不同的图元，
+			3. 并且还能生成比原来更多的顶点
+			
+			*/
+
+            const char * gShaderCode = geometryCode->c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+
+
+        // shader Program
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        if(geometryCode != nullptr)
+            glAttachShader(ID, geometry); // 几何着色器shader也可以附着上program 
+
+
+        ProgramCache::PrepareLink(ID);
+        glLinkProgram(ID); // 最后program连接上所有附着的shader
+        checkCompileErrors(ID, "PROGRAM");
+        ProgramCache::Store(ID, cacheKey);
+        FrameConstants::BindBlock(ID); // shared per-frame block at its fixed binding point
+
+
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(geometryCode != nullptr)
+            glDeleteShader(geometry);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static void checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
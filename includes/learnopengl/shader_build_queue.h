@@ -0,0 +1,187 @@
+#ifndef SHADER_BUILD_QUEUE_H
+#define SHADER_BUILD_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_preprocessor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Builds many Shader programs at once instead of one after the other.
+//
+// The Shader constructor checks the compile status of every stage right after compiling it,
+// so the CPU waits for each compile before submitting the next one. With the queue:
+//   1. the app Adds every program of the demo,
+//   2. Build preprocesses the files on worker threads (#include resolved through IncludeDirs as in
+//      shader_preprocessor.h, then the defines injected),
+//   3. all compiles and then all links are issued back-to-back, so the driver can overlap them
+//      (with KHR_parallel_shader_compile it does so on its own threads),
+//   4. each program's status is only queried when it is first used (Shader::use).
+// Programs found in the ProgramCache skip steps 3 and 4. Call Finish before tearing down the
+// context, so programs that were never used still get their stages deleted and their binaries cached.
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+class ShaderBuildQueue
+{
+public:
+    // searched for #include "file" after the including file's own directory
+    std::vector<std::string> IncludeDirs;
+
+    // paths must stay valid until Build; the shader is filled in by Build
+    void Add(Shader& shader, const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* defines = nullptr)
+    {
+        Job job;
+        job.shader = &shader;
+        job.paths[0] = vertexPath;
+        job.paths[1] = fragmentPath;
+        job.paths[2] = geometryPath;
+        job.defines = defines ? defines : "";
+        jobs.push_back(job);
+        shader.sourcePaths = { vertexPath, fragmentPath };
+        if (geometryPath != nullptr)
+            shader.sourcePaths.push_back(geometryPath);
+        shader.sourceDefines = job.defines;
+    }
+
+    // loader (e.g. glfwGetProcAddress) is only needed to enable KHR_parallel_shader_compile, which glad doesn't load
+    void Build(GLADloadproc loader = nullptr, unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        enableParallelCompile(loader);
+
+        // 1. read and preprocess the sources on worker threads
+        std::atomic<size_t> next(0);
+        auto readSources = [this, &next]()
+        {
+            // one preprocessor per thread, it caches the files it read
+            ShaderPreprocessor preprocessor;
+            preprocessor.IncludeDirs = IncludeDirs;
+            for (size_t i = next++; i < jobs.size(); i = next++)
+                for (int stage = 0; stage < 3; ++stage)
+                    if (jobs[i].paths[stage] != nullptr)
+                    {
+                        std::string code = preprocessor.Expand(jobs[i].paths[stage]);
+                        if (code.empty())
+                            jobs[i].error += preprocessor.Error() + " ";
+                        jobs[i].code[stage] = ShaderPreprocessor::injectDefines(code, jobs[i].defines);
+                    }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < std::min<size_t>(std::max(1u, threadCount), jobs.size()); ++i)
+            workers.emplace_back(readSources);
+        readSources();
+        for (std::thread& worker : workers)
+            worker.join();
+
+        // 2. issue every compile without waiting for any of them
+        const GLenum stageTypes[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+        for (Job& job : jobs)
+        {
+            if (!job.error.empty())
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << job.error << std::endl;
+            Shader& shader = *job.shader;
+            shader.ID = glCreateProgram();
+            job.build = std::make_shared<PendingShaderBuild>();
+            job.build->program = shader.ID;
+            job.build->cacheKey = ProgramCache::Key({ &job.code[0], &job.code[1], &job.code[2] });
+            if (ProgramCache::Load(shader.ID, job.build->cacheKey))
+            {
+                FrameConstants::BindBlock(shader.ID);
+                continue;
+            }
+            for (int stage = 0; stage < 3; ++stage)
+            {
+                if (job.paths[stage] == nullptr)
+                    continue;
+                const char* code = job.code[stage].c_str();
+                unsigned int id = glCreateShader(stageTypes[stage]);
+                glShaderSource(id, 1, &code, NULL);
+                glCompileShader(id);
+                job.build->stages.push_back(id);
+            }
+        }
+        // 3. issue every link, the status is checked by Shader::use
+        for (Job& job : jobs)
+        {
+            Shader& shader = *job.shader;
+            if (job.build->stages.empty())
+                continue;
+            for (unsigned int stage : job.build->stages)
+                glAttachShader(shader.ID, stage);
+            ProgramCache::PrepareLink(shader.ID);
+            glLinkProgram(shader.ID);
+            shader.pendingBuild = job.build;
+            pending.push_back(job.build);
+        }
+        jobs.clear();
+    }
+
+    // checks every queued program that hasn't been used yet (blocks until they're linked)
+    void Finish()
+    {
+        for (std::shared_ptr<PendingShaderBuild>& build : pending)
+            Shader::finishBuild(*build);
+        pending.clear();
+    }
+
+    // true once the program can be used without blocking; always true without KHR_parallel_shader_compile
+    bool IsComplete(const Shader& shader) const
+    {
+        if (!parallelCompile || !shader.pendingBuild || shader.pendingBuild->finished)
+            return true;
+        GLint complete = GL_TRUE;
+        glGetProgramiv(shader.ID, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    bool ParallelCompile() const { return parallelCompile; }
+
+private:
+    struct Job
+    {
+        Shader*     shader;
+        const char* paths[3];
+        std::string defines;
+        std::string code[3];
+        std::string error;
+        std::shared_ptr<PendingShaderBuild> build;
+    };
+    std::vector<Job> jobs;
+    std::vector<std::shared_ptr<PendingShaderBuild>> pending;
+    bool parallelCompile = false;
+
+    void enableParallelCompile(GLADloadproc loader)
+    {
+        if (parallelCompile || loader == nullptr)
+            return;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count && !parallelCompile; ++i)
+        {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+            {
+                typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+                const char* entry = name[3] == 'K' ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB";
+                MaxShaderCompilerThreadsProc maxThreads = (MaxShaderCompilerThreadsProc)loader(entry);
+                if (maxThreads)
+                    maxThreads(0xFFFFFFFFu); // let the driver pick the thread count
+                parallelCompile = true;
+            }
+        }
+    }
+};
+
+#endif
@@ -9,13 +9,18 @@
 #include <sstream>
 #include <iostream>
 
+#include <learnopengl/frame_constants.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_preprocessor.h>
+
 class ComputeShader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // defines (e.g. "#define BLOOM_IMAGE_FORMAT rgba16f\n") are inserted after the #version line
     // ------------------------------------------------------------------------
-    ComputeShader(const char* computePath)
+    ComputeShader(const char* computePath, const char* defines = nullptr)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string computeCode;
@@ -39,6 +44,16 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
         }
+        if (defines != nullptr)
+            computeCode = ShaderPreprocessor::injectDefines(computeCode, defines);
+        // reuse the driver binary if these exact sources were linked before (see program_cache.h)
+        std::string cacheKey = ProgramCache::Key({ &computeCode });
+        ID = glCreateProgram();
+        if (ProgramCache::Load(ID, cacheKey))
+        {
+            FrameConstants::BindBlock(ID);
+            return;
+        }
         const char* cShaderCode = computeCode.c_str();
         // 2. compile shaders
         unsigned int compute;
@@ -49,10 +64,12 @@ public:
         checkCompileErrors(compute, "COMPUTE");
         
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, compute);
+        ProgramCache::PrepareLink(ID);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        ProgramCache::Store(ID, cacheKey);
+        FrameConstants::BindBlock(ID); // shared per-frame block at its fixed binding point
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(compute);
     }
@@ -9,6 +9,9 @@
 #include <sstream>
 #include <iostream>
 
+#include <learnopengl/frame_constants.h>
+#include <learnopengl/program_cache.h>
+
 class Shader
 {
 public:
@@ -45,6 +48,14 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
         }
+        // reuse the driver binary if these exact sources were linked before (see program_cache.h)
+        std::string cacheKey = ProgramCache::Key({ &vertexCode, &fragmentCode });
+        ID = glCreateProgram();
+        if (ProgramCache::Load(ID, cacheKey))
+        {
+            FrameConstants::BindBlock(ID);
+            return;
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -60,11 +71,13 @@ public:
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        ProgramCache::PrepareLink(ID);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        ProgramCache::Store(ID, cacheKey);
+        FrameConstants::BindBlock(ID); // shared per-frame block at its fixed binding point
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
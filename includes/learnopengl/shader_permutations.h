@@ -0,0 +1,104 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_preprocessor.h>
+
+#include <cctype>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Specialized programs of one vertex/fragment shader pair, selected by feature bits.
+//
+// Feature i of the constructor's list is enabled by bit i and compiles the sources with
+// "#define <feature>", so a shader uses #ifdef NORMAL_MAP instead of branching on a uniform.
+// Programs are built on first request and kept. Features the expanded sources never mention
+// aren't defined, and permutations whose expanded sources come out identical share one program,
+// so listing a feature that only some shaders use costs nothing.
+//
+//   ShaderPermutations pbr(preprocessor, "1.2.pbr.vs", "1.2.pbr.fs", { "NORMAL_MAP" });
+//   Shader &shader = pbr.Get(useNormalMap ? 1u : 0u);
+
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(ShaderPreprocessor& preprocessor, const std::string& vertexPath, const std::string& fragmentPath,
+                       const std::vector<std::string>& features, const std::vector<std::string>& commonDefines = {})
+        : preprocessor(preprocessor), vertexPath(vertexPath), fragmentPath(fragmentPath), features(features), commonDefines(commonDefines) {}
+
+    Shader& Get(unsigned int featureBits)
+    {
+        auto found = byFeatures.find(featureBits);
+        if (found != byFeatures.end())
+            return *programs[found->second];
+
+        std::string vertexCode, fragmentCode;
+        Expand(featureBits, vertexCode, fragmentCode);
+        std::string key = vertexCode + '\0' + fragmentCode;
+        auto same = bySource.find(key);
+        size_t index;
+        if (same != bySource.end())
+            index = same->second;
+        else
+        {
+            index = programs.size();
+            programs.emplace_back(new Shader(Shader::FromSource(vertexCode, fragmentCode)));
+            bySource[key] = index;
+        }
+        byFeatures[featureBits] = index;
+        return *programs[index];
+    }
+
+    // the expanded sources of a permutation, without building it (no OpenGL needed)
+    void Expand(unsigned int featureBits, std::string& vertexCode, std::string& fragmentCode)
+    {
+        // expand once without features to find out which ones the sources mention
+        std::string plainVertex = expandStage(vertexPath, commonDefines);
+        std::string plainFragment = expandStage(fragmentPath, commonDefines);
+        std::vector<std::string> defines = commonDefines;
+        for (size_t i = 0; i < features.size() && i < 32; ++i)
+            if ((featureBits & (1u << i)) && (mentions(plainVertex, features[i]) || mentions(plainFragment, features[i])))
+                defines.push_back(features[i]);
+        vertexCode = defines.size() == commonDefines.size() ? plainVertex : expandStage(vertexPath, defines);
+        fragmentCode = defines.size() == commonDefines.size() ? plainFragment : expandStage(fragmentPath, defines);
+    }
+
+    // permutations requested so far / programs actually compiled for them
+    unsigned int PermutationCount() const { return (unsigned int)byFeatures.size(); }
+    unsigned int ProgramCount() const { return (unsigned int)programs.size(); }
+
+private:
+    ShaderPreprocessor& preprocessor;
+    std::string vertexPath, fragmentPath;
+    std::vector<std::string> features, commonDefines;
+    std::vector<std::unique_ptr<Shader>> programs;
+    std::unordered_map<unsigned int, size_t> byFeatures;
+    std::unordered_map<std::string, size_t> bySource;
+
+    std::string expandStage(const std::string& path, const std::vector<std::string>& defines)
+    {
+        std::string code = preprocessor.Expand(path, defines);
+        if (code.empty())
+            std::cout << "ERROR::SHADER::PREPROCESSOR: " << preprocessor.Error() << std::endl;
+        return code;
+    }
+
+    // whole-word search, so NORMAL_MAP doesn't match normalMap or NORMAL_MAP_SCALE
+    static bool mentions(const std::string& code, const std::string& name)
+    {
+        for (size_t at = code.find(name); at != std::string::npos; at = code.find(name, at + 1))
+        {
+            bool startsWord = at == 0 || !(std::isalnum((unsigned char)code[at - 1]) || code[at - 1] == '_');
+            size_t end = at + name.size();
+            bool endsWord = end == code.size() || !(std::isalnum((unsigned char)code[end]) || code[end] == '_');
+            if (startsWord && endsWord)
+                return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// GLSL front end: resolves #include "file" and injects #define sets, without touching OpenGL,
+// so the expanded sources can be checked on the CPU.
+//
+//   ShaderPreprocessor preprocessor;
+//   preprocessor.IncludeDirs.push_back(FileSystem::getPath("resources/shaders"));
+//   std::string code = preprocessor.Expand("1.2.pbr.fs", { "NORMAL_MAP", "LIGHT_COUNT 4" });
+//
+// Includes are looked up next to the including file first, then in IncludeDirs. A file with
+// #pragma once is only pasted once per expansion. Every included block is wrapped in
+// #line directives; the second number is the file's index in Files(), so a driver error like
+// "2(14): error" means line 14 of Files()[2]. Files are read from disk once and then cached.
+
+class ShaderPreprocessor
+{
+public:
+    std::vector<std::string> IncludeDirs;
+
+    // expanded source, or an empty string (and Error() set) if a file is missing or includes itself
+    std::string Expand(const std::string& path, const std::vector<std::string>& defines = {})
+    {
+        error.clear();
+        dependencies.clear();
+        std::unordered_set<std::string> once;
+        std::vector<std::string> stack;
+        std::string body;
+        if (!expandFile(path, body, once, stack))
+            return std::string();
+        std::string defineBlock;
+        for (const std::string& define : defines)
+            defineBlock += "#define " + define + "\n";
+        return injectDefines(body, defineBlock);
+    }
+
+    const std::string& Error() const { return error; }
+    // every file seen so far, indexed by the source-string number used in #line
+    const std::vector<std::string>& Files() const { return files; }
+    // the files read by the last Expand (the main file and everything it includes)
+    const std::vector<std::string>& Dependencies() const { return dependencies; }
+    // forget cached file contents (e.g. after a shader was edited on disk)
+    void ClearCache() { contents.clear(); }
+
+    // #version must stay the first line, so the defines go right after it; used by every Shader class
+    static std::string injectDefines(const std::string& code, const std::string& defines)
+    {
+        if (code.empty() || defines.empty())
+            return code;
+        std::string block = defines.back() == '\n' ? defines : defines + "\n";
+        size_t lineEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+        if (lineEnd == std::string::npos)
+            return block + code;
+        return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+    }
+
+private:
+    std::unordered_map<std::string, std::string> contents;
+    std::vector<std::string> files;
+    std::vector<std::string> dependencies;
+    std::string error;
+
+    int fileIndex(const std::string& path)
+    {
+        for (size_t i = 0; i < files.size(); ++i)
+            if (files[i] == path)
+                return (int)i;
+        files.push_back(path);
+        return (int)files.size() - 1;
+    }
+
+    const std::string* read(const std::string& path)
+    {
+        auto cached = contents.find(path);
+        if (cached != contents.end())
+            return &cached->second;
+        std::ifstream file(path);
+        if (!file)
+            return nullptr;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return &(contents[path] = stream.str());
+    }
+
+    std::string resolve(const std::string& name, const std::string& includer)
+    {
+        size_t slash = includer.find_last_of("/\\");
+        std::vector<std::string> candidates;
+        candidates.push_back(slash == std::string::npos ? name : includer.substr(0, slash + 1) + name);
+        for (const std::string& dir : IncludeDirs)
+            candidates.push_back(dir + "/" + name);
+        for (const std::string& candidate : candidates)
+            if (read(candidate))
+                return candidate;
+        return std::string();
+    }
+
+    // the first non-space token of a line: "#include", "#pragma" or "#version" (with optional spaces after '#')
+    static bool directive(const std::string& line, const char* name, size_t& rest)
+    {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string::npos || line[i] != '#')
+            return false;
+        i = line.find_first_not_of(" \t", i + 1);
+        size_t length = std::char_traits<char>::length(name);
+        if (i == std::string::npos || line.compare(i, length, name) != 0)
+            return false;
+        rest = i + length;
+        return true;
+    }
+
+    bool expandFile(const std::string& path, std::string& out, std::unordered_set<std::string>& once, std::vector<std::string>& stack)
+    {
+        const std::string* source = read(path);
+        if (!source)
+        {
+            error = "could not open " + path;
+            return false;
+        }
+        for (const std::string& open : stack)
+            if (open == path)
+            {
+                error = "recursive #include of " + path;
+                return false;
+            }
+        stack.push_back(path);
+        dependencies.push_back(path);
+        int index = fileIndex(path);
+        bool topLevel = stack.size() == 1;
+
+        std::istringstream lines(*source);
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(lines, line))
+        {
+            ++lineNumber;
+            size_t rest;
+            if (directive(line, "include", rest))
+            {
+                size_t open = line.find('"', rest), close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos)
+                {
+                    error = path + "(" + std::to_string(lineNumber) + "): malformed #include";
+                    return false;
+                }
+                std::string included = resolve(line.substr(open + 1, close - open - 1), path);
+                if (included.empty())
+                {
+                    error = path + "(" + std::to_string(lineNumber) + "): can't find " + line.substr(open + 1, close - open - 1);
+                    return false;
+                }
+                if (once.count(included))
+                {
+                    out += "\n"; // keep the line numbers
+                    continue;
+                }
+                out += "#line 1 " + std::to_string(fileIndex(included)) + "\n";
+                if (!expandFile(included, out, once, stack))
+                    return false;
+                out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+                continue;
+            }
+            if (directive(line, "pragma", rest) && line.find("once", rest) != std::string::npos)
+            {
+                once.insert(path);
+                out += "\n"; // keep the line numbers
+                continue;
+            }
+            if (!topLevel && directive(line, "version", rest))
+            {
+                out += "\n"; // only the top-level file may declare a version
+                continue;
+            }
+            out += line;
+            out += '\n';
+            // restart numbering after #version, so injected defines don't shift the line numbers
+            if (topLevel && lineNumber == 1 && directive(line, "version", rest))
+                out += "#line 2 " + std::to_string(index) + "\n";
+        }
+        stack.pop_back();
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,482 @@
+#ifndef SHADER_RELOAD_H
+#define SHADER_RELOAD_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_preprocessor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Hot reloading for Shader objects.
+//
+//   ShaderHotReload reloader;
+//   reloader.Watch(shader);          // after the shader was built from files
+//   ...
+//   reloader.Update();               // once per frame, before rendering
+//   ...
+//   reloader.Destroy();              // before glfwTerminate
+//
+// A watcher thread waits for changes to the shader's files and everything they #include
+// (inotify on Linux, polling the modification times elsewhere) and preprocesses the new sources.
+// Update then compiles and links them without waiting for the result. A finished program is
+// swapped into the Shader at the next frame boundary: uniform values and uniform block bindings
+// are copied over from the old program (set* looks locations up by name, so they resolve against
+// the new program) and the old program is deleted. If compiling or linking fails the log is
+// printed and the old program keeps running. With KHR_parallel_shader_compile the frame never waits for the
+// driver; without it Update blocks once per edit when it checks the result.
+//
+// The watched files are the ones the shader was loaded from, i.e. the copies next to the
+// executable unless the demo runs from its source directory.
+
+class ShaderHotReload
+{
+public:
+    unsigned int Reloads = 0, Failures = 0;
+
+    ShaderHotReload() : stop(false)
+    {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+        watcher = std::thread(&ShaderHotReload::watchLoop, this);
+    }
+    // only stops the watcher: programs still being built need the context, see Destroy
+    ~ShaderHotReload()
+    {
+        stopWatching();
+    }
+
+    // stops watching and deletes the builds that weren't swapped in yet; call while the context is still current
+    void Destroy()
+    {
+        stopWatching();
+        for (Entry& entry : entries)
+            discardPending(entry);
+        entries.clear();
+        readyQueue.clear();
+    }
+
+    // include directories used to resolve #include while reloading
+    void AddIncludeDir(const std::string& dir)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        includeDirs.push_back(dir);
+    }
+
+    // the shader must outlive the reloader (or at least its last Update)
+    void Watch(Shader& shader)
+    {
+        if (shader.SourcePaths().empty())
+        {
+            std::cout << "ERROR::SHADER_RELOAD: shader " << shader.ID << " wasn't loaded from files" << std::endl;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry entry;
+        entry.shader = &shader;
+        entry.paths = shader.SourcePaths();
+        entry.defines = shader.SourceDefines();
+        entries.push_back(entry);
+        // dependencies are collected by the watcher thread before it starts waiting for changes
+        rescan.push_back(entries.size() - 1);
+    }
+
+    // compiles sources that changed and swaps in programs that finished; call at a frame boundary
+    void Update()
+    {
+        std::vector<Ready> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(readyQueue);
+        }
+        for (Ready& sources : ready)
+            submit(entries[sources.entry], sources);
+        for (Entry& entry : entries)
+            if (entry.pendingProgram != 0 && isComplete(entry.pendingProgram))
+                finish(entry);
+    }
+
+private:
+    struct Entry
+    {
+        Shader* shader = nullptr;
+        std::vector<std::string> paths;
+        std::string defines;
+        std::vector<std::string> dependencies; // normalized paths, written by the watcher thread only
+        unsigned int pendingProgram = 0;
+        std::vector<unsigned int> pendingStages;
+    };
+    struct Ready
+    {
+        size_t entry;
+        std::vector<std::string> code;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<size_t> rescan;
+    std::vector<Ready> readyQueue;
+    std::vector<std::string> includeDirs;
+    std::mutex mutex;
+    std::thread watcher;
+    std::atomic<bool> stop;
+    int parallelCompile = -1; // unknown until the first submit
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::unordered_map<int, std::string> watchedDirs;
+#endif
+
+    void stopWatching()
+    {
+        if (!watcher.joinable())
+            return;
+        stop = true;
+        watcher.join();
+#ifdef __linux__
+        if (inotifyFd >= 0)
+            close(inotifyFd);
+        inotifyFd = -1;
+#endif
+    }
+
+    static std::string normalize(const std::string& path)
+    {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        return (error ? std::filesystem::path(path) : absolute).lexically_normal().string();
+    }
+
+    // --- watcher thread ---------------------------------------------------
+
+    // preprocesses an entry and records what it depends on; false if a file couldn't be read
+    bool expand(ShaderPreprocessor& preprocessor, size_t index, Ready& ready)
+    {
+        std::vector<std::string> paths, dependencies;
+        std::string defines;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            paths = entries[index].paths;
+            defines = entries[index].defines;
+            preprocessor.IncludeDirs = includeDirs;
+        }
+        preprocessor.ClearCache();
+        ready.entry = index;
+        bool ok = true;
+        for (const std::string& path : paths)
+        {
+            std::string code = preprocessor.Expand(path);
+            if (code.empty())
+            {
+                std::cout << "ERROR::SHADER_RELOAD: " << preprocessor.Error() << std::endl;
+                ok = false;
+            }
+            ready.code.push_back(ShaderPreprocessor::injectDefines(code, defines));
+            for (const std::string& dependency : preprocessor.Dependencies())
+                dependencies.push_back(normalize(dependency));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        // keep the old dependencies as well while a file is missing (e.g. mid-save), so it is still watched
+        if (ok)
+            entries[index].dependencies = dependencies;
+        else
+            entries[index].dependencies.insert(entries[index].dependencies.end(), dependencies.begin(), dependencies.end());
+#ifdef __linux__
+        for (const std::string& dependency : entries[index].dependencies)
+            watchDirectory(std::filesystem::path(dependency).parent_path().string());
+#endif
+        return ok;
+    }
+
+#ifdef __linux__
+    void watchDirectory(const std::string& dir)
+    {
+        for (auto& watched : watchedDirs)
+            if (watched.second == dir)
+                return;
+        // editors often save by writing a new file and renaming it over the old one, so watch the directory
+        int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd >= 0)
+            watchedDirs[wd] = dir;
+    }
+
+    // changed files since the last call, waiting up to timeoutMs for the first one
+    std::vector<std::string> changedFiles(int timeoutMs)
+    {
+        std::vector<std::string> changed;
+        if (inotifyFd < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            return changed;
+        }
+        pollfd descriptor = { inotifyFd, POLLIN, 0 };
+        if (poll(&descriptor, 1, timeoutMs) <= 0)
+            return changed;
+        // editors write in several steps, give them a moment before reading the files
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            for (char* at = buffer; at < buffer + length; at += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(at)->len)
+            {
+                inotify_event* event = reinterpret_cast<inotify_event*>(at);
+                std::lock_guard<std::mutex> lock(mutex);
+                auto dir = watchedDirs.find(event->wd);
+                if (dir != watchedDirs.end() && event->len > 0)
+                    changed.push_back(normalize(dir->second + "/" + event->name));
+            }
+        return changed;
+    }
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+
+    std::vector<std::string> changedFiles(int timeoutMs)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        std::vector<std::string> files, changed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Entry& entry : entries)
+                files.insert(files.end(), entry.dependencies.begin(), entry.dependencies.end());
+        }
+        for (const std::string& file : files)
+        {
+            std::error_code error;
+            auto time = std::filesystem::last_write_time(file, error);
+            if (error)
+                continue;
+            auto known = writeTimes.find(file);
+            // the first time a file is seen only records its modification time
+            if (known != writeTimes.end() && known->second != time)
+                changed.push_back(file);
+            writeTimes[file] = time;
+        }
+        return changed;
+    }
+#endif
+
+    void watchLoop()
+    {
+        ShaderPreprocessor preprocessor;
+        while (!stop)
+        {
+            std::vector<size_t> newEntries;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                newEntries.swap(rescan);
+            }
+            for (size_t index : newEntries)
+            {
+                Ready unused;
+                expand(preprocessor, index, unused);
+            }
+            std::vector<std::string> changed = changedFiles(100);
+            if (changed.empty())
+                continue;
+            std::vector<size_t> dirty;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 0; i < entries.size(); ++i)
+                    for (const std::string& dependency : entries[i].dependencies)
+                        if (std::find(changed.begin(), changed.end(), dependency) != changed.end())
+                        {
+                            dirty.push_back(i);
+                            break;
+                        }
+            }
+            for (size_t index : dirty)
+            {
+                Ready ready;
+                if (!expand(preprocessor, index, ready))
+                    continue;
+                std::lock_guard<std::mutex> lock(mutex);
+                readyQueue.push_back(std::move(ready));
+            }
+        }
+    }
+
+    // --- render thread ----------------------------------------------------
+
+    bool isComplete(unsigned int program)
+    {
+        if (parallelCompile != 1)
+            return true;
+        GLint complete = GL_TRUE;
+        glGetProgramiv(program, 0x91B1 /* GL_COMPLETION_STATUS_KHR */, &complete);
+        return complete == GL_TRUE;
+    }
+
+    void submit(Entry& entry, const Ready& sources)
+    {
+        if (parallelCompile < 0)
+        {
+            parallelCompile = 0;
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; ++i)
+            {
+                const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if (name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+                    parallelCompile = 1;
+            }
+        }
+        // a newer edit replaces a build that hasn't finished yet
+        discardPending(entry);
+        const GLenum stageTypes[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+        entry.pendingProgram = glCreateProgram();
+        for (size_t stage = 0; stage < sources.code.size() && stage < 3; ++stage)
+        {
+            const char* code = sources.code[stage].c_str();
+            unsigned int id = glCreateShader(stageTypes[stage]);
+            glShaderSource(id, 1, &code, NULL);
+            glCompileShader(id);
+            glAttachShader(entry.pendingProgram, id);
+            entry.pendingStages.push_back(id);
+        }
+        glLinkProgram(entry.pendingProgram);
+    }
+
+    void finish(Entry& entry)
+    {
+        GLint success;
+        glGetProgramiv(entry.pendingProgram, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            char log[1024];
+            for (size_t stage = 0; stage < entry.pendingStages.size(); ++stage)
+            {
+                GLint compiled;
+                glGetShaderiv(entry.pendingStages[stage], GL_COMPILE_STATUS, &compiled);
+                if (!compiled)
+                {
+                    glGetShaderInfoLog(entry.pendingStages[stage], sizeof(log), NULL, log);
+                    std::cout << "ERROR::SHADER_RELOAD: " << entry.paths[stage] << " failed to compile\n" << log << std::endl;
+                }
+            }
+            glGetProgramInfoLog(entry.pendingProgram, sizeof(log), NULL, log);
+            std::cout << "ERROR::SHADER_RELOAD: link failed, keeping the old program\n" << log << std::endl;
+            ++Failures;
+            discardPending(entry);
+            return;
+        }
+        copyBlockBindings(entry.shader->ID, entry.pendingProgram);
+        FrameConstants::BindBlock(entry.pendingProgram);
+        copyUniforms(entry.shader->ID, entry.pendingProgram);
+        glDeleteProgram(entry.shader->ID);
+        entry.shader->ID = entry.pendingProgram;
+        entry.pendingProgram = 0;
+        for (unsigned int stage : entry.pendingStages)
+            glDeleteShader(stage);
+        entry.pendingStages.clear();
+        ++Reloads;
+        std::cout << "shader reloaded: " << entry.paths[0] << " + " << entry.paths[1] << std::endl;
+    }
+
+    void discardPending(Entry& entry)
+    {
+        if (entry.pendingProgram != 0)
+            glDeleteProgram(entry.pendingProgram);
+        for (unsigned int stage : entry.pendingStages)
+            glDeleteShader(stage);
+        entry.pendingProgram = 0;
+        entry.pendingStages.clear();
+    }
+
+    // gives the uniform blocks of the new program the binding points the app set on the old one (e.g. the SSAO kernel)
+    static void copyBlockBindings(unsigned int from, unsigned int to)
+    {
+        GLint count = 0;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            char name[256];
+            GLint binding = 0;
+            glGetActiveUniformBlockName(from, (GLuint)i, sizeof(name), NULL, name);
+            glGetActiveUniformBlockiv(from, (GLuint)i, GL_UNIFORM_BLOCK_BINDING, &binding);
+            GLuint index = glGetUniformBlockIndex(to, name);
+            if (index != GL_INVALID_INDEX)
+                glUniformBlockBinding(to, index, (GLuint)binding);
+        }
+    }
+
+    // copies the values of the default-block uniforms both programs share
+    static void copyUniforms(unsigned int from, unsigned int to)
+    {
+        GLint previous, count = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(to);
+        glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            char name[256];
+            GLint size, block;
+            GLenum type;
+            GLuint index = (GLuint)i;
+            glGetActiveUniform(from, index, sizeof(name), NULL, &size, &type, name);
+            glGetActiveUniformsiv(from, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block);
+            if (block != -1 || strncmp(name, "gl_", 3) == 0)
+                continue;
+            std::string base = name;
+            if (base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+                base.resize(base.size() - 3);
+            for (GLint element = 0; element < size; ++element)
+            {
+                std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+                GLint source = glGetUniformLocation(from, elementName.c_str());
+                GLint target = glGetUniformLocation(to, elementName.c_str());
+                if (source >= 0 && target >= 0)
+                    copyUniform(from, source, target, type);
+            }
+        }
+        glUseProgram(previous);
+    }
+
+    static void copyUniform(unsigned int from, GLint source, GLint target, GLenum type)
+    {
+        GLfloat f[16];
+        GLint n[4];
+        GLuint u[4];
+        switch (type)
+        {
+        case GL_FLOAT:        glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+        case GL_FLOAT_VEC2:   glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+        case GL_FLOAT_VEC3:   glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+        case GL_FLOAT_VEC4:   glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+        case GL_FLOAT_MAT2:   glGetUniformfv(from, source, f); glUniformMatrix2fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3:   glGetUniformfv(from, source, f); glUniformMatrix3fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4:   glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:    glGetUniformiv(from, source, n); glUniform2iv(target, 1, n); break;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:    glGetUniformiv(from, source, n); glUniform3iv(target, 1, n); break;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:    glGetUniformiv(from, source, n); glUniform4iv(target, 1, n); break;
+        case GL_UNSIGNED_INT:      glGetUniformuiv(from, source, u); glUniform1uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glUniform2uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glUniform3uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glUniform4uiv(target, 1, u); break;
+        default:
+            // int, bool and every sampler/image type are set as a single int
+            glGetUniformiv(from, source, n);
+            glUniform1iv(target, 1, n);
+            break;
+        }
+    }
+};
+
+#endif
@@ -9,6 +9,9 @@
 #include <sstream>
 #include <iostream>
 
+#include <learnopengl/frame_constants.h>
+#include <learnopengl/program_cache.h>
+
 class Shader
 {
 public:
@@ -78,6 +81,14 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        // reuse the driver binary if these exact sources were linked before (see program_cache.h)
+        std::string cacheKey = ProgramCache::Key({ &vertexCode, &fragmentCode, &geometryCode, &tessControlCode, &tessEvalCode });
+        ID = glCreateProgram();
+        if (ProgramCache::Load(ID, cacheKey))
+        {
+            FrameConstants::BindBlock(ID);
+            return;
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -122,7 +133,6 @@ public:
             checkCompileErrors(tessEval, "TESS_EVALUATION");
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         if(geometryPath != nullptr)
@@ -131,8 +141,11 @@ public:
             glAttachShader(ID, tessControl);
         if(tessEvalPath != nullptr)
             glAttachShader(ID, tessEval);
+        ProgramCache::PrepareLink(ID);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        ProgramCache::Store(ID, cacheKey);
+        FrameConstants::BindBlock(ID); // shared per-frame block at its fixed binding point
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -0,0 +1,192 @@
+#ifndef SPHERICAL_HARMONICS_H
+#define SPHERICAL_HARMONICS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// 三阶球谐(SH9, l = 0..2) 漫反射辐照度
+//
+// 代替 32x32 的辐照图立方体贴图: 在CPU上把环境立方体贴图投影到9个SH系数,
+// 再乘上余弦波瓣的卷积系数(Ramamoorthi & Hanrahan 2001), shader中只要9个系数点乘基函数即可,
+// 省掉一个渲染pass, 一张cubemap 和 每像素一次cubemap采样.
+// 每个探针只要 9 * vec3 的数据, 可以存放上千个探针
+//
+// 与 irradiance_convolution.fs 保持一致, 结果是 E(n) / PI (shader中直接 irradiance * albedo)
+struct SH9
+{
+    glm::vec3 c[9];
+
+    SH9()
+    {
+        for (int i = 0; i < 9; ++i)
+            c[i] = glm::vec3(0.0f);
+    }
+
+    // 实数SH基函数  n 必须是单位向量
+    static void Basis(const glm::vec3& n, float out[9])
+    {
+        out[0] = 0.282095f;
+        out[1] = 0.488603f * n.y;
+        out[2] = 0.488603f * n.z;
+        out[3] = 0.488603f * n.x;
+        out[4] = 1.092548f * n.x * n.y;
+        out[5] = 1.092548f * n.y * n.z;
+        out[6] = 0.315392f * (3.0f * n.z * n.z - 1.0f);
+        out[7] = 1.092548f * n.x * n.z;
+        out[8] = 0.546274f * (n.x * n.x - n.y * n.y);
+    }
+
+    // 在方向 n 上重建 (跟 shader 中 irradianceSH 一样)
+    glm::vec3 Evaluate(const glm::vec3& n) const
+    {
+        float basis[9];
+        Basis(n, basis);
+        glm::vec3 result(0.0f);
+        for (int i = 0; i < 9; ++i)
+            result += c[i] * basis[i];
+        return glm::max(result, glm::vec3(0.0f));
+    }
+
+    // 辐射度系数L_lm -> 辐照度系数 E_lm / PI
+    // 余弦波瓣 A0 = PI, A1 = 2PI/3, A2 = PI/4, 再除以PI
+    void ConvolveCosineLobe()
+    {
+        const float band[3] = { 1.0f, 2.0f / 3.0f, 1.0f / 4.0f };
+        c[0] *= band[0];
+        for (int i = 1; i < 4; ++i) c[i] *= band[1];
+        for (int i = 4; i < 9; ++i) c[i] *= band[2];
+    }
+
+    // 立方体贴图某个面上(s,t ∈ [-1,1])对应的方向, 按照OpenGL规范的面朝向(sc, tc, ma)
+    static glm::vec3 CubemapTexelDirection(int face, float s, float t)
+    {
+        switch (face)
+        {
+        case 0:  return glm::vec3( 1.0f,   -t,   -s); // +X
+        case 1:  return glm::vec3(-1.0f,   -t,    s); // -X
+        case 2:  return glm::vec3(    s, 1.0f,    t); // +Y
+        case 3:  return glm::vec3(    s,-1.0f,   -t); // -Y
+        case 4:  return glm::vec3(    s,   -t, 1.0f); // +Z
+        default: return glm::vec3(   -s,   -t,-1.0f); // -Z
+        }
+    }
+
+    // 把6个面(RGB float, 每个面 size*size, 第0行对应 t = -1)投影到SH
+    // 每个面一个线程累加, 最后归约, 立体角权重之和归一化为 4PI
+    static SH9 ProjectCubemap(const std::vector<float> faces[6], int size)
+    {
+        SH9 partial[6];
+        float weights[6] = { 0.0f };
+
+        std::vector<std::thread> workers;
+        for (int face = 0; face < 6; ++face)
+        {
+            workers.emplace_back([&faces, &partial, &weights, face, size]
+            {
+                const float* texels = faces[face].data();
+                float basis[9];
+                for (int y = 0; y < size; ++y)
+                {
+                    float t = 2.0f * (y + 0.5f) / size - 1.0f;
+                    for (int x = 0; x < size; ++x)
+                    {
+                        float s = 2.0f * (x + 0.5f) / size - 1.0f;
+                        // 单个texel的立体角 dω ≈ dA / (1 + s^2 + t^2)^(3/2)
+                        float tmp = 1.0f + s * s + t * t;
+                        float dOmega = 4.0f / (size * size * tmp * std::sqrt(tmp));
+
+                        glm::vec3 n = glm::normalize(CubemapTexelDirection(face, s, t));
+                        const float* p = texels + 3 * (y * size + x);
+                        glm::vec3 radiance(p[0], p[1], p[2]);
+
+                        Basis(n, basis);
+                        for (int i = 0; i < 9; ++i)
+                            partial[face].c[i] += radiance * (basis[i] * dOmega);
+                        weights[face] += dOmega;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+
+        SH9 sh;
+        float totalWeight = 0.0f;
+        for (int face = 0; face < 6; ++face)
+        {
+            for (int i = 0; i < 9; ++i)
+                sh.c[i] += partial[face].c[i];
+            totalWeight += weights[face];
+        }
+        const float normalize = 4.0f * 3.14159265359f / totalWeight;
+        for (int i = 0; i < 9; ++i)
+            sh.c[i] *= normalize;
+        return sh;
+    }
+
+    // 从GPU上的环境立方体贴图回读某个mip level(如512的第4级是32x32, 足够低频的SH), 投影并卷积
+    static SH9 FromCubemap(GLuint cubemap, int baseSize, int mipLevel)
+    {
+        int size = baseSize >> mipLevel;
+        std::vector<float> faces[6];
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        for (int face = 0; face < 6; ++face)
+        {
+            faces[face].resize(size * size * 3);
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mipLevel, GL_RGB, GL_FLOAT, faces[face].data());
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        SH9 sh = ProjectCubemap(faces, size);
+        sh.ConvolveCosineLobe();
+        return sh;
+    }
+
+    // std140 下 vec3 数组每个元素按 vec4 对齐
+    void PackStd140(glm::vec4 out[9]) const
+    {
+        for (int i = 0; i < 9; ++i)
+            out[i] = glm::vec4(c[i], 0.0f);
+    }
+};
+
+// 保存SH9系数的UBO, shader中对应
+//     layout (std140) uniform SH9Irradiance { vec4 shCoefficients[9]; };
+class SH9UniformBuffer
+{
+public:
+    unsigned int ID = 0;
+    unsigned int bindingPoint = 0;
+
+    SH9UniformBuffer(unsigned int bindingPoint) : bindingPoint(bindingPoint)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, 9 * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+    }
+
+    void Upload(const SH9& sh)
+    {
+        glm::vec4 packed[9];
+        sh.PackStd140(packed);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(packed), packed);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // 把program中的uniform块 连接到这个UBO的绑定点
+    void Attach(unsigned int program, const char* blockName = "SH9Irradiance")
+    {
+        unsigned int blockIndex = glGetUniformBlockIndex(program, blockName);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, blockIndex, bindingPoint);
+    }
+};
+
+#endif
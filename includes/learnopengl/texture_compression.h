@@ -0,0 +1,970 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/mapped_file.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2 1
+#endif
+
+// Block compression (BC1/BC3/BC5/BC7) for textures cooked offline, and the DDS container they're stored in.
+//
+// A 4x4 block of RGBA8 (64 bytes) becomes 8 bytes (BC1) or 16 bytes (BC3, BC5, BC7), and it stays
+// compressed in GPU memory: 4x-8x less memory, upload bandwidth and texture cache traffic than RGBA8.
+//   BC1  RGB, 4 bpp: two RGB565 endpoints + 2 bit indices
+//   BC3  RGBA, 8 bpp: BC1 colour + a BC4 alpha block (two 8 bit endpoints + 3 bit indices)
+//   BC5  RG, 8 bpp: two BC4 blocks, for tangent space normal maps (the shader rebuilds z = sqrt(1 - x*x - y*y))
+//   BC7  RGBA, 8 bpp: only mode 6 is encoded (one RGBA line, 7 bit endpoints + p-bit, 4 bit indices),
+//        which already beats BC1/BC3 on gradients; decoding also only handles mode 6
+// The encoders fit the endpoints to the principal axis of the block's colours and refine them with a
+// least squares pass. Compress splits the image into block rows over all cores. With SSE2 (every x64
+// build) the nearest-palette-entry search, where most of the time goes, compares four texels at once;
+// the output is identical to the scalar path.
+// Cost, as measured with texture_cooker --report on one core (1024x1024 wood.png): the SSE2 search is
+// 2-3x faster than scalar, but BC1/BC3 are still about 3x slower than SOIL's bounding-box encoder,
+// which skips the principal axis and the refinement (and is ~1.2 dB worse). The endpoint fitting is
+// scalar float code, and the speedup with more threads hasn't been measured.
+//
+// BC5 is core since 3.0 and BC7 since 4.2; BC1/BC3 need EXT_texture_compression_s3tc, which every
+// desktop driver has but the core profile doesn't promise, so check Supported before uploading.
+//
+//   CompressedTexture cooked = CompressedTexture::Cook(rgba, width, height, BlockCompression::BC7);
+//   cooked.WriteDDS("container.dds");
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+class BlockCompression
+{
+public:
+    enum Format
+    {
+        BC1,
+        BC3,
+        BC5,
+        BC7
+    };
+
+    static const char* Name(Format format)
+    {
+        static const char* names[] = { "BC1", "BC3", "BC5", "BC7" };
+        return names[format];
+    }
+
+    static int BlockBytes(Format format) { return format == BC1 ? 8 : 16; }
+
+    static size_t LevelSize(Format format, int width, int height)
+    {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    static GLenum InternalFormat(Format format)
+    {
+        switch (format)
+        {
+        case BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BC5: return GL_COMPRESSED_RG_RGTC2;
+        default:  return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    // needs a current context
+    static bool Supported(Format format)
+    {
+        switch (format)
+        {
+        case BC1: case BC3: return hasExtension("GL_EXT_texture_compression_s3tc");
+        case BC5:           return true;
+        default:            return GLAD_GL_VERSION_4_2 || hasExtension("GL_ARB_texture_compression_bptc");
+        }
+    }
+
+    // rgba: the 16 texels of the block, row by row
+    static void EncodeBlock(Format format, const unsigned char rgba[64], unsigned char* out)
+    {
+        unsigned char channel[16];
+        switch (format)
+        {
+        case BC1:
+            encodeColor(rgba, out);
+            break;
+        case BC3:
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4 + 3];
+            encodeChannel(channel, out);
+            encodeColor(rgba, out + 8);
+            break;
+        case BC5:
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4 + 0];
+            encodeChannel(channel, out);
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4 + 1];
+            encodeChannel(channel, out + 8);
+            break;
+        default:
+            encodeMode6(rgba, out);
+            break;
+        }
+    }
+
+    // false if the block can't be decoded (a BC7 mode other than 6); it's then filled with black
+    static bool DecodeBlock(Format format, const unsigned char* in, unsigned char rgba[64])
+    {
+        unsigned char channel[16];
+        switch (format)
+        {
+        case BC1:
+            decodeColor(in, rgba, false);
+            return true;
+        case BC3:
+            decodeColor(in + 8, rgba, true);
+            decodeChannel(in, channel);
+            for (int i = 0; i < 16; ++i) rgba[i * 4 + 3] = channel[i];
+            return true;
+        case BC5:
+            decodeChannel(in, channel);
+            for (int i = 0; i < 16; ++i) rgba[i * 4 + 0] = channel[i];
+            decodeChannel(in + 8, channel);
+            for (int i = 0; i < 16; ++i)
+            {
+                rgba[i * 4 + 1] = channel[i];
+                rgba[i * 4 + 2] = 0;
+                rgba[i * 4 + 3] = 255;
+            }
+            return true;
+        default:
+            return decodeMode6(in, rgba);
+        }
+    }
+
+    // rgba: width * height RGBA8 texels; edge blocks repeat the last row/column
+    static std::vector<unsigned char> Compress(Format format, const unsigned char* rgba, int width, int height,
+                                               unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        std::vector<unsigned char> out(LevelSize(format, width, height));
+        int bytes = BlockBytes(format);
+        auto encodeRows = [&](int first, int step)
+        {
+            unsigned char block[64];
+            for (int by = first; by < blocksY; by += step)
+                for (int bx = 0; bx < blocksX; ++bx)
+                {
+                    for (int y = 0; y < 4; ++y)
+                        for (int x = 0; x < 4; ++x)
+                        {
+                            int sx = std::min(bx * 4 + x, width - 1), sy = std::min(by * 4 + y, height - 1);
+                            memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+                        }
+                    EncodeBlock(format, block, out.data() + ((size_t)by * blocksX + bx) * bytes);
+                }
+        };
+        // small mip levels aren't worth a thread each
+        unsigned int threads = std::max(1u, std::min(threadCount, (unsigned int)blocksY / 4));
+        if (threads == 1)
+        {
+            encodeRows(0, 1);
+            return out;
+        }
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; ++t)
+            workers.emplace_back(encodeRows, (int)t, (int)threads);
+        for (std::thread& worker : workers)
+            worker.join();
+        return out;
+    }
+
+    // back to RGBA8; false if some block couldn't be decoded
+    static bool Decompress(Format format, const unsigned char* data, int width, int height, std::vector<unsigned char>& rgba)
+    {
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        rgba.assign((size_t)width * height * 4, 0);
+        bool decoded = true;
+        unsigned char block[64];
+        for (int by = 0; by < blocksY; ++by)
+            for (int bx = 0; bx < blocksX; ++bx)
+            {
+                decoded &= DecodeBlock(format, data + ((size_t)by * blocksX + bx) * BlockBytes(format), block);
+                for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+                    for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+                        memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], block + (y * 4 + x) * 4, 4);
+            }
+        return decoded;
+    }
+
+    // next mip level of an RGBA8 image (2x2 box filter); normal maps are renormalized instead of just averaged
+    static std::vector<unsigned char> Downsample(const unsigned char* rgba, int width, int height, bool normalMap = false)
+    {
+        int w = std::max(1, width / 2), h = std::max(1, height / 2);
+        std::vector<unsigned char> out((size_t)w * h * 4);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for (int dy = 0; dy < 2; ++dy)
+                    for (int dx = 0; dx < 2; ++dx)
+                    {
+                        const unsigned char* texel = rgba + ((size_t)std::min(y * 2 + dy, height - 1) * width + std::min(x * 2 + dx, width - 1)) * 4;
+                        for (int c = 0; c < 4; ++c)
+                            sum[c] += normalMap && c < 3 ? texel[c] / 127.5f - 1.0f : texel[c];
+                    }
+                unsigned char* texel = &out[((size_t)y * w + x) * 4];
+                if (normalMap)
+                {
+                    float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                    for (int c = 0; c < 3; ++c)
+                        texel[c] = (unsigned char)std::lround((length > 0.0f ? sum[c] / length : (c == 2 ? 1.0f : 0.0f)) * 127.5f + 127.5f);
+                }
+                for (int c = normalMap ? 3 : 0; c < 4; ++c)
+                    texel[c] = (unsigned char)std::lround(sum[c] / 4.0f);
+            }
+        return out;
+    }
+
+private:
+    static bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension && strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // unit length principal axis of the points (power iteration on the covariance matrix); mean is filled in as well
+    template <int N>
+    static void principalAxis(const float points[16][4], float mean[N], float axis[N])
+    {
+        for (int c = 0; c < N; ++c)
+        {
+            mean[c] = 0.0f;
+            for (int i = 0; i < 16; ++i)
+                mean[c] += points[i][c];
+            mean[c] /= 16.0f;
+        }
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int a = 0; a < N; ++a)
+                for (int b = 0; b < N; ++b)
+                    covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+        for (int c = 0; c < N; ++c)
+            axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[N] = {};
+            float length = 0.0f;
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b)
+                    next[a] += covariance[a][b] * axis[b];
+                length = std::max(length, std::fabs(next[a]));
+            }
+            if (length == 0.0f)
+                break;
+            for (int c = 0; c < N; ++c)
+                axis[c] = next[c] / length;
+        }
+        float length = 0.0f;
+        for (int c = 0; c < N; ++c)
+            length += axis[c] * axis[c];
+        length = std::sqrt(length);
+        for (int c = 0; c < N; ++c)
+            axis[c] /= length;
+    }
+
+    // endpoints at the extremes of the points' projections on the principal axis
+    template <int N>
+    static void fitLine(const float points[16][4], float low[4], float high[4])
+    {
+        float mean[N], axis[N];
+        principalAxis<N>(points, mean, axis);
+        float minimum = 1e30f, maximum = -1e30f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; ++c)
+                t += (points[i][c] - mean[c]) * axis[c];
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+        for (int c = 0; c < N; ++c)
+        {
+            low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minimum));
+            high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maximum));
+        }
+    }
+
+    // endpoints minimizing the squared error for fixed interpolation weights (of the second endpoint)
+    template <int N>
+    static bool leastSquares(const float points[16][4], const float weight[16], float low[4], float high[4])
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            float b = weight[i], a = 1.0f - b;
+            aa += a * a; ab += a * b; bb += b * b;
+            for (int c = 0; c < N; ++c)
+            {
+                ax[c] += a * points[i][c];
+                bx[c] += b * points[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int c = 0; c < N; ++c)
+        {
+            low[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+            high[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+        }
+        return true;
+    }
+
+    // index of the closest palette entry (squared distance over the first `channels` channels) for every
+    // texel of the block; returns the summed error. Ties go to the lower index on both paths.
+    static int nearest(const unsigned char rgba[64], const int palette[][4], int count, int channels, unsigned char indices[16])
+    {
+#ifdef BLOCK_COMPRESSION_SSE2
+        // two texels per register as 16 bit r, g, b, a; each texel's four squared differences are summed
+        // with madd + one shuffle, four texels are compared against one palette entry at a time
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i mask = channels == 4 ? _mm_set1_epi32(-1) : _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        __m128i texels[8], entries[16];
+        for (int i = 0; i < 8; ++i)
+            texels[i] = _mm_and_si128(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rgba + i * 8)), zero), mask);
+        for (int p = 0; p < count; ++p)
+            entries[p] = _mm_and_si128(_mm_set_epi16((short)palette[p][3], (short)palette[p][2], (short)palette[p][1], (short)palette[p][0],
+                                                     (short)palette[p][3], (short)palette[p][2], (short)palette[p][1], (short)palette[p][0]), mask);
+        auto distances = [](__m128i pair, __m128i entry)
+        {
+            __m128i d = _mm_sub_epi16(pair, entry);
+            __m128i squares = _mm_madd_epi16(d, d); // r²+g², b²+a² of both texels
+            return _mm_add_epi32(squares, _mm_shuffle_epi32(squares, _MM_SHUFFLE(2, 3, 0, 1)));
+        };
+        int error = 0;
+        for (int group = 0; group < 4; ++group)
+        {
+            __m128i bestError = _mm_set1_epi32(0x7FFFFFFF), bestIndex = zero;
+            for (int p = 0; p < count; ++p)
+            {
+                __m128i first = distances(texels[group * 2], entries[p]), second = distances(texels[group * 2 + 1], entries[p]);
+                __m128i e = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(first), _mm_castsi128_ps(second), _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i better = _mm_cmplt_epi32(e, bestError);
+                bestError = _mm_or_si128(_mm_and_si128(better, e), _mm_andnot_si128(better, bestError));
+                bestIndex = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(p)), _mm_andnot_si128(better, bestIndex));
+            }
+            alignas(16) int errors[4], best[4];
+            _mm_store_si128((__m128i*)errors, bestError);
+            _mm_store_si128((__m128i*)best, bestIndex);
+            for (int k = 0; k < 4; ++k)
+            {
+                indices[group * 4 + k] = (unsigned char)best[k];
+                error += errors[k];
+            }
+        }
+        return error;
+#else
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < count; ++p)
+            {
+                int e = 0;
+                for (int c = 0; c < channels; ++c)
+                {
+                    int d = (int)rgba[i * 4 + c] - palette[p][c];
+                    e += d * d;
+                }
+                if (e < bestError)
+                {
+                    bestError = e;
+                    best = p;
+                }
+            }
+            indices[i] = (unsigned char)best;
+            error += bestError;
+        }
+        return error;
+#endif
+    }
+
+    // BC1 -------------------------------------------------------------------------------------
+
+    static unsigned short to565(const float color[4])
+    {
+        int r = (int)std::lround(color[0] * 31.0f / 255.0f), g = (int)std::lround(color[1] * 63.0f / 255.0f), b = (int)std::lround(color[2] * 31.0f / 255.0f);
+        return (unsigned short)((r << 11) | (g << 5) | b);
+    }
+
+    static void from565(unsigned short color, int rgb[3])
+    {
+        int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // four colour palette of endpoints c0, c1; returns the squared error and fills the indices
+    static int colorIndices(const unsigned char rgba[64], unsigned short c0, unsigned short c1, unsigned char indices[16])
+    {
+        int palette[4][4] = {}, a[3], b[3];
+        from565(c0, a);
+        from565(c1, b);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[0][c] = a[c];
+            palette[1][c] = b[c];
+            palette[2][c] = (2 * a[c] + b[c]) / 3;
+            palette[3][c] = (a[c] + 2 * b[c]) / 3;
+        }
+        return nearest(rgba, palette, 4, 3, indices);
+    }
+
+    static void encodeColor(const unsigned char rgba[64], unsigned char* out)
+    {
+        float points[16][4];
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 4; ++c)
+                points[i][c] = rgba[i * 4 + c];
+        float low[4], high[4];
+        fitLine<3>(points, low, high);
+
+        unsigned short c0 = to565(high), c1 = to565(low);
+        unsigned char indices[16];
+        int error = colorIndices(rgba, c0, c1, indices);
+        // palette index -> weight of c1
+        static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+        {
+            float weight[16];
+            for (int i = 0; i < 16; ++i)
+                weight[i] = weights[indices[i]];
+            if (!leastSquares<3>(points, weight, high, low))
+                break;
+            unsigned short r0 = to565(high), r1 = to565(low);
+            unsigned char refined[16];
+            int refinedError = colorIndices(rgba, r0, r1, refined);
+            if (refinedError >= error)
+                break;
+            c0 = r0; c1 = r1; error = refinedError;
+            memcpy(indices, refined, 16);
+        }
+
+        // c0 > c1 selects the four colour mode; swapping the endpoints swaps indices 0/1 and 2/3
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+            for (int i = 0; i < 16; ++i)
+                indices[i] ^= 1;
+        }
+        else if (c0 == c1)
+            memset(indices, 0, 16);
+        unsigned int bits = 0;
+        for (int i = 0; i < 16; ++i)
+            bits |= (unsigned int)indices[i] << (i * 2);
+        out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+        for (int i = 0; i < 4; ++i)
+            out[4 + i] = (bits >> (i * 8)) & 0xFF;
+    }
+
+    // fourColor: BC3's colour block always uses the four colour palette
+    static void decodeColor(const unsigned char* in, unsigned char rgba[64], bool fourColor)
+    {
+        unsigned short c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+        int palette[4][4], a[3], b[3];
+        from565(c0, a);
+        from565(c1, b);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[0][c] = a[c];
+            palette[1][c] = b[c];
+            if (fourColor || c0 > c1)
+            {
+                palette[2][c] = (2 * a[c] + b[c]) / 3;
+                palette[3][c] = (a[c] + 2 * b[c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (a[c] + b[c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        palette[3][3] = fourColor || c0 > c1 ? 255 : 0;
+        unsigned int bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((unsigned int)in[7] << 24);
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 4; ++c)
+                rgba[i * 4 + c] = (unsigned char)palette[(bits >> (i * 2)) & 3][c];
+    }
+
+    // BC4 (one channel, also BC3's alpha and BC5's two channels) --------------------------------
+
+    static void channelPalette(int a0, int a1, int palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1)
+            for (int i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        else
+        {
+            for (int i = 1; i < 5; ++i)
+                palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    static void encodeChannel(const unsigned char values[16], unsigned char* out)
+    {
+        int minimum = 255, maximum = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            minimum = std::min(minimum, (int)values[i]);
+            maximum = std::max(maximum, (int)values[i]);
+        }
+        // eight value mode between the extremes
+        int palette[8];
+        channelPalette(maximum, minimum, palette);
+        unsigned long long bits = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; ++p)
+            {
+                int e = std::abs((int)values[i] - palette[p]);
+                if (e < bestError)
+                {
+                    bestError = e;
+                    best = p;
+                }
+            }
+            bits |= (unsigned long long)best << (i * 3);
+        }
+        out[0] = (unsigned char)maximum;
+        out[1] = (unsigned char)minimum;
+        for (int i = 0; i < 6; ++i)
+            out[2 + i] = (bits >> (i * 8)) & 0xFF;
+    }
+
+    static void decodeChannel(const unsigned char* in, unsigned char values[16])
+    {
+        int palette[8];
+        channelPalette(in[0], in[1], palette);
+        unsigned long long bits = 0;
+        for (int i = 0; i < 6; ++i)
+            bits |= (unsigned long long)in[2 + i] << (i * 8);
+        for (int i = 0; i < 16; ++i)
+            values[i] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+    }
+
+    // BC7 mode 6 --------------------------------------------------------------------------------
+
+    static const int* mode6Weights()
+    {
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        return weights;
+    }
+
+    // 7 bit endpoint + shared p-bit (the endpoint's lowest bit), the p-bit that fits the endpoint best
+    static void quantizeMode6(const float endpoint[4], int quantized[4], int& pbit)
+    {
+        pbit = 0;
+        memset(quantized, 0, 4 * sizeof(int));
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; ++p)
+        {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                candidate[c] = std::min(127, std::max(0, (int)std::lround((endpoint[c] - p) / 2.0f)));
+                float d = (float)((candidate[c] << 1) | p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbit = p;
+                memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    static int mode6Indices(const unsigned char rgba[64], const int e0[4], int p0, const int e1[4], int p1, unsigned char indices[16])
+    {
+        int palette[16][4];
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 4; ++c)
+            {
+                int a = (e0[c] << 1) | p0, b = (e1[c] << 1) | p1;
+                palette[i][c] = ((64 - mode6Weights()[i]) * a + mode6Weights()[i] * b + 32) >> 6;
+            }
+        return nearest(rgba, palette, 16, 4, indices);
+    }
+
+    static void encodeMode6(const unsigned char rgba[64], unsigned char* out)
+    {
+        float points[16][4];
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 4; ++c)
+                points[i][c] = rgba[i * 4 + c];
+        float low[4], high[4];
+        fitLine<4>(points, low, high);
+
+        int e0[4], e1[4], p0, p1;
+        quantizeMode6(low, e0, p0);
+        quantizeMode6(high, e1, p1);
+        unsigned char indices[16];
+        int error = mode6Indices(rgba, e0, p0, e1, p1, indices);
+        for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+        {
+            float weight[16];
+            for (int i = 0; i < 16; ++i)
+                weight[i] = mode6Weights()[indices[i]] / 64.0f;
+            if (!leastSquares<4>(points, weight, low, high))
+                break;
+            int r0[4], r1[4], q0, q1;
+            quantizeMode6(low, r0, q0);
+            quantizeMode6(high, r1, q1);
+            unsigned char refined[16];
+            int refinedError = mode6Indices(rgba, r0, q0, r1, q1, refined);
+            if (refinedError >= error)
+                break;
+            memcpy(e0, r0, sizeof(r0)); memcpy(e1, r1, sizeof(r1));
+            p0 = q0; p1 = q1; error = refinedError;
+            memcpy(indices, refined, 16);
+        }
+
+        // the first index is stored with 3 bits, so its top bit must be 0: swap the endpoints if it isn't
+        if (indices[0] & 8)
+        {
+            std::swap(e0, e1);
+            std::swap(p0, p1);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = 15 - indices[i];
+        }
+
+        unsigned long long bits[2] = { 0, 0 };
+        int position = 0;
+        auto write = [&](unsigned long long value, int count)
+        {
+            for (int i = 0; i < count; ++i, ++position)
+                bits[position / 64] |= ((value >> i) & 1ull) << (position % 64);
+        };
+        write(1ull << 6, 7); // mode 6
+        for (int c = 0; c < 4; ++c)
+        {
+            write(e0[c], 7);
+            write(e1[c], 7);
+        }
+        write(p0, 1);
+        write(p1, 1);
+        for (int i = 0; i < 16; ++i)
+            write(indices[i], i == 0 ? 3 : 4);
+        for (int i = 0; i < 16; ++i)
+            out[i] = (bits[i / 8] >> ((i % 8) * 8)) & 0xFF;
+    }
+
+    static bool decodeMode6(const unsigned char* in, unsigned char rgba[64])
+    {
+        unsigned long long bits[2] = { 0, 0 };
+        for (int i = 0; i < 16; ++i)
+            bits[i / 8] |= (unsigned long long)in[i] << ((i % 8) * 8);
+        if ((bits[0] & 0x7F) != 0x40)
+        {
+            memset(rgba, 0, 64);
+            return false;
+        }
+        int position = 7;
+        auto read = [&](int count)
+        {
+            int value = 0;
+            for (int i = 0; i < count; ++i, ++position)
+                value |= (int)((bits[position / 64] >> (position % 64)) & 1ull) << i;
+            return value;
+        };
+        int e0[4], e1[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            e0[c] = read(7);
+            e1[c] = read(7);
+        }
+        int p0 = read(1), p1 = read(1);
+        for (int i = 0; i < 16; ++i)
+        {
+            int index = read(i == 0 ? 3 : 4), weight = mode6Weights()[index];
+            for (int c = 0; c < 4; ++c)
+            {
+                int a = (e0[c] << 1) | p0, b = (e1[c] << 1) | p1;
+                rgba[i * 4 + c] = (unsigned char)(((64 - weight) * a + weight * b + 32) >> 6);
+            }
+        }
+        return true;
+    }
+};
+
+// a block compressed texture with its mip chain, as cooked offline and stored in a DDS file
+class CompressedTexture
+{
+public:
+    BlockCompression::Format Format = BlockCompression::BC1;
+    int Width = 0, Height = 0;
+    // all levels back to back; Offsets[level] is where each starts in Bytes() (past the header when read from a file)
+    std::vector<unsigned char> Data;
+    std::vector<size_t> Offsets;
+
+    // Data for cooked textures, the memory mapped file for ones read with ReadDDS
+    const unsigned char* Bytes() const { return mapped ? mapped->Data : Data.data(); }
+    size_t ByteCount() const { return mapped ? mapped->Size : Data.size(); }
+    int Levels() const { return (int)Offsets.size(); }
+    int LevelWidth(int level) const { return std::max(1, Width >> level); }
+    int LevelHeight(int level) const { return std::max(1, Height >> level); }
+    size_t LevelSize(int level) const { return BlockCompression::LevelSize(Format, LevelWidth(level), LevelHeight(level)); }
+    const unsigned char* Level(int level) const { return Bytes() + Offsets[level]; }
+
+    // compresses an RGBA8 image and (mipmaps) every level of its mip chain down to 1x1
+    static CompressedTexture Cook(const unsigned char* rgba, int width, int height, BlockCompression::Format format,
+                                  bool mipmaps = true, bool normalMap = false,
+                                  unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        CompressedTexture texture;
+        texture.Format = format;
+        texture.Width = width;
+        texture.Height = height;
+        std::vector<unsigned char> level;
+        const unsigned char* source = rgba;
+        int w = width, h = height;
+        while (true)
+        {
+            std::vector<unsigned char> blocks = BlockCompression::Compress(format, source, w, h, threadCount);
+            texture.Offsets.push_back(texture.Data.size());
+            texture.Data.insert(texture.Data.end(), blocks.begin(), blocks.end());
+            if (!mipmaps || (w == 1 && h == 1))
+                break;
+            level = BlockCompression::Downsample(source, w, h, normalMap);
+            source = level.data();
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+        return texture;
+    }
+
+    // BC1/BC3 as DXT1/DXT5 (readable by anything), BC5/BC7 with the DX10 header
+    bool WriteDDS(const std::string& path) const
+    {
+        unsigned int header[32] = {};
+        header[0] = fourCC("DDS ");
+        header[1] = 124;                                             // header size
+        header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;   // caps, height, width, pixel format, mip count, linear size
+        header[3] = Height;
+        header[4] = Width;
+        header[5] = (unsigned int)LevelSize(0);
+        header[7] = Levels();
+        header[19] = 32;                                             // pixel format size
+        header[20] = 0x4;                                            // DDPF_FOURCC
+        header[21] = Format == BlockCompression::BC1 ? fourCC("DXT1") : Format == BlockCompression::BC3 ? fourCC("DXT5") : fourCC("DX10");
+        header[27] = 0x1000 | (Levels() > 1 ? 0x400000 | 0x8 : 0);  // texture, mipmap, complex
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        file.write((const char*)header, sizeof(header));
+        if (header[21] == fourCC("DX10"))
+        {
+            unsigned int dx10[5] = { dxgiFormat(Format), 3, 0, 1, 0 }; // format, TEXTURE2D, flags, array size, alpha mode
+            file.write((const char*)dx10, sizeof(dx10));
+        }
+        size_t end = Offsets.empty() ? 0 : Offsets.back() + LevelSize(Levels() - 1);
+        file.write((const char*)Bytes() + (Offsets.empty() ? 0 : Offsets[0]), end - (Offsets.empty() ? 0 : Offsets[0]));
+        return (bool)file;
+    }
+
+    // turns every level upside down in place, for textures sampled like images loaded with
+    // stbi_set_flip_vertically_on_load: block rows are swapped and the texel rows inside each block
+    // reversed by permuting the index rows, so it's lossless. That only works when a level's rows fill
+    // whole blocks (height a multiple of 4, or a single block), and not for BC7, whose anchor index is
+    // tied to the top left texel; false, with nothing changed, if the texture can't be flipped.
+    bool FlipVertically()
+    {
+        if (Format == BlockCompression::BC7)
+            return false;
+        for (int level = 0; level < Levels(); ++level)
+            if (LevelHeight(level) > 4 && LevelHeight(level) % 4 != 0)
+                return false;
+        // the mapping is read-only: flip a private copy
+        if (mapped)
+        {
+            Data.assign(mapped->Data, mapped->Data + mapped->Size);
+            mapped.reset();
+        }
+        int blockBytes = BlockCompression::BlockBytes(Format);
+        for (int level = 0; level < Levels(); ++level)
+        {
+            // rows[r] is where row r of a block ends up; padding rows of a partial block stay put
+            int height = LevelHeight(level), filled = std::min(height, 4), rows[4];
+            for (int r = 0; r < 4; ++r)
+                rows[r] = r < filled ? filled - 1 - r : r;
+            int blockRows = (height + 3) / 4;
+            size_t rowBytes = (size_t)((LevelWidth(level) + 3) / 4) * blockBytes;
+            unsigned char* data = Data.data() + Offsets[level];
+            for (int y = 0; y < blockRows / 2; ++y)
+                std::swap_ranges(data + y * rowBytes, data + (y + 1) * rowBytes, data + (blockRows - 1 - y) * rowBytes);
+            for (size_t i = 0; i < rowBytes * blockRows; i += blockBytes)
+            {
+                if (Format == BlockCompression::BC1)
+                    flipColourRows(data + i, rows);
+                else if (Format == BlockCompression::BC3)
+                {
+                    flipChannelRows(data + i, rows);
+                    flipColourRows(data + i + 8, rows);
+                }
+                else
+                {
+                    flipChannelRows(data + i, rows);
+                    flipChannelRows(data + i + 8, rows);
+                }
+            }
+        }
+        return true;
+    }
+
+    // the file is memory mapped and the levels point into the mapping, so the upload reads the pages
+    // straight from the page cache; false if it isn't a DDS file of one of the four formats
+    bool ReadDDS(const std::string& path)
+    {
+        Data.clear();
+        Offsets.clear();
+        mapped = std::make_shared<MappedFile>(path.c_str());
+        if (mapped->Size < 128)
+        {
+            mapped.reset();
+            return false;
+        }
+        const unsigned char* bytes = mapped->Data;
+        unsigned int header[32];
+        memcpy(header, bytes, sizeof(header));
+        if (header[0] != fourCC("DDS ") || header[1] != 124 || !(header[20] & 0x4))
+            return false;
+        size_t offset = 128;
+        unsigned int code = header[21];
+        if (code == fourCC("DXT1"))
+            Format = BlockCompression::BC1;
+        else if (code == fourCC("DXT5"))
+            Format = BlockCompression::BC3;
+        else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+            Format = BlockCompression::BC5;
+        else if (code == fourCC("DX10") && mapped->Size >= 148)
+        {
+            unsigned int dxgi;
+            memcpy(&dxgi, bytes + 128, sizeof(dxgi));
+            offset += 20;
+            if (dxgi == 71 || dxgi == 72)
+                Format = BlockCompression::BC1;
+            else if (dxgi == 77 || dxgi == 78)
+                Format = BlockCompression::BC3;
+            else if (dxgi == 83)
+                Format = BlockCompression::BC5;
+            else if (dxgi == 98 || dxgi == 99)
+                Format = BlockCompression::BC7;
+            else
+                return false;
+        }
+        else
+            return false;
+        // the sizes come from the file: keep them small enough that LevelSize can't overflow, and the
+        // mip count within the chain down to 1x1 (a bogus count would otherwise loop for billions of levels)
+        Offsets.clear();
+        if (header[3] == 0 || header[4] == 0 || header[3] > MAX_SIZE || header[4] > MAX_SIZE)
+            return false;
+        Width = (int)header[4];
+        Height = (int)header[3];
+        int fullChain = 1;
+        while ((std::max(Width, Height) >> fullChain) > 0)
+            ++fullChain;
+        int levels = 1;
+        if (header[2] & 0x20000)
+        {
+            if (header[7] == 0)
+                return false;
+            levels = (int)std::min<unsigned int>(header[7], fullChain);
+        }
+        for (int level = 0; level < levels; ++level)
+        {
+            Offsets.push_back(offset);
+            offset += LevelSize(level);
+        }
+        if (offset > mapped->Size)
+        {
+            Offsets.clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // shared, so copies of a texture read from a file keep the mapping alive
+    std::shared_ptr<MappedFile> mapped;
+
+    // largest width or height ReadDDS accepts (GL_MAX_TEXTURE_SIZE is 16384 on current hardware)
+    static const unsigned int MAX_SIZE = 1u << 16;
+
+    // BC1 colour block: 2 bit indices after the endpoints, one byte per row
+    static void flipColourRows(unsigned char* block, const int rows[4])
+    {
+        unsigned char indices[4];
+        memcpy(indices, block + 4, 4);
+        for (int r = 0; r < 4; ++r)
+            block[4 + rows[r]] = indices[r];
+    }
+
+    // BC4 block (BC3 alpha, BC5 channels): 3 bit indices after the endpoints, 12 bits per row
+    static void flipChannelRows(unsigned char* block, const int rows[4])
+    {
+        unsigned long long indices = 0, flipped = 0;
+        for (int i = 0; i < 6; ++i)
+            indices |= (unsigned long long)block[2 + i] << (8 * i);
+        for (int r = 0; r < 4; ++r)
+            flipped |= ((indices >> (12 * r)) & 0xFFF) << (12 * rows[r]);
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = (unsigned char)(flipped >> (8 * i));
+    }
+
+    static unsigned int fourCC(const char* code)
+    {
+        return (unsigned int)code[0] | ((unsigned int)code[1] << 8) | ((unsigned int)code[2] << 16) | ((unsigned int)code[3] << 24);
+    }
+
+    static unsigned int dxgiFormat(BlockCompression::Format format)
+    {
+        switch (format)
+        {
+        case BlockCompression::BC1: return 71;
+        case BlockCompression::BC3: return 77;
+        case BlockCompression::BC5: return 83;
+        default:                    return 98;
+        }
+    }
+};
+
+#endif
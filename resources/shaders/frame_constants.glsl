@@ -0,0 +1,17 @@
+// Per-frame / per-view constants, written once per view by FrameConstants (frame_constants.h)
+// and bound at FrameConstants::BINDING. Shaders loaded without ShaderPreprocessor paste this block.
+// #include "frame_constants.glsl" (found through ShaderPreprocessor::IncludeDirs)
+#pragma once
+
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 cameraPosition; // xyz
+    vec4 screenSize;     // width, height, 1 / width, 1 / height
+    vec4 time;           // seconds, delta seconds, frame number
+} frame;
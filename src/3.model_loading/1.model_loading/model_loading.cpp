@@ -10,12 +10,17 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+bool testRangeAllocator(unsigned int operations);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -31,8 +36,12 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char *argv[])
 {
+    // headless check of the MeshPool's free list: model_loading --allocator-test [operations]
+    if (argc > 1 && strcmp(argv[1], "--allocator-test") == 0)
+        return testRangeAllocator(argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 100000) ? 0 : 1;
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -213,6 +222,14 @@ int main()
     // -----------
     //Model ourModel(FileSystem::getPath("resources/objects/backpack/backpack.obj"));
     Model ourModel(FileSystem::getPath("resources/objects/nanosuit/nanosuit.obj"));
+
+    // all meshes share one vertex/index buffer and VAO, the model is drawn with one multi-draw per material
+    MeshPool<Vertex> meshPool(Mesh::DescribeVertex);
+    meshPool.Create(1 << 16, 1 << 18);
+    unsigned int meshDraws = ourModel.DrawCalls();
+    ourModel.UsePool(meshPool);
+    std::cout << ourModel.meshes.size() << " meshes: " << meshDraws << " draw calls per frame -> " << ourModel.DrawCalls()
+              << (GLAD_GL_VERSION_4_3 ? " indirect multi-draws" : " multi-draws") << std::endl;
     
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -277,6 +294,7 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    meshPool.Destroy();
     glfwTerminate();
     return 0;
 }
@@ -336,3 +354,74 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
+
+// random Allocate/Free (and Grow when full) against a per-element ownership map: no two live ranges may overlap,
+// Used must match, and once everything is freed the free list must have merged back into one block
+bool testRangeAllocator(unsigned int operations)
+{
+    struct Block { unsigned int offset, size; };
+    std::mt19937 random(1);
+    RangeAllocator allocator(4096);
+    std::vector<int> owner(allocator.Capacity(), -1);
+    std::vector<Block> live;
+    unsigned int used = 0;
+    auto fail = [](const char* message, unsigned int operation)
+    {
+        std::cout << "RangeAllocator: FAILED at operation " << operation << ": " << message << std::endl;
+        return false;
+    };
+    for (unsigned int operation = 0; operation < operations; ++operation)
+    {
+        if (random() % 100 < 55 || live.empty())
+        {
+            unsigned int size = 1 + random() % 256;
+            unsigned int offset = allocator.Allocate(size);
+            if (offset == RangeAllocator::INVALID)
+            {
+                if (allocator.LargestFree() >= size)
+                    return fail("Allocate failed although a free block was large enough", operation);
+                // grow like MeshPool does when it runs out, the new space must merge with a trailing free block
+                if (allocator.Capacity() >= (1u << 20))
+                    continue;
+                allocator.Grow(allocator.Capacity() * 2);
+                owner.resize(allocator.Capacity(), -1);
+                offset = allocator.Allocate(size);
+                if (offset == RangeAllocator::INVALID)
+                    return fail("Allocate failed after Grow", operation);
+            }
+            if (offset + size > allocator.Capacity())
+                return fail("range past the capacity", operation);
+            for (unsigned int i = offset; i < offset + size; ++i)
+            {
+                if (owner[i] != -1)
+                    return fail("overlapping ranges", operation);
+                owner[i] = (int)live.size();
+            }
+            live.push_back({ offset, size });
+            used += size;
+        }
+        else
+        {
+            unsigned int index = random() % live.size();
+            Block block = live[index];
+            allocator.Free(block.offset, block.size);
+            for (unsigned int i = block.offset; i < block.offset + block.size; ++i)
+                owner[i] = -1;
+            // keep owner ids equal to positions in live
+            live[index] = live.back();
+            live.pop_back();
+            if (index < live.size())
+                for (unsigned int i = live[index].offset; i < live[index].offset + live[index].size; ++i)
+                    owner[i] = (int)index;
+            used -= block.size;
+        }
+        if (allocator.Used() != used)
+            return fail("Used doesn't match the live ranges", operation);
+    }
+    for (const Block& block : live)
+        allocator.Free(block.offset, block.size);
+    if (allocator.Used() != 0 || allocator.FreeBlocks() != 1 || allocator.LargestFree() != allocator.Capacity())
+        return fail("free list didn't merge back into one block", operations);
+    std::cout << "RangeAllocator: OK, " << operations << " operations, capacity " << allocator.Capacity() << std::endl;
+    return true;
+}
@@ -10,14 +10,21 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/render_queue.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
+void benchmarkSort(unsigned int count, unsigned int frames);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -33,8 +40,15 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char *argv[])
 {
+    // headless sort benchmark: blending_sorted --sort-benchmark [draws]
+    if (argc > 1 && strcmp(argv[1], "--sort-benchmark") == 0)
+    {
+        benchmarkSort(argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 100000, 100);
+        return 0;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -204,6 +218,21 @@ int main()
     shader.use();
     shader.setInt("texture1", 0);
 
+    // draws are collected in a render queue and sorted by state (opaque) or by distance (transparent)
+    RenderQueue queue;
+    RenderQueue::Draw cubeDraw;
+    cubeDraw.program = shader.ID;
+    cubeDraw.vertexArray = cubeVAO;
+    cubeDraw.texture = cubeTexture;
+    cubeDraw.count = 36;
+    RenderQueue::Draw floorDraw = cubeDraw;
+    floorDraw.vertexArray = planeVAO;
+    floorDraw.texture = floorTexture;
+    floorDraw.count = 6;
+    RenderQueue::Draw windowDraw = floorDraw;
+    windowDraw.vertexArray = transparentVAO;
+    windowDraw.texture = transparentTexture;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -218,14 +247,21 @@ int main()
         // -----
         processInput(window);
 
-        // sort the transparent windows before rendering
-        // ---------------------------------------------
-        std::map<float, glm::vec3> sorted; // 先排序
-        for (unsigned int i = 0; i < windows.size(); i++)
+        // submit the scene; windows at the same distance no longer overwrite each other like they did as std::map keys
+        // -----------------------------------------------------------------------------------------------------------
+        glm::vec3 cubePositions[] = { glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(2.0f, 0.0f, 0.0f) };
+        for (const glm::vec3& position : cubePositions)
         {
-            float distance = glm::length(camera.Position - windows[i]); // 按照与相机的距离
-            sorted[distance] = windows[i]; // std::map 红黑树是有序的  key是距离
+            cubeDraw.model = glm::translate(glm::mat4(1.0f), position);
+            queue.Submit(RenderQueue::OPAQUE_PASS, cubeDraw, glm::length(camera.Position - position));
         }
+        queue.Submit(RenderQueue::OPAQUE_PASS, floorDraw, 0.0f);
+        for (const glm::vec3& position : windows)
+        {
+            windowDraw.model = glm::translate(glm::mat4(1.0f), position);
+            queue.Submit(RenderQueue::TRANSPARENT_PASS, windowDraw, glm::length(camera.Position - position)); // 按照与相机的距离, 从远到近
+        }
+        queue.Sort();
 
         // render
         // ------
@@ -236,42 +272,12 @@ int main()
         shader.use();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
         shader.setMat4("projection", projection);
         shader.setMat4("view", view);
-        
-        
-        // cubes
-        glBindVertexArray(cubeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, cubeTexture);
-        model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-        shader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-        shader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        
-        
-        // floor
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        model = glm::mat4(1.0f);
-        shader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        
-        
-        // windows (from furthest to nearest)
-        glBindVertexArray(transparentVAO);
-        glBindTexture(GL_TEXTURE_2D, transparentTexture);
-        for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it) // reverse_iterator 反向迭代，从大到小/从远到近
-        {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, it->second); // it->second 其实对应的是 windows[i]
-            shader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);          // 注意这里渲染半透明物体的时候 没有关闭深度测试和深度写入(一般都关闭深度写入的)
-        }
+
+        // opaque first (blending off), then the windows from furthest to nearest without depth writes
+        queue.Execute();
+        queue.Clear();
 
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -286,6 +292,8 @@ int main()
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &planeVBO);
+    glDeleteVertexArrays(1, &transparentVAO);
+    glDeleteBuffers(1, &transparentVBO);
 
     glfwTerminate();
     return 0;
@@ -384,3 +392,43 @@ unsigned int loadTexture(char const * path)
 
     return textureID;
 }
+
+// sorts random draws (16 programs, 256 materials, 10% transparent) with the render queue's radix
+// sort and with std::stable_sort, and prints the average time per frame of each
+// ---------------------------------------------------------------------------------------------
+void benchmarkSort(unsigned int count, unsigned int frames)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distance(0.1f, 100.0f);
+    std::vector<RenderQueue::Entry> entries(count), radixSorted, stdSorted, scratch;
+    double radixTime = 0.0, stdTime = 0.0;
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            RenderQueue::Pass pass = random() % 10 == 0 ? RenderQueue::TRANSPARENT_PASS : RenderQueue::OPAQUE_PASS;
+            entries[i].key = RenderQueue::MakeKey(pass, 1 + random() % 16, 1 + random() % 256, distance(random));
+            entries[i].index = i;
+        }
+
+        radixSorted = entries;
+        auto start = std::chrono::high_resolution_clock::now();
+        RenderQueue::RadixSort(radixSorted, scratch);
+        auto middle = std::chrono::high_resolution_clock::now();
+        stdSorted = entries;
+        std::stable_sort(stdSorted.begin(), stdSorted.end(), [](const RenderQueue::Entry& a, const RenderQueue::Entry& b) { return a.key < b.key; });
+        auto end = std::chrono::high_resolution_clock::now();
+
+        radixTime += std::chrono::duration<double, std::milli>(middle - start).count();
+        stdTime += std::chrono::duration<double, std::milli>(end - middle).count();
+        for (unsigned int i = 0; i < count; ++i)
+            if (radixSorted[i].index != stdSorted[i].index)
+            {
+                std::cout << "ERROR::SORT_BENCHMARK: radix sort and std::stable_sort disagree at " << i << std::endl;
+                return;
+            }
+    }
+    std::cout << count << " draws, " << frames << " frames" << std::endl;
+    std::cout << "  radix sort:       " << radixTime / frames << " ms per frame" << std::endl;
+    std::cout << "  std::stable_sort: " << stdTime / frames << " ms per frame" << std::endl;
+}
@@ -10,6 +10,7 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/gl_resources.h>
 
 #include <iostream>
 
@@ -147,38 +148,28 @@ int main()
          1.0f,  1.0f,  1.0f, 1.0f
     };
     // cube VAO
-    unsigned int cubeVAO, cubeVBO;
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    GLBuffer cubeVertexBuffer, planeVertexBuffer, quadVertexBuffer;
+    GLVertexLayout cubeLayout, planeLayout, quadLayout;
+    cubeVertexBuffer.Create(sizeof(cubeVertices), cubeVertices);
+    cubeLayout.Create();
+    cubeLayout.Attribute(0, 0, 3, GL_FLOAT, 0);
+    cubeLayout.Attribute(1, 0, 2, GL_FLOAT, 3 * sizeof(float));
+    cubeLayout.VertexBuffer(0, cubeVertexBuffer, 0, 5 * sizeof(float));
+    unsigned int cubeVAO = cubeLayout.ID;
     // plane VAO
-    unsigned int planeVAO, planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    planeVertexBuffer.Create(sizeof(planeVertices), planeVertices);
+    planeLayout.Create();
+    planeLayout.Attribute(0, 0, 3, GL_FLOAT, 0);
+    planeLayout.Attribute(1, 0, 2, GL_FLOAT, 3 * sizeof(float));
+    planeLayout.VertexBuffer(0, planeVertexBuffer, 0, 5 * sizeof(float));
+    unsigned int planeVAO = planeLayout.ID;
     // screen quad VAO
-    unsigned int quadVAO, quadVBO;
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    quadVertexBuffer.Create(sizeof(quadVertices), quadVertices);
+    quadLayout.Create();
+    quadLayout.Attribute(0, 0, 2, GL_FLOAT, 0);
+    quadLayout.Attribute(1, 0, 2, GL_FLOAT, 2 * sizeof(float));
+    quadLayout.VertexBuffer(0, quadVertexBuffer, 0, 4 * sizeof(float));
+    unsigned int quadVAO = quadLayout.ID;
 
     // load textures
     // -------------
@@ -193,24 +184,18 @@ int main()
     screenShader.use();
     screenShader.setInt("screenTexture", 0);
 
-    // framebuffer configuration
+    // framebuffer configuration (nothing gets bound: the render loop binds the framebuffer when it draws into it)
     // -------------------------
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GLFramebuffer framebuffer;
+    framebuffer.Create();
     
     
     // create a color attachment texture  使用纹理作为颜色附件  使用rbo作为深度模板附件 (rbo不能读取 native格式 效率更加高)
-
-    unsigned int textureColorbuffer;
-    glGenTextures(1, &textureColorbuffer);
-    glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL); // 必须分配好了内存
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-#if 1
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-#endif
+    GLTexture colorbuffer;
+    colorbuffer.Create(GL_TEXTURE_2D, GL_RGB8, SCR_WIDTH, SCR_HEIGHT); // 必须分配好了内存 (immutable storage, size and format fixed)
+    colorbuffer.SetFilter(GL_LINEAR, GL_LINEAR);
+    framebuffer.Attach(GL_COLOR_ATTACHMENT0, colorbuffer);
+    unsigned int textureColorbuffer = colorbuffer.ID;
     // GL_FRAMEBUFFER_INCOMPLETE_DRAW_BUFFER​ 如果做阴影图 没有颜色附件 需要调用 glDrawBuffer(GL_NONE);
     
     /*
@@ -225,21 +210,13 @@ int main()
      
      */
     // create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT); // use a single renderbuffer object for both a depth AND stencil buffer.
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
+    framebuffer.AttachRenderbuffer(GL_DEPTH_STENCIL_ATTACHMENT, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT); // use a single renderbuffer object for both a depth AND stencil buffer.
     
     // now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER) ;
-    if (status!= GL_FRAMEBUFFER_COMPLETE)
+    if (!framebuffer.Complete())
     {
-        cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete! " << status << endl;
+        cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
     }
-       
-    // GLES3.0除了 GL_FRAMEBUFFER 还可以区分是 GL_FRAMEBUFFER_READ GL_FRAMEBUFFER_DRAW 但是2.0只有一个目标GL_FRAMEBUFFER
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // draw as wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -262,7 +239,7 @@ int main()
         // render
         // ------
         // bind to framebuffer and draw scene as we normally would to color texture 
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.ID);
         glEnable(GL_DEPTH_TEST); // enable depth testing (is disabled for rendering screen-space quad)
 
         // make sure we clear the framebuffer's content
@@ -315,12 +292,14 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteVertexArrays(1, &planeVAO);
-    glDeleteVertexArrays(1, &quadVAO);
-    glDeleteBuffers(1, &cubeVBO);
-    glDeleteBuffers(1, &planeVBO);
-    glDeleteBuffers(1, &quadVBO);
+    cubeLayout.Destroy();
+    planeLayout.Destroy();
+    quadLayout.Destroy();
+    cubeVertexBuffer.Destroy();
+    planeVertexBuffer.Destroy();
+    quadVertexBuffer.Destroy();
+    colorbuffer.Destroy();
+    framebuffer.Destroy();
 
     glfwTerminate();
     return 0;
@@ -14,6 +14,7 @@
 #include <iostream>
 
 #include "reflect_probe.h"
+#include "reflect_probe_manager.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -38,6 +39,7 @@ float lastFrame = 0.0f;
 
 Shader* p_modelShader = nullptr;
 Model*  p_ourModel = nullptr;
+Sphere* p_ourModelBounds = nullptr; // 模型的包围球 用于视锥体剔除
 
 // 天空盒相关
 unsigned int cubemapTexture = 0;
@@ -49,16 +51,28 @@ unsigned int cubeVAO = 0;
 unsigned int cubeVBO = 0;
 Shader* p_cubeShader = nullptr;
 
+// 反射探针相关  每个盒子中心放一个探针, 最右边的是静态探针(缓存到磁盘)
+const int CUBE_COUNT = 5;
+glm::vec3 cubePositions[CUBE_COUNT] = {
+    glm::vec3(-6.0f, 0.0f, 0.0f),
+    glm::vec3(-3.0f, 0.0f, 0.0f),
+    glm::vec3( 0.0f, 0.0f, 0.0f),
+    glm::vec3( 3.0f, 0.0f, 0.0f),
+    glm::vec3( 6.0f, 0.0f, 0.0f),
+};
+ReflectProbeManager* p_probeManager = nullptr;
 
-void drawScene(glm::mat4 & view , glm::mat4 & projection, glm::vec3& cameraPos, unsigned int reflectProbe)
+
+void drawScene(glm::mat4 & view , glm::mat4 & projection, glm::vec3& cameraPos, unsigned int reflectProbe, const Frustum* frustum)
 {
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     
+    if (frustum == nullptr || p_ourModelBounds->BoundingVolume::isOnFrustum(*frustum))
     {
-        // 渲染模型
+        // 渲染模型 (探针每个面只画在视锥体内的物体)
         p_modelShader->use();
      
         glm::mat4 model = glm::mat4(1.0f);
@@ -80,12 +94,10 @@ void drawScene(glm::mat4 & view , glm::mat4 & projection, glm::vec3& cameraPos,
  
     if (reflectProbe != 0)
     {
-        // 只有动态环境映射纹理 非空，才画盒子
+        // 只有不是渲染探针的时候，才画盒子
         // 相当于渲染动态环境纹理的时候 ，不画盒子
         
         p_cubeShader->use();
-        glm::mat4 model = glm::mat4(1.0f);
-        p_cubeShader->setMat4("model",      model);
         p_cubeShader->setMat4("view",       view);
         p_cubeShader->setMat4("projection", projection);
         p_cubeShader->setVec3("cameraPos",  cameraPos); // 传入相机的位置
@@ -93,9 +105,18 @@ void drawScene(glm::mat4 & view , glm::mat4 & projection, glm::vec3& cameraPos,
         // cubes
         glBindVertexArray(cubeVAO);
         glActiveTexture(GL_TEXTURE0);
-		//glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, reflectProbe);// 使用动态环境映射纹理 (这里纹理不包含二次反射，自己不会再别人的反射上)
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        for (int i = 0; i < CUBE_COUNT; i++)
+        {
+            Sphere cubeBounds(cubePositions[i], 0.87f); // 单位立方体的外接球
+            if (frustum != nullptr && !cubeBounds.BoundingVolume::isOnFrustum(*frustum))
+                continue;
+            
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+            p_cubeShader->setMat4("model", model);
+            //glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, p_probeManager->SelectProbeTexture(cubePositions[i], cubemapTexture));// 使用最近的动态环境映射纹理 (这里纹理不包含二次反射，自己不会再别人的反射上)
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
         glBindVertexArray(0);
     }
 
@@ -258,6 +279,7 @@ int main()
 
     // cube VAO
     p_ourModel = new Model { FileSystem::getPath("resources/objects/nanosuit_reflection/nanosuit.obj") } ;
+    p_ourModelBounds = new Sphere(generateSphereBV(*p_ourModel));
 
     // skybox VAO
     glGenVertexArrays(1, &skyboxVAO);
@@ -297,8 +319,14 @@ int main()
 	// 放在加载cubemap后面 
 	stbi_set_flip_vertically_on_load(true);
     
-    // 动态环境贴图 (反射探针)
-    ReflectProbe probe {1024};
+    // 动态环境贴图 (反射探针)  每帧最多更新2个面, 跟探针数量无关
+    ReflectProbeManager probeManager {2};
+    p_probeManager = &probeManager;
+    for (int i = 0; i < CUBE_COUNT - 1; i++)
+    {
+        probeManager.AddDynamicProbe(256, cubePositions[i]);
+    }
+    probeManager.AddStaticProbe(256, cubePositions[CUBE_COUNT - 1], "reflect_probe_static.cache");
 
     // render loop
     // -----------
@@ -314,16 +342,15 @@ int main()
         // -----
         processInput(window);
         
-        probe.DrawSceneToCubemap(drawScene);
-        
-        GLuint newCubemapTexture = probe.GetReflectProbeTexture();
+        probeManager.Update(camera.Position, drawScene);
         
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        const Frustum cameraFrustum = createFrustumFromCamera(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, glm::radians(camera.Zoom), 0.1f, 100.0f);
 
 		glBindFramebuffer(GL_FRAMEBUFFER, 0); // 注意! 必须设置viewport和绑定fbo=0
 		glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-        drawScene(view,  projection,  camera.Position, newCubemapTexture);
+        drawScene(view,  projection,  camera.Position, 1, &cameraFrustum); // reflectProbe非0: 画反射盒子
         
 
 
@@ -20,8 +20,13 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/entity.h>
 
 #include <iostream>
+#include <fstream>
+
+// 渲染场景的回调  frustum 是当前cubemap面的视锥体, 用来剔除场景中的物体 (nullptr 不剔除)
+typedef void (*DrawSceneFunc)(glm::mat4& view, glm::mat4& projection, glm::vec3& cameraPos, unsigned int reflectProbe, const Frustum* frustum);
 
 
 class ReflectProbe
@@ -36,9 +41,10 @@ private:
     Camera probeCamera{ glm::vec3(0.0f, 0.0f, 0.0f) };
     
 public:
-    ReflectProbe(int textureSize)
+    ReflectProbe(int textureSize, glm::vec3 position = glm::vec3(0.0f))
     {
         fboSize = textureSize;
+        probeCamera.Position = position;
         
         glGenTextures(1, &probeCubeTexId);
         glBindTexture(GL_TEXTURE_CUBE_MAP, probeCubeTexId);
@@ -92,7 +98,13 @@ public:
         
     }
     
-    void DrawSceneToCubemap( void(*_drawScene)(glm::mat4& view, glm::mat4& projection, glm::vec3& cameraPos, unsigned int _) )
+    void DrawSceneToCubemap(DrawSceneFunc _drawScene)
+    {
+        DrawFacesToCubemap(0, 6, _drawScene);
+    }
+    
+    // 只渲染cubemap的 [firstFace, firstFace + faceCount) 这几个面, 可以把6个面分摊到多帧 (时间切片)
+    void DrawFacesToCubemap(int firstFace, int faceCount, DrawSceneFunc _drawScene)
     {
         // camera可以调整焦距 或者 fov 来实现 缩放
         
@@ -123,7 +135,7 @@ public:
 		//static glm::vec3 Rights   = { glm::vec3{}, glm::vec3{}, glm::vec3{}, glm::vec3{}, glm::vec3{}, glm::vec3{}  };
 
 
-        for (int i = 0 ; i < 6 ; i++)
+        for (int i = firstFace ; i < firstFace + faceCount ; i++)
         {
             glBindFramebuffer(GL_FRAMEBUFFER, probeCubeFboIds[i]);
 			// windows上不能这样换的?  但是RenderDoc抓帧是正常的 
@@ -133,6 +145,7 @@ public:
             	
 			probeCamera.Front = s_Fronts[i];
 			probeCamera.Up    = s_Ups[i];
+			probeCamera.Right = glm::normalize(glm::cross(s_Fronts[i], s_Ups[i])); // 视锥体剔除要用到Right
 
             //probeCamera.Yaw   = s_Yaws[i] ;
             //probeCamera.Pitch = s_Pitchs[i];
@@ -140,7 +153,8 @@ public:
             
             // 渲染当前probe位置物体 以外的物体
             auto view = probeCamera.GetViewMatrix();
-            _drawScene(view, projection, probeCamera.Position, 0);
+            const Frustum faceFrustum = createFrustumFromCamera(probeCamera, radio, glm::radians(fov), 0.1f, 100.0f);
+            _drawScene(view, projection, probeCamera.Position, 0, &faceFrustum);
             
             //if (glInvalidateFramebuffer != nullptr)
             //{
@@ -182,6 +196,73 @@ public:
        
     }
     
+    glm::vec3 GetPosition() const
+    {
+        return probeCamera.Position;
+    }
+    
+    // 静态探针缓存到磁盘: 头部(魔数, 尺寸, 位置) + 6个面的RGB数据
+    // 位置或者尺寸不一致 就认为缓存失效
+    bool SaveToFile(const std::string& path)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            cout << "ERROR::REFLECT_PROBE:: Failed to write probe cache " << path << endl;
+            return false;
+        }
+        const unsigned int magic = 0x42525052; // "RPRB"
+        glm::vec3 position = probeCamera.Position;
+        file.write((const char*)&magic, sizeof(magic));
+        file.write((const char*)&fboSize, sizeof(fboSize));
+        file.write((const char*)&position, sizeof(position));
+        
+        std::vector<unsigned char> pixels(fboSize * fboSize * 3);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, probeCubeTexId);
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            file.write((const char*)pixels.data(), pixels.size());
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        return true;
+    }
+    
+    bool LoadFromFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        unsigned int magic = 0;
+        int size = 0;
+        glm::vec3 position;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&size, sizeof(size));
+        file.read((char*)&position, sizeof(position));
+        if (!file || magic != 0x42525052 || size != fboSize || position != probeCamera.Position)
+        {
+            return false;
+        }
+        
+        std::vector<unsigned char> pixels(fboSize * fboSize * 3);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, probeCubeTexId);
+        bool ok = true;
+        for (unsigned int i = 0; i < 6 && ok; i++)
+        {
+            ok = (bool)file.read((char*)pixels.data(), pixels.size());
+            if (ok)
+                glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, fboSize, fboSize, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return ok;
+    }
+    
     int GetReflectProbeTexture()
     {
         return probeCubeTexId; // 作为其他物体渲染的cubemap环境贴图(反射或者折射)
@@ -0,0 +1,158 @@
+//
+//  reflect_probe_manager.h
+//  LearnOpenGL
+//
+
+#ifndef reflect_probe_manager_h
+#define reflect_probe_manager_h
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <string>
+#include <vector>
+
+#include "reflect_probe.h"
+
+// 管理多个反射探针
+//
+// 1. 时间切片: 每帧最多只渲染 facesPerFrame 个cubemap面, 每帧的探针开销是常数, 跟探针数量无关
+// 2. 调度: 每个动态探针每帧累加 importance / (1 + 到相机的距离), 每次选累加值最大的探针渲染它的下一个面(轮询6个面),
+//         渲染后清零; 离相机越近, 越重要的探针更新越频繁
+// 3. 静态探针: 只渲染一次(同样分摊到多帧), 完成后缓存到磁盘, 下次启动直接加载, 不再更新
+// 4. 每个物体选择最近的探针
+class ReflectProbeManager
+{
+private:
+    struct ProbeSlot
+    {
+        ReflectProbe* probe = nullptr;
+        float importance = 1.0f;
+        bool isStatic = false;
+        bool ready = false;      // 静态探针: 6个面都已经渲染/加载
+        int nextFace = 0;        // 下一个要渲染的面
+        float priority = 0.0f;   // 调度用的累加值
+        std::string cachePath;   // 静态探针的磁盘缓存
+    };
+
+    std::vector<ProbeSlot> slots;
+    int facesPerFrame = 1;
+
+public:
+    ReflectProbeManager(int facesPerFrame) : facesPerFrame(facesPerFrame)
+    {
+    }
+
+    ~ReflectProbeManager()
+    {
+        for (auto& slot : slots)
+            delete slot.probe;
+    }
+
+    // 探针由manager持有(delete), 拷贝会导致重复释放
+    ReflectProbeManager(const ReflectProbeManager&) = delete;
+    ReflectProbeManager& operator=(const ReflectProbeManager&) = delete;
+
+    // 动态探针 每帧按优先级分摊更新
+    int AddDynamicProbe(int textureSize, glm::vec3 position, float importance = 1.0f)
+    {
+        ProbeSlot slot;
+        slot.probe = new ReflectProbe(textureSize, position);
+        slot.importance = importance;
+        slots.push_back(slot);
+        return (int)slots.size() - 1;
+    }
+
+    // 静态探针 先尝试从磁盘缓存加载, 失败的话渲染一次后写入缓存
+    int AddStaticProbe(int textureSize, glm::vec3 position, const std::string& cachePath)
+    {
+        ProbeSlot slot;
+        slot.probe = new ReflectProbe(textureSize, position);
+        slot.isStatic = true;
+        slot.cachePath = cachePath;
+        slot.ready = slot.probe->LoadFromFile(cachePath);
+        if (slot.ready)
+            cout << "ReflectProbeManager:: static probe loaded from cache " << cachePath << endl;
+        slots.push_back(slot);
+        return (int)slots.size() - 1;
+    }
+
+    // 每帧调用一次, 最多渲染 facesPerFrame 个面
+    void Update(const glm::vec3& cameraPos, DrawSceneFunc drawScene)
+    {
+        for (auto& slot : slots)
+        {
+            if (slot.isStatic)
+            {
+                // 还没有完成的静态探针 优先渲染
+                slot.priority = slot.ready ? -1.0f : FLT_MAX;
+            }
+            else
+            {
+                float distance = glm::length(slot.probe->GetPosition() - cameraPos);
+                slot.priority += slot.importance / (1.0f + distance);
+            }
+        }
+
+        for (int budget = 0; budget < facesPerFrame; ++budget)
+        {
+            ProbeSlot* best = nullptr;
+            for (auto& slot : slots)
+            {
+                if (slot.priority >= 0.0f && (best == nullptr || slot.priority > best->priority))
+                    best = &slot;
+            }
+            if (best == nullptr)
+                break;
+
+            best->probe->DrawFacesToCubemap(best->nextFace, 1, drawScene);
+            best->nextFace = (best->nextFace + 1) % 6;
+
+            if (best->isStatic)
+            {
+                if (best->nextFace == 0)
+                {
+                    best->ready = true;
+                    best->priority = -1.0f;
+                    best->probe->SaveToFile(best->cachePath);
+                }
+            }
+            else
+            {
+                best->priority = 0.0f;
+            }
+        }
+    }
+
+    // 离物体最近的探针的cubemap; 还没渲染完的静态探针不参与选择, 没有可用探针时返回fallback(比如天空盒)
+    unsigned int SelectProbeTexture(const glm::vec3& objectPos, unsigned int fallback = 0) const
+    {
+        unsigned int texture = fallback;
+        float nearest = FLT_MAX;
+        for (auto& slot : slots)
+        {
+            if (slot.isStatic && !slot.ready)
+                continue;
+            glm::vec3 offset = slot.probe->GetPosition() - objectPos;
+            float distance2 = glm::dot(offset, offset);
+            if (distance2 < nearest)
+            {
+                nearest = distance2;
+                texture = slot.probe->GetReflectProbeTexture();
+            }
+        }
+        return texture;
+    }
+
+    ReflectProbe* GetProbe(int index)
+    {
+        return slots[index].probe;
+    }
+
+    int GetProbeCount() const
+    {
+        return (int)slots.size();
+    }
+};
+
+#endif /* reflect_probe_manager_h */
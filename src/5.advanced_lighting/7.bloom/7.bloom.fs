@@ -17,7 +17,7 @@ struct Light {
 
 uniform Light lights[4]; //  setParamter("light[0].Postion", vec3)
 uniform sampler2D diffuseTexture;
-uniform vec3 viewPos;
+#include "frame_constants.glsl"
 
 void main()
 {           
@@ -29,7 +29,7 @@ void main()
 
     // lighting
     vec3 lighting = vec3(0.0);
-    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+    vec3 viewDir = normalize(frame.cameraPosition.xyz - fs_in.FragPos);
     for(int i = 0; i < 4; i++)
     {
         vec3 lightDir = normalize(lights[i].Position - fs_in.FragPos);
@@ -9,8 +9,8 @@ out VS_OUT {
     vec2 TexCoords;
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "frame_constants.glsl"
+
 uniform mat4 model;
 
 void main()
@@ -21,5 +21,5 @@ void main()
     mat3 normalMatrix = transpose(inverse(mat3(model)));
     vs_out.Normal = normalize(normalMatrix * aNormal);
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = frame.viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
 uniform float exposure;
+uniform float bloomStrength = 1.0;
 
 void main()
 {             
@@ -16,7 +17,7 @@ void main()
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
 
     if(bloom)
-        hdrColor += bloomColor; 
+        hdrColor += bloomColor * bloomStrength; 
 		// additive blending 模糊处理的图像和场景原来的HDR纹理 两个纹理进行混合
 
 
@@ -0,0 +1,102 @@
+#version 430 core
+
+// Compute version of 7.bloom_mip_downsample.fs: one invocation per destination texel,
+// the result is written with imageStore, no framebuffer or viewport changes per mip.
+// BLOOM_IMAGE_FORMAT (r11f_g11f_b10f / rgba16f) is defined by BloomRenderer to match the mip textures.
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform sampler2D srcTexture;
+uniform vec2 srcResolution;
+
+// which mip we are writing to, used for Karis average
+uniform int mipLevel = 1;
+
+layout (BLOOM_IMAGE_FORMAT, binding = 0) uniform writeonly image2D dstImage;
+
+vec3 PowVec3(vec3 v, float p)
+{
+    return vec3(pow(v.x, p), pow(v.y, p), pow(v.z, p));
+}
+
+const float invGamma = 1.0 / 2.2;
+vec3 ToSRGB(vec3 v)   { return PowVec3(v, invGamma); }
+
+float sRGBToLuma(vec3 col)
+{
+	return dot(col, vec3(0.299f, 0.587f, 0.114f));
+}
+
+float KarisAverage(vec3 col)
+{
+	// Formula is 1 / (1 + luma)
+	float luma = sRGBToLuma(ToSRGB(col)) * 0.25f;
+	return 1.0f / (1.0f + luma);
+}
+
+void main()
+{
+	ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 dstSize = imageSize(dstImage);
+	if (texelCoord.x >= dstSize.x || texelCoord.y >= dstSize.y)
+		return;
+	vec2 texCoord = (vec2(texelCoord) + 0.5) / vec2(dstSize);
+
+	vec2 srcTexelSize = 1.0 / srcResolution;
+	float x = srcTexelSize.x;
+	float y = srcTexelSize.y;
+
+	// Take 13 samples around current texel:
+	// a - b - c
+	// - j - k -
+	// d - e - f
+	// - l - m -
+	// g - h - i
+	// === ('e' is the current texel) ===
+	vec3 a = texture(srcTexture, vec2(texCoord.x - 2*x, texCoord.y + 2*y)).rgb;
+	vec3 b = texture(srcTexture, vec2(texCoord.x,       texCoord.y + 2*y)).rgb;
+	vec3 c = texture(srcTexture, vec2(texCoord.x + 2*x, texCoord.y + 2*y)).rgb;
+
+	vec3 d = texture(srcTexture, vec2(texCoord.x - 2*x, texCoord.y)).rgb;
+	vec3 e = texture(srcTexture, vec2(texCoord.x,       texCoord.y)).rgb;
+	vec3 f = texture(srcTexture, vec2(texCoord.x + 2*x, texCoord.y)).rgb;
+
+	vec3 g = texture(srcTexture, vec2(texCoord.x - 2*x, texCoord.y - 2*y)).rgb;
+	vec3 h = texture(srcTexture, vec2(texCoord.x,       texCoord.y - 2*y)).rgb;
+	vec3 i = texture(srcTexture, vec2(texCoord.x + 2*x, texCoord.y - 2*y)).rgb;
+
+	vec3 j = texture(srcTexture, vec2(texCoord.x - x, texCoord.y + y)).rgb;
+	vec3 k = texture(srcTexture, vec2(texCoord.x + x, texCoord.y + y)).rgb;
+	vec3 l = texture(srcTexture, vec2(texCoord.x - x, texCoord.y - y)).rgb;
+	vec3 m = texture(srcTexture, vec2(texCoord.x + x, texCoord.y - y)).rgb;
+
+	// same weights as 7.bloom_mip_downsample.fs:
+	// 0.125*5 + 0.03125*4 + 0.0625*4 = 1
+	vec3 downsample;
+	if (mipLevel == 0)
+	{
+	  // Karis average on each block of 4 samples when writing mip 0 (prevents fireflies)
+	  vec3 groups[5];
+	  groups[0] = (a+b+d+e) * (0.125f/4.0f);
+	  groups[1] = (b+c+e+f) * (0.125f/4.0f);
+	  groups[2] = (d+e+g+h) * (0.125f/4.0f);
+	  groups[3] = (e+f+h+i) * (0.125f/4.0f);
+	  groups[4] = (j+k+l+m) * (0.5f/4.0f);
+	  groups[0] *= KarisAverage(groups[0]);
+	  groups[1] *= KarisAverage(groups[1]);
+	  groups[2] *= KarisAverage(groups[2]);
+	  groups[3] *= KarisAverage(groups[3]);
+	  groups[4] *= KarisAverage(groups[4]);
+	  downsample = groups[0]+groups[1]+groups[2]+groups[3]+groups[4];
+	  downsample = max(downsample, 0.0001f);
+	}
+	else
+	{
+	  downsample = e*0.125;
+	  downsample += (a+c+g+i)*0.03125;
+	  downsample += (b+d+f+h)*0.0625;
+	  downsample += (j+k+l+m)*0.125;
+	}
+
+	imageStore(dstImage, texelCoord, vec4(downsample, 1.0));
+}
@@ -8,10 +8,18 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_preprocessor.h>
+#include <learnopengl/shader_reload.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/bloom.h>
+#include <learnopengl/frame_constants.h>
+#include <learnopengl/gpu_profiler.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -27,6 +35,8 @@ const unsigned int SCR_HEIGHT = 600;
 bool bloom = true;
 bool bloomKeyPressed = false;
 float exposure = 1.0f;
+// 1: 10次全分辨率高斯乒乓模糊  2: mip链(fragment)  3: mip链(compute)
+int bloomMode = 1;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -38,12 +48,27 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char *argv[])
 {
+    // --profile-csv <file> / --profile-trace <file> write per-pass GPU and CPU times (see gpu_profiler.h),
+    // --profile-frames <count> quits after that many frames
+    std::string profileCSV, profileTrace;
+    unsigned long profileFrames = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+            profileCSV = argv[++i];
+        else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc)
+            profileTrace = argv[++i];
+        else if (strcmp(argv[i], "--profile-frames") == 0 && i + 1 < argc)
+            profileFrames = strtoul(argv[++i], nullptr, 10);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // 先请求4.3 (compute shader), 不支持的话退回3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -55,6 +80,12 @@ int main()
     // --------------------
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    }
+    if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -82,11 +113,26 @@ int main()
 
     // build and compile shaders
     // -------------------------
-    Shader shader("7.bloom.vs", "7.bloom.fs");
-    Shader shaderLight("7.bloom.vs", "7.light_box.fs");
+    // 7.bloom.vs and 7.bloom.fs #include the frame constants block from resources/shaders
+    ShaderPreprocessor preprocessor;
+    preprocessor.IncludeDirs.push_back(FileSystem::getPath("resources/shaders"));
+    Shader shader(preprocessor, "7.bloom.vs", "7.bloom.fs");
+    Shader shaderLight(preprocessor, "7.bloom.vs", "7.light_box.fs");
     Shader shaderBlur("7.blur.vs", "7.blur.fs");
     Shader shaderBloomFinal("7.bloom_final.vs", "7.bloom_final.fs");
 
+    // camera constants shared by shader and shaderLight through one uniform block, written once per frame
+    FrameConstants frameConstants;
+    frameConstants.Create();
+
+    // edit any of these shader files (or frame_constants.glsl) while the demo runs and it is recompiled and swapped in
+    ShaderHotReload shaderReload;
+    shaderReload.AddIncludeDir(FileSystem::getPath("resources/shaders"));
+    shaderReload.Watch(shader);
+    shaderReload.Watch(shaderLight);
+    shaderReload.Watch(shaderBlur);
+    shaderReload.Watch(shaderBloomFinal);
+
     // load textures
     // -------------
     unsigned int woodTexture      = loadTexture(FileSystem::getPath("resources/textures/wood.png").c_str(), true); // note that we're loading the texture as an SRGB texture
@@ -176,6 +222,19 @@ int main()
     shaderBloomFinal.setInt("scene", 0);
     shaderBloomFinal.setInt("bloomBlur", 1);
 
+    // mip链bloom (R11F_G11F_B10F, 半分辨率开始 6级), 跟高斯乒乓模糊对比GPU耗时
+    BloomSettings bloomSettings;
+    bloomSettings.useCompute = false;
+    BloomRenderer bloomRenderer;
+    bloomRenderer.Init(SCR_WIDTH, SCR_HEIGHT, bloomSettings, "7.bloom_mip_");
+    bloomSettings.useCompute = true;
+    BloomRenderer bloomRendererCompute;
+    bloomRendererCompute.Init(SCR_WIDTH, SCR_HEIGHT, bloomSettings, "7.bloom_mip_");
+    BloomPassTimer bloomTimer(60);
+    GpuProfiler profiler;
+    profiler.KeepHistory = !profileCSV.empty() || !profileTrace.empty();
+    unsigned long frames = 0;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -185,10 +244,13 @@ int main()
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        profiler.BeginFrame();
 
         // input
         // -----
         processInput(window);
+        // swap in shaders that were edited (frame boundary)
+        shaderReload.Update();
 
         // render
         // ------
@@ -197,14 +259,15 @@ int main()
 
         // 1. render scene into floating point framebuffer
         // -----------------------------------------------
+        profiler.Begin("scene");
         glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 model = glm::mat4(1.0f);
+        frameConstants.BeginFrame(currentFrame, deltaTime);
+        frameConstants.Set(view, projection, camera.Position, SCR_WIDTH, SCR_HEIGHT);
         shader.use();
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
         // set lighting uniforms
@@ -214,7 +277,6 @@ int main()
             shader.setVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
             shader.setVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
         }
-        shader.setVec3("viewPos", camera.Position);
 
 
         // 场景中画一个大的立方体 create one large cube that acts as the floor
@@ -265,8 +327,6 @@ int main()
 
         // 用立方体当做光源 finally show all the light sources as bright cubes
         shaderLight.use();
-        shaderLight.setMat4("projection", projection);
-        shaderLight.setMat4("view", view);
 
         for (unsigned int i = 0; i < lightPositions.size(); i++)
         {
@@ -278,36 +338,64 @@ int main()
             renderCube();
         }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        profiler.End();
 
         // 2. 高斯模糊(Gaussian blur) blur bright fragments with two-pass Gaussian Blur 
         // --------------------------------------------------
 		unsigned int* p_LastTexture = &colorBuffers[1];
-        unsigned int amount = 10;
-        shaderBlur.use();
-        for (unsigned int i = 0; i < amount; i++) // 画10次 10/2 = 5
+        unsigned int bloomTexture = 0;
+        float bloomStrength = 1.0f;
+        profiler.Begin("bloom");
+        bloomTimer.Begin();
+        if (bloomMode == 1)
         {
-			unsigned int index = i % 2;
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[index]);
-            shaderBlur.setInt("horizontal", index);
-            glBindTexture(GL_TEXTURE_2D, *p_LastTexture);  // bind texture of other framebuffer (or scene if first iteration)
-            renderQuad();
-            
-			p_LastTexture = &pingpongColorbuffers[index];
+            unsigned int amount = 10;
+            shaderBlur.use();
+            for (unsigned int i = 0; i < amount; i++) // 画10次 10/2 = 5
+            {
+                unsigned int index = i % 2;
+                glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[index]);
+                shaderBlur.setInt("horizontal", index);
+                glBindTexture(GL_TEXTURE_2D, *p_LastTexture);  // bind texture of other framebuffer (or scene if first iteration)
+                renderQuad();
+
+                p_LastTexture = &pingpongColorbuffers[index];
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            bloomTexture = *p_LastTexture;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        else
+        {
+            // 2'. mip链: 逐级降采样再升采样叠加, 升采样累加了每一级, 按级数缩放回跟高斯模糊相近的亮度
+            BloomRenderer& renderer = (bloomMode == 2) ? bloomRenderer : bloomRendererCompute;
+            renderer.RenderBloomTexture(colorBuffers[1], 0.005f);
+            bloomTexture = renderer.BloomTexture();
+            bloomStrength = 1.0f / renderer.MipChain().size();
+        }
+        bloomTimer.End();
+        profiler.End();
+        if (bloomMode == 1)
+            bloomTimer.Report("bloom gaussian ping-pong (10 passes, full resolution)");
+        else if (bloomMode == 2)
+            bloomTimer.Report(bloomRenderer.UsingCompute() ? "bloom mip chain compute" : "bloom mip chain fragment");
+        else
+            bloomTimer.Report(bloomRendererCompute.UsingCompute() ? "bloom mip chain compute" : "bloom mip chain fragment (no GL 4.3)");
 
         // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         //      混合两个浮点纹理 + 色调映射 + 伽马校正
 		// --------------------------------------------------------------------------------------------------------------------------
+        profiler.Begin("tonemap");
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderBloomFinal.use();
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, *p_LastTexture);
+        glBindTexture(GL_TEXTURE_2D, bloomTexture);
         shaderBloomFinal.setInt("bloom", bloom);
+        shaderBloomFinal.setFloat("bloomStrength", bloomStrength);
         shaderBloomFinal.setFloat("exposure", exposure);
         renderQuad();
+        profiler.End();
 
 		static decltype(bloom) sBloom = !bloom;
 		static decltype(exposure) sExposure = !exposure;
@@ -318,12 +406,32 @@ int main()
 			std::cout << "bloom: " << (bloom ? "on" : "off") << "| exposure: " << exposure << std::endl;
 		}
        
+        profiler.EndFrame();
+        if (profileFrames > 0 && ++frames >= profileFrames)
+            glfwSetWindowShouldClose(window, true);
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    // profiler output (waits for the frames still in flight first)
+    // -------------------------------------------------------------
+    profiler.Flush();
+    if (!profileCSV.empty() && !profiler.WriteCSV(profileCSV))
+        std::cout << "ERROR::PROFILER: Failed to write " << profileCSV << std::endl;
+    if (!profileTrace.empty() && !profiler.WriteChromeTrace(profileTrace))
+        std::cout << "ERROR::PROFILER: Failed to write " << profileTrace << std::endl;
+    std::cout << profiler.Report();
+    if (profiler.Dropped > 0)
+        std::cout << "Profiler: " << profiler.Dropped << " frames dropped (queries not ready in time)" << std::endl;
+    profiler.Destroy();
+
+    bloomRenderer.Destroy();
+    bloomRendererCompute.Destroy();
+    frameConstants.Destroy();
+    shaderReload.Destroy();
     glfwTerminate();
     return 0;
 }
@@ -460,6 +568,14 @@ void processInput(GLFWwindow *window)
         bloomKeyPressed = false;
     }
 
+    // 切换bloom实现
+    if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+        bloomMode = 1;
+    else if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+        bloomMode = 2;
+    else if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
+        bloomMode = 3;
+
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
     {
         if (exposure > 0.0f)
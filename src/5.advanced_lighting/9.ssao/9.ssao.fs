@@ -1,5 +1,5 @@
 #version 330 core
-out float FragColor;
+out vec2 FragColor; // r: 遮蔽因子  g: 视图空间深度(低分辨率时 双边滤波/上采样 要用)
 
 in vec2 TexCoords;
 
@@ -7,12 +7,21 @@ uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
 
-uniform vec3 samples[64];
+// 采样核心 放在UBO中 启动时上传一次 (8/16/32/64 四组核心依次排列, 共120个)
+// KERNEL_SIZE/KERNEL_OFFSET 由程序编译shader时注入(#define), 每个样本数目一个program
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#define KERNEL_OFFSET 0
+#endif
+layout (std140) uniform SSAOKernel
+{
+    vec4 samples[120];
+};
 
 uniform bool disableRandomRotation ;
 
 // parameters (you'd probably want to use them as uniforms to more easily tweak the effect)
-int kernelSize = 64;
+const int kernelSize = KERNEL_SIZE;
 float radius = 0.5;
 float bias = 0.025;
 
@@ -24,7 +33,8 @@ float bias = 0.025;
 //     这样屏幕的0~4的纹理坐标就是0~1.0 完整的纹理, 4~8 repeat 0~1.0 第二完整的纹理
 // 
 // tile noise texture over screen based on screen dimensions divided by noise size
-const vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0);  // 屏幕 = 800x600
+// SSAO可以在半分辨率/四分之一分辨率下计算, 所以由程序传入 (SSAO缓冲区大小 / 4.0)
+uniform vec2 noiseScale;
 
 uniform mat4 projection;
 
@@ -58,7 +68,7 @@ void main()
     for(int i = 0; i < kernelSize; ++i)
     {
         // get sample position
-        vec3 samplePos = TBN * samples[i]; // from tangent to view-space
+        vec3 samplePos = TBN * samples[KERNEL_OFFSET + i].xyz; // from tangent to view-space
 
         samplePos = fragPos + samplePos * radius;  
 		// 从切向空间转换到视图空间, 需要加上顶点坐标(位移)
@@ -117,7 +127,7 @@ void main()
 	// 原来1.0是代表遮挡 , 相当于要环境光照为0, 所以要1.0减去遮挡强度
 	//  用来缩放环境光照分量
     
-    FragColor = occlusion;
+    FragColor = vec2(occlusion, fragPos.z);
 	// 在片段着色器（out float FragColor;）中输出“float”时
 	// 因为“FragColor”是一个"float"而不是"vec4"，
 	// 所以输出的是："float, undef, undef, undef"
@@ -0,0 +1,39 @@
+#version 330 core
+out vec2 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput; // r: 遮蔽因子  g: 视图空间深度
+uniform vec2 direction;      // 可分离模糊: (1,0) 水平一次, (0,1) 垂直一次
+uniform bool disableBlur;
+
+// 9-tap 高斯权重 (sigma ≈ 2)
+const float weights[5] = float[](0.2042, 0.1802, 0.1238, 0.0663, 0.0276);
+// 深度差越大权重越小, 不跨越物体边缘模糊
+const float depthSharpness = 8.0;
+
+void main()
+{
+    vec2 center = texture(ssaoInput, TexCoords).rg;
+    if (disableBlur)
+    {
+        FragColor = center;
+        return;
+    }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
+    float result = center.r * weights[0];
+    float weightSum = weights[0];
+    for (int i = 1; i < 5; ++i)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            vec2 s = texture(ssaoInput, TexCoords + direction * texelSize * float(i * side)).rg;
+            float w = weights[i] * exp(-abs(s.g - center.g) * depthSharpness);
+            result += s.r * w;
+            weightSum += w;
+        }
+    }
+    // 深度原样传下去, 给下一次模糊和上采样使用
+    FragColor = vec2(result / weightSum, center.g);
+}
@@ -6,7 +6,8 @@ in vec2 TexCoords;
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedo;
-uniform sampler2D ssao;
+uniform sampler2D ssao; // r: 遮蔽因子  g: 视图空间深度
+uniform bool bilateralUpsample; // SSAO是低分辨率的 需要按深度加权上采样
 
 struct Light {
     vec3 Position;
@@ -17,6 +18,31 @@ struct Light {
 };
 uniform Light light;
 
+// 深度感知的双边上采样: 取最近的4个低分辨率像素, 双线性权重再乘上深度相似度权重
+// 避免物体边缘处 前景和背景的遮蔽值混在一起 (出现光晕)
+float upsampleAO(float fullDepth)
+{
+    vec2 lowSize = vec2(textureSize(ssao, 0));
+    vec2 coord = TexCoords * lowSize - 0.5;
+    ivec2 base = ivec2(floor(coord));
+    vec2 f = fract(coord);
+    float total = 0.0;
+    float weightSum = 0.0;
+    for (int y = 0; y < 2; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            ivec2 p = clamp(base + ivec2(x, y), ivec2(0), ivec2(lowSize) - 1);
+            vec2 s = texelFetch(ssao, p, 0).rg;
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float w = bilinear / (0.0001 + abs(s.g - fullDepth));
+            total += s.r * w;
+            weightSum += w;
+        }
+    }
+    return total / max(weightSum, 0.0001);
+}
+
 void main()
 {             
     // retrieve data from gbuffer
@@ -25,7 +51,7 @@ void main()
     vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
 
 	// 环境光强度 -- 已经做了1.0-遮罩强度
-    float AmbientOcclusion = texture(ssao, TexCoords).r;
+    float AmbientOcclusion = bilateralUpsample ? upsampleAO(FragPos.z) : texture(ssao, TexCoords).r;
     
     // then calculate lighting as usual
     vec3 ambient = vec3(0.3 * Diffuse * AmbientOcclusion);// 只有环境光部分 加上遮蔽因子
@@ -7,6 +7,7 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_reload.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
@@ -40,11 +41,55 @@ bool gDisableBlur = false;
 bool gDisableRandomRotation = false;
 bool gDisplaySSAO = false;
 
+// SSAO 分辨率(按键R切换) 和 采样核心大小(按键K切换)
+// 全分辨率: 原来的流程 4x4盒式模糊
+// 半/四分之一分辨率: 可分离的双边模糊 + 光照阶段按深度双边上采样
+const unsigned int SSAO_DIVISORS[3] = { 1, 2, 4 };
+const char* SSAO_RESOLUTION_NAMES[3] = { "full", "half", "quarter" };
+int gSSAOResolution = 0;
+const unsigned int KERNEL_SIZES[4] = { 8, 16, 32, 64 };
+const unsigned int KERNEL_OFFSETS[4] = { 0, 8, 24, 56 }; // UBO中依次排列, 共120个样本
+const unsigned int KERNEL_TOTAL = 120;
+int gKernelSizeIndex = 3;
+
 float lerp(float a, float b, float f)
 {
     return a + f * (b - a);
 }
 
+// 法线方向的半球 单位半球采样核心 (kernelSize个样本, 追加到kernel后面)
+void generateKernel(unsigned int kernelSize, std::vector<glm::vec4>& kernel,
+	std::uniform_real_distribution<GLfloat>& randomFloats, std::default_random_engine& generator)
+{
+    for (unsigned int i = 0; i < kernelSize; ++i)
+    {
+        glm::vec3 sample(
+			randomFloats(generator) * 2.0 - 1.0, // std::uniform_real_distribution<T>::operator(std::default_random_engine )
+			randomFloats(generator) * 2.0 - 1.0, // 在切线空间中以-1.0到1.0为范围变换x和y方向，
+			randomFloats(generator)); // 并以0.0和1.0为范围变换样本的z方向(如果以-1.0到1.0为范围，取样核心就变成球型了
+
+        sample = glm::normalize(sample); // 归一化(归一化并不会修改方向, 所以还在半球表面上)
+
+		// 由于样本内核将沿表面法线定向，因此生成的样本向量将全部位于半球中
+		// (sample样本向量是在切向空间, 所有只要z大于0, 那么就在半球内)
+		// 为了把更多的注意放在靠近真正片段的遮蔽上，
+		// 也就是将核心样本靠近原点分布, 用一个'双曲线'实现 缩放采样点 
+
+        float scale = float(i) / float(kernelSize);  //单位长度改成 0, 1/N, 2/N, 3/N(采样向量的模长)
+		
+		// 实际是 a + f * (b - a) = 0.1 + ((i/N)^2)*(1.0-0.1)
+		// lerp从0.1开始, 所以不会低于0.1, 长度从0.1到1
+		// scale           就变成从 0.1到1.0长度均匀了
+		// scale*scale  长度还是从0.1到1.0, 但是就变成 0.1 附近更加多
+        scale = lerp(0.1f, 1.0f, scale * scale); 
+        sample *= scale;
+
+		sample *= randomFloats(generator); // hhl 挪到这里 好理解 上面是控制摸长 从0到1(并且不均匀), 这里再引入随机
+
+        kernel.push_back(glm::vec4(sample, 0.0f)); // std140 vec3数组按vec4对齐
+    }
+}
+
 int main()
 {
     // glfw: initialize and configure
@@ -91,8 +136,17 @@ int main()
     // -------------------------
     Shader shaderGeometryPass("9.ssao_geometry.vs", "9.ssao_geometry.fs");
     Shader shaderLightingPass("9.ssao.vs", "9.ssao_lighting.fs");
-    Shader shaderSSAO("9.ssao.vs", "9.ssao.fs");
     Shader shaderSSAOBlur("9.ssao.vs", "9.ssao_blur.fs");
+    Shader shaderSSAOBilateralBlur("9.ssao.vs", "9.ssao_blur_bilateral.fs");
+
+	// 每种采样核心大小 编译一个特化的program (循环次数是常量, 编译器可以展开)
+    Shader* shaderSSAOVariants[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        std::string defines = "#define KERNEL_SIZE " + std::to_string(KERNEL_SIZES[i]) + "\n"
+                            + "#define KERNEL_OFFSET " + std::to_string(KERNEL_OFFSETS[i]) + "\n";
+        shaderSSAOVariants[i] = new Shader("9.ssao.vs", "9.ssao.fs", nullptr, defines.c_str());
+    }
 
     // load models
     // -----------
@@ -167,9 +221,9 @@ int main()
 	glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
     glGenTextures(1, &ssaoColorBuffer);
     glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-	// 环境遮蔽的结果是一个灰度值，我们将只需要纹理的红色分量
-	// 颜色缓冲的内部格式设置为GL_RED(外部格式也是GL_RED 没有 GL_REDF)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+	// 环境遮蔽的结果是一个灰度值，红色分量就够了
+	// 绿色分量存视图空间深度, 低分辨率时 双边模糊/上采样 要用, 所以是GL_RG16F
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
@@ -181,7 +235,7 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
     glGenTextures(1, &ssaoColorBufferBlur);
     glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
@@ -190,43 +244,26 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	
 
-    // 法线方向的半球 单位半球采样核心--- 最大64样本值
+    // 法线方向的半球 单位半球采样核心--- 8/16/32/64 四组
+    // 放到UBO里, 只上传一次 (原来每帧调用64次setVec3)
     // ----------------------
     std::uniform_real_distribution<GLfloat> 
 		randomFloats(0.0, 1.0);  // 产生均匀分布在区间 [a, b) 上的随机浮点值，概率密度P(i|a,b)=1/(b-a)
     std::default_random_engine generator; // 后面会调用 uniform_real_distribution的operator() 
-    std::vector<glm::vec3> ssaoKernel;
-    for (unsigned int i = 0; i < 64; ++i)
+    std::vector<glm::vec4> ssaoKernel;
+    for (int i = 0; i < 4; ++i)
     {
-		
-        glm::vec3 sample(
-			randomFloats(generator) * 2.0 - 1.0, // std::uniform_real_distribution<T>::operator(std::default_random_engine )
-			randomFloats(generator) * 2.0 - 1.0, // 在切线空间中以-1.0到1.0为范围变换x和y方向，
-			randomFloats(generator)); // 并以0.0和1.0为范围变换样本的z方向(如果以-1.0到1.0为范围，取样核心就变成球型了
-
-        sample = glm::normalize(sample); // 归一化(归一化并不会修改方向, 所以还在半球表面上)
-		
-		//sample *= randomFloats(generator); // 0~1  长短不一, 在半球球里面 --hhl 搬到后面好理解
-
-		// 由于样本内核将沿表面法线定向，因此生成的样本向量将全部位于半球中
-		// (sample样本向量是在切向空间, 所有只要z大于0, 那么就在半球内)
-		// 为了把更多的注意放在靠近真正片段的遮蔽上，
-		// 也就是将核心样本靠近原点分布, 用一个'双曲线'实现 缩放采样点 
-
-        float scale = float(i) / 64.0f;  //单位长度改成 0, 1/64, 2/64, 3/64(采样向量的模长)
-		
-		// 实际是 a + f * (b - a) = 0.1 + ((i/64)^2)*(1.0-0.1)
-		// lerp从0.1开始, 所以不会低于0.1, 长度从0.1到1
-		// scale           就变成从 0.1到1.0长度均匀了
-		// scale*scale  长度还是从0.1到1.0, 但是就变成 0.1 附近更加多
-        scale = lerp(0.1f, 1.0f, scale * scale); 
-        sample *= scale;
-
-		sample *= randomFloats(generator); // hhl 挪到这里 好理解 上面是控制摸长 从0到1(并且不均匀), 这里再引入随机
-
-        ssaoKernel.push_back(sample);
+        generateKernel(KERNEL_SIZES[i], ssaoKernel, randomFloats, generator);
     }
 
+    const unsigned int SSAO_KERNEL_BIND_POINT = 0;
+    unsigned int uboKernel;
+    glGenBuffers(1, &uboKernel);
+    glBindBuffer(GL_UNIFORM_BUFFER, uboKernel);
+    glBufferData(GL_UNIFORM_BUFFER, KERNEL_TOTAL * sizeof(glm::vec4), &ssaoKernel[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SSAO_KERNEL_BIND_POINT, uboKernel);
+
 	// 
 	// 创建一个小的随机旋转向量纹理平铺在屏幕上
 	// (纹理采样是repeat, 相当于把屏幕空间分成4*4的格子, 每个格子都是重复的)
@@ -270,12 +307,37 @@ int main()
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("gAlbedo", 2);
     shaderLightingPass.setInt("ssao", 3);
-    shaderSSAO.use();
-    shaderSSAO.setInt("gPosition", 0);
-    shaderSSAO.setInt("gNormal", 1);
-    shaderSSAO.setInt("texNoise", 2);
+    for (Shader* shaderSSAO : shaderSSAOVariants)
+    {
+        shaderSSAO->use();
+        shaderSSAO->setInt("gPosition", 0);
+        shaderSSAO->setInt("gNormal", 1);
+        shaderSSAO->setInt("texNoise", 2);
+        glUniformBlockBinding(shaderSSAO->ID, glGetUniformBlockIndex(shaderSSAO->ID, "SSAOKernel"), SSAO_KERNEL_BIND_POINT);
+    }
     shaderSSAOBlur.use();
     shaderSSAOBlur.setInt("ssaoInput", 0);
+    shaderSSAOBilateralBlur.use();
+    shaderSSAOBilateralBlur.setInt("ssaoInput", 0);
+
+    // edit any of these shader files while the demo runs and it is recompiled and swapped in
+    // (the sampler units and the SSAOKernel binding set above carry over)
+    ShaderHotReload shaderReload;
+    shaderReload.Watch(shaderGeometryPass);
+    shaderReload.Watch(shaderLightingPass);
+    shaderReload.Watch(shaderSSAOBlur);
+    shaderReload.Watch(shaderSSAOBilateralBlur);
+    for (Shader* shaderSSAO : shaderSSAOVariants)
+        shaderReload.Watch(*shaderSSAO);
+
+	// GPU计时: SSAO生成+模糊的耗时, 两个query交替使用, 读取上一帧的结果, 不会阻塞管线
+    unsigned int timerQueries[2];
+    glGenQueries(2, timerQueries);
+    unsigned int frameIndex = 0;
+    double accumulatedMs = 0.0;
+    unsigned int accumulatedFrames = 0;
+    int appliedResolution = 0;
+    int reportResolution = -1, reportKernel = -1;
 
     // render loop
     // -----------
@@ -290,6 +352,7 @@ int main()
         // input
         // -----
         processInput(window);
+        shaderReload.Update();
 
         // render
         // ------
@@ -324,16 +387,34 @@ int main()
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 
+        // SSAO 分辨率改变了 重新分配两个SSAO缓冲区 (纹理ID不变 fbo附件不用重新绑定)
+        if (appliedResolution != gSSAOResolution)
+        {
+            appliedResolution = gSSAOResolution;
+            unsigned int divisor = SSAO_DIVISORS[appliedResolution];
+            for (unsigned int texture : { ssaoColorBuffer, ssaoColorBufferBlur })
+            {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SCR_WIDTH / divisor, SCR_HEIGHT / divisor, 0, GL_RG, GL_FLOAT, NULL);
+            }
+        }
+        const unsigned int ssaoWidth = SCR_WIDTH / SSAO_DIVISORS[appliedResolution];
+        const unsigned int ssaoHeight = SCR_HEIGHT / SSAO_DIVISORS[appliedResolution];
+        const bool lowResolution = appliedResolution != 0;
+        Shader& shaderSSAO = *shaderSSAOVariants[gKernelSizeIndex];
+
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries[frameIndex % 2]);
+        glViewport(0, 0, ssaoWidth, ssaoHeight);
+
         // 2. generate SSAO texture
         // ------------------------
         glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-            glClear(GL_COLOR_BUFFER_BIT); // ssaoFBO只是个GL_RED colorclear为0,0,0,1
+            glClear(GL_COLOR_BUFFER_BIT); // ssaoFBO只是个GL_RG colorclear为0,0,0,1
             shaderSSAO.use();
 			shaderSSAO.setBool("disableRandomRotation", gDisableRandomRotation);
-            // Send kernel + rotation 
-            for (unsigned int i = 0; i < 64; ++i)
-                shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+            // kernel 已经在UBO中, 只需要 projection 和 噪声平铺比例
             shaderSSAO.setMat4("projection", projection);
+            shaderSSAO.setVec2("noiseScale", ssaoWidth / 4.0f, ssaoHeight / 4.0f);
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, gPosition); // 位置+线性深度(相机空间)
             glActiveTexture(GL_TEXTURE1);
@@ -346,14 +427,41 @@ int main()
 
         // 3. blur SSAO texture to remove noise
         // ------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderSSAOBlur.use();
-			shaderSSAOBlur.setInt("disableBlur", gDisableBlur);
+        unsigned int ssaoResultFBO, ssaoResult;
+        if (!lowResolution)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
+                glClear(GL_COLOR_BUFFER_BIT);
+                shaderSSAOBlur.use();
+                shaderSSAOBlur.setInt("disableBlur", gDisableBlur);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+                renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            ssaoResultFBO = ssaoBlurFBO;
+            ssaoResult = ssaoColorBufferBlur;
+        }
+        else
+        {
+            // 可分离的双边模糊: 水平 ssaoColorBuffer -> ssaoColorBufferBlur, 垂直 再写回 ssaoColorBuffer
+            shaderSSAOBilateralBlur.use();
+            shaderSSAOBilateralBlur.setBool("disableBlur", gDisableBlur);
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-            renderQuad();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
+                shaderSSAOBilateralBlur.setVec2("direction", 1.0f, 0.0f);
+                glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+                renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
+                shaderSSAOBilateralBlur.setVec2("direction", 0.0f, 1.0f);
+                glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
+                renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            ssaoResultFBO = ssaoFBO;
+            ssaoResult = ssaoColorBuffer;
+        }
+
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        glEndQuery(GL_TIME_ELAPSED);
 
 		if (!gDisplaySSAO) 
 		{
@@ -378,34 +486,71 @@ int main()
 			glActiveTexture(GL_TEXTURE2);
 			glBindTexture(GL_TEXTURE_2D, gAlbedo);
 			glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
-			glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
+			glBindTexture(GL_TEXTURE_2D, ssaoResult);
+			shaderLightingPass.setBool("bilateralUpsample", lowResolution);
 			renderQuad();
 		}
 		else
 		{
 			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 			glDrawBuffer(GL_BACK);
-			glBindFramebuffer(GL_READ_FRAMEBUFFER, ssaoBlurFBO);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, ssaoResultFBO);
 			glReadBuffer(GL_COLOR_ATTACHMENT0);
 
 			glBlitFramebuffer(
-				0, 0, SCR_WIDTH, SCR_HEIGHT,
+				0, 0, ssaoWidth, ssaoHeight,
 				0, 0, SCR_WIDTH, SCR_HEIGHT,
 				GL_COLOR_BUFFER_BIT,
 				GL_NEAREST
 				);
-			// ssaoBlurFBO 只有R通道  红色=1 代表环境光没有遮挡 0=黑色有遮挡
+			// R通道  红色=1 代表环境光没有遮挡 0=黑色有遮挡 (G通道是视图空间深度, 负数显示为0)
 			glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		}
 		void dump();
 		dump();
 
+		// 读取上一帧的GPU计时 (query结果已经可用 不会等待), 每60帧打印一次平均值
+		if (frameIndex > 0)
+		{
+			unsigned int previousQuery = timerQueries[(frameIndex - 1) % 2];
+			GLint available = 0;
+			glGetQueryObjectiv(previousQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint64 elapsedNs = 0;
+				glGetQueryObjectui64v(previousQuery, GL_QUERY_RESULT, &elapsedNs);
+				if (reportResolution != appliedResolution || reportKernel != gKernelSizeIndex)
+				{
+					// 设置改变 重新统计
+					reportResolution = appliedResolution;
+					reportKernel = gKernelSizeIndex;
+					accumulatedMs = 0.0;
+					accumulatedFrames = 0;
+				}
+				else
+				{
+					accumulatedMs += elapsedNs / 1000000.0;
+					accumulatedFrames++;
+				}
+				if (accumulatedFrames == 60)
+				{
+					printf("SSAO %s resolution (%ux%u), %u samples: %.3f ms (SSAO + blur, avg of %u frames)\n",
+						SSAO_RESOLUTION_NAMES[reportResolution], ssaoWidth, ssaoHeight, KERNEL_SIZES[reportKernel],
+						accumulatedMs / accumulatedFrames, accumulatedFrames);
+					accumulatedMs = 0.0;
+					accumulatedFrames = 0;
+				}
+			}
+		}
+		frameIndex++;
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    shaderReload.Destroy();
     glfwTerminate();
     return 0;
 }
@@ -453,6 +598,16 @@ void dump()
 		#undef TRACE_STATUS
 		#undef TRACE_KEY
 	}
+
+	{
+		static int sResolution = -1, sKernel = -1;
+		if (sResolution != gSSAOResolution || sKernel != gKernelSizeIndex)
+		{
+			sResolution = gSSAOResolution;
+			sKernel = gKernelSizeIndex;
+			printf("Press Key R/K SSAO resolution = %s, kernel size = %u\n", SSAO_RESOLUTION_NAMES[sResolution], KERNEL_SIZES[sKernel]);
+		}
+	}
 }
 
 // renderCube() renders a 1x1 3D cube in NDC.
@@ -596,6 +751,33 @@ void processInput(GLFWwindow *window)
 		}
 	}
 	
+	{
+		static bool sKeyPress = false;
+		bool KeyPressed = glfwGetKey(window, GLFW_KEY_R);
+		if (KeyPressed == GLFW_PRESS && !sKeyPress)
+		{
+			gSSAOResolution = (gSSAOResolution + 1) % 3; // 全分辨率 -> 半分辨率 -> 四分之一分辨率
+			sKeyPress = true;
+		}
+		else if (KeyPressed == GLFW_RELEASE)
+		{
+			sKeyPress = false;
+		}
+	}
+	{
+		static bool sKeyPress = false;
+		bool KeyPressed = glfwGetKey(window, GLFW_KEY_K);
+		if (KeyPressed == GLFW_PRESS && !sKeyPress)
+		{
+			gKernelSizeIndex = (gKernelSizeIndex + 1) % 4; // 8 -> 16 -> 32 -> 64 个样本
+			sKeyPress = true;
+		}
+		else if (KeyPressed == GLFW_RELEASE)
+		{
+			sKeyPress = false;
+		}
+	}
+	
 	{
 		static bool sKeyPress = false;
 		bool KeyPressed = glfwGetKey(window, GLFW_KEY_N);
@@ -8,6 +8,7 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_reload.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
@@ -158,6 +159,10 @@ int main()
     shader.use();
     shader.setMat4("projection", projection);
 
+    // edit 1.1.pbr.vs/fs while the demo runs and it is recompiled and swapped in
+    ShaderHotReload shaderReload;
+    shaderReload.Watch(shader);
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -171,6 +176,7 @@ int main()
         // input
         // -----
         processInput(window);
+        shaderReload.Update();
 
         // render
         // ------
@@ -241,6 +247,8 @@ int main()
         glfwPollEvents();
     }
 
+    shaderReload.Destroy();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
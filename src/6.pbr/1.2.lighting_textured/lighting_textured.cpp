@@ -8,9 +8,14 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_permutations.h>
+#include <learnopengl/shader_preprocessor.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -19,6 +24,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
 void renderSphere();
+bool testPreprocessor();
 
 // settings
 const unsigned int SCR_WIDTH = 1280;
@@ -34,8 +40,16 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+// normal mapping (toggled with N) selects a specialized program instead of branching in the shader
+bool normalMapping = true;
+bool normalMappingKeyPressed = false;
+
+int main(int argc, char *argv[])
 {
+    // headless check of the expanded shader sources: lighting_textured --preprocessor-test
+    if (argc > 1 && strcmp(argv[1], "--preprocessor-test") == 0)
+        return testPreprocessor() ? 0 : 1;
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -79,14 +93,21 @@ int main()
 
     // build and compile shaders
     // -------------------------
-    Shader shader("1.2.pbr.vs", "1.2.pbr.fs");
+    // the BRDF functions are #included from resources/shaders, NORMAL_MAP (bit 0) picks the program variant
+    ShaderPreprocessor preprocessor;
+    preprocessor.IncludeDirs.push_back(FileSystem::getPath("resources/shaders"));
+    ShaderPermutations pbrShaders(preprocessor, "1.2.pbr.vs", "1.2.pbr.fs", { "NORMAL_MAP" });
 
-    shader.use();
-    shader.setInt("albedoMap", 0);
-    shader.setInt("normalMap", 1);
-    shader.setInt("metallicMap", 2);
-    shader.setInt("roughnessMap", 3);
-    shader.setInt("aoMap", 4);
+    for (unsigned int features = 0; features < 2; ++features)
+    {
+        Shader &shader = pbrShaders.Get(features);
+        shader.use();
+        shader.setInt("albedoMap", 0);
+        shader.setInt("normalMap", 1);
+        shader.setInt("metallicMap", 2);
+        shader.setInt("roughnessMap", 3);
+        shader.setInt("aoMap", 4);
+    }
 
 	// PBR材质纹理--都是没有设置SRGB
 	// 
@@ -113,8 +134,11 @@ int main()
     // initialize static shader uniforms before rendering
     // --------------------------------------------------
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    shader.use();
-    shader.setMat4("projection", projection);
+    for (unsigned int features = 0; features < 2; ++features)
+    {
+        pbrShaders.Get(features).use();
+        pbrShaders.Get(features).setMat4("projection", projection);
+    }
 
     // render loop
     // -----------
@@ -135,6 +159,7 @@ int main()
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        Shader &shader = pbrShaders.Get(normalMapping ? 1u : 0u);
         shader.use();
         glm::mat4 view = camera.GetViewMatrix();
         shader.setMat4("view", view);
@@ -212,6 +237,14 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && !normalMappingKeyPressed)
+    {
+        normalMapping = !normalMapping;
+        normalMappingKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE)
+        normalMappingKeyPressed = false;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -389,3 +422,69 @@ unsigned int loadTexture(char const * path)
 
     return textureID;
 }
+
+// expands a few temporary files (nested includes, #pragma once, a permutation define) and compares
+// the result with the expected text, #line directives included; no OpenGL needed
+bool testPreprocessor()
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "learnopengl_preprocessor_test";
+    std::filesystem::create_directories(dir);
+    auto write = [&dir](const char* name, const char* text)
+    {
+        std::ofstream file(dir / name);
+        file << text;
+        return (dir / name).string();
+    };
+    std::string vertexPath = write("test.vs", "#version 330 core\nvoid main() {}\n");
+    std::string fragmentPath = write("test.fs",
+        "#version 330 core\n"
+        "#include \"a.glsl\"\n"
+        "#include \"b.glsl\"\n"
+        "float value = A + B;\n"
+        "#ifdef NORMAL_MAP\n"
+        "value *= 2.0;\n"
+        "#endif\n");
+    write("a.glsl", "#pragma once\n#include \"b.glsl\"\n#define A 1.0\n");
+    write("b.glsl", "#pragma once\n#define B 2.0\n");
+
+    // files are numbered in the order they're first seen: test.vs 0, test.fs 1, a.glsl 2, b.glsl 3;
+    // the second include of b.glsl stays an empty line, so "float value" is still line 4
+    const std::string body =
+        "#line 2 1\n"
+        "#line 1 2\n"
+        "\n"
+        "#line 1 3\n"
+        "\n"
+        "#define B 2.0\n"
+        "#line 3 2\n"
+        "#define A 1.0\n"
+        "#line 3 1\n"
+        "\n"
+        "float value = A + B;\n"
+        "#ifdef NORMAL_MAP\n"
+        "value *= 2.0;\n"
+        "#endif\n";
+    ShaderPreprocessor preprocessor;
+    ShaderPermutations permutations(preprocessor, vertexPath, fragmentPath, { "NORMAL_MAP", "SHADOWS" });
+    // the defines go right after #version in both stages; SHADOWS isn't mentioned by the sources, so it never becomes one
+    struct Case { unsigned int features; const char* defines; };
+    const Case cases[] = { { 0u, "" }, { 2u, "" }, { 3u, "#define NORMAL_MAP\n" } };
+    bool passed = true;
+    for (const Case& test : cases)
+    {
+        std::string vertexCode, fragmentCode;
+        permutations.Expand(test.features, vertexCode, fragmentCode);
+        std::string expectedVertex = std::string("#version 330 core\n") + test.defines + "#line 2 0\nvoid main() {}\n";
+        std::string expectedFragment = std::string("#version 330 core\n") + test.defines + body;
+        if (vertexCode != expectedVertex || fragmentCode != expectedFragment)
+        {
+            std::cout << "ShaderPreprocessor: FAILED for features " << test.features << "\n--- expected\n" << expectedVertex << expectedFragment
+                      << "--- got\n" << vertexCode << fragmentCode << std::endl;
+            passed = false;
+        }
+    }
+    std::filesystem::remove_all(dir);
+    if (passed)
+        std::cout << "ShaderPreprocessor: OK" << std::endl;
+    return passed;
+}
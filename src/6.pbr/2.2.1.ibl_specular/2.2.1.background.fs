@@ -4,9 +4,34 @@ in vec3 WorldPos;
 
 uniform samplerCube environmentMap;
 
+// debug: display the SH9 irradiance instead of the environment map
+uniform bool showIrradianceSH;
+layout (std140) uniform SH9Irradiance
+{
+    vec4 shCoefficients[9];
+};
+
+vec3 irradianceSH(vec3 n)
+{
+    vec3 result = shCoefficients[0].rgb * 0.282095
+                + shCoefficients[1].rgb * 0.488603 * n.y
+                + shCoefficients[2].rgb * 0.488603 * n.z
+                + shCoefficients[3].rgb * 0.488603 * n.x
+                + shCoefficients[4].rgb * 1.092548 * n.x * n.y
+                + shCoefficients[5].rgb * 1.092548 * n.y * n.z
+                + shCoefficients[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+                + shCoefficients[7].rgb * 1.092548 * n.x * n.z
+                + shCoefficients[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
 void main()
 {		
-    vec3 envColor = textureLod(environmentMap, WorldPos, 0.0).rgb;
+    vec3 envColor;
+    if (showIrradianceSH)
+        envColor = irradianceSH(normalize(WorldPos));
+    else
+        envColor = textureLod(environmentMap, WorldPos, 0.0).rgb;
     
     // HDR tonemap and gamma correct
     envColor = envColor / (envColor + vec3(1.0));
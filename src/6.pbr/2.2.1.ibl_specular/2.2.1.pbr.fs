@@ -11,7 +11,11 @@ uniform float roughness;
 uniform float ao;
 
 // IBL
-uniform samplerCube irradianceMap;
+// 漫反射辐照度: 9个SH系数 (std140 vec3数组按vec4对齐), CPU投影+余弦卷积, 已经除以PI
+layout (std140) uniform SH9Irradiance
+{
+    vec4 shCoefficients[9];
+};
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
@@ -70,6 +74,20 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }   
 // ----------------------------------------------------------------------------
+vec3 irradianceSH(vec3 n)
+{
+    vec3 result = shCoefficients[0].rgb * 0.282095
+                + shCoefficients[1].rgb * 0.488603 * n.y
+                + shCoefficients[2].rgb * 0.488603 * n.z
+                + shCoefficients[3].rgb * 0.488603 * n.x
+                + shCoefficients[4].rgb * 1.092548 * n.x * n.y
+                + shCoefficients[5].rgb * 1.092548 * n.y * n.z
+                + shCoefficients[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+                + shCoefficients[7].rgb * 1.092548 * n.x * n.z
+                + shCoefficients[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+// ----------------------------------------------------------------------------
 void main()
 {		
     vec3 N = Normal;
@@ -144,12 +162,12 @@ void main()
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;	// 金属度 相当于吸收了折射的光线, kD会减少了, 漫反射(折射中的部分)+镜面反射就不完全等于入射
     
-	// 2. 间接光照--漫反射部分,使用 辐照度立方体贴图 kD * c / π * (∫ Li(ωi,p) * n*ωi d ωi  )  
-	//                   辐照度立方体贴图 包含公式中的 1/ π * (∫ Li(ωi,p) * n*ωi d ωi  )  
-	//                   积分使用了 pdf(θ,φ)=1/(π^2) 平均 重要性采样
+	// 2. 间接光照--漫反射部分,使用 SH9球谐辐照度 kD * c / π * (∫ Li(ωi,p) * n*ωi d ωi  )  
+	//                   SH9系数 包含公式中的 1/ π * (∫ Li(ωi,p) * n*ωi d ωi  )  
+	//                   环境光投影到SH后, 余弦波瓣卷积只是每个band乘一个常数 (π, 2π/3, π/4)
 	//                   注意 这里的kD当作常数了, 实际应该跟H_dot_V相关 
-	//                   辐照度立方体贴图 表示 宏表面在不同方向(宏表面的法线)的 间接光的漫反射 积分值 
-    vec3 irradiance = texture(irradianceMap, N).rgb;
+	//                   辐照度是低频信号, 三阶SH误差很小, 替代了辐照度立方体贴图的采样 
+    vec3 irradiance = irradianceSH(normalize(N));
     vec3 diffuse      = irradiance * albedo;
     
 	// 3. 间接光照--镜面反射部分,使用分割求和近似法 预滤波积分图 cubemap + BRDF LUT(NdotV, roughness) 
@@ -10,6 +10,7 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/spherical_harmonics.h>
 
 #include <iostream>
 
@@ -41,7 +42,7 @@ float lastFrame = 0.0f;
 
 
 bool g_ShowBRDFLut = false;   // IBL间接光光照 - 镜面反射部分 - BRDF 2D-LUT图
-bool g_ShowIrradiance = false; // IBL间接光光照 - 漫反射部分 - 辐照图环境立方体贴图
+bool g_ShowIrradiance = false; // IBL间接光光照 - 漫反射部分 - SH9辐照度(天空盒上按方向重建)
 bool g_ShowPrefilter = false;    // IBL间接光光照 - 镜面反射部分 - 预滤波环境立方体贴图 
 bool g_DisableMipmapOnPrefilter = false;// 关闭prefilter预计算过程中使用mipmap 
 
@@ -62,7 +63,7 @@ void dump()
 		TRACE_DUMP(g_ShowBRDFLut, "B", "Override to Display BRDF 2D-LUT (priority first)");
 	}
 	{
-		TRACE_DUMP(g_ShowIrradiance, "I", "Override to Display Irradiance cubemap(priority second)");
+		TRACE_DUMP(g_ShowIrradiance, "I", "Override to Display SH9 Irradiance(priority second)");
 	}
 	{
 		TRACE_DUMP(g_ShowPrefilter, "P", "Override to Display Prefilter cubemap(priority third)");
@@ -167,13 +168,11 @@ int main()
     // -------------------------
     Shader pbrShader("2.2.1.pbr.vs", "2.2.1.pbr.fs");
     Shader equirectangularToCubemapShader("2.2.1.cubemap.vs", "2.2.1.equirectangular_to_cubemap.fs");
-    Shader irradianceShader("2.2.1.cubemap.vs", "2.2.1.irradiance_convolution.fs");
     Shader prefilterShader("2.2.1.cubemap.vs", "2.2.1.prefilter.fs");
     Shader brdfShader("2.2.1.brdf.vs", "2.2.1.brdf.fs");
     Shader backgroundShader("2.2.1.background.vs", "2.2.1.background.fs");
 
     pbrShader.use();
-    pbrShader.setInt("irradianceMap", 0);
     pbrShader.setInt("prefilterMap", 1);
     pbrShader.setInt("brdfLUT", 2);					  // shader中sampler预先设置好 将要绑定的纹理单元
 	#define BALL_COLOR 0.5f, 0.0f, 0.0f
@@ -303,47 +302,16 @@ int main()
 
 
 
-	// 间接光光照IBL-漫反射--预计算部分  辐照图立方体贴图(使用时，参数是宏表面法线, 不用粗糙度)
-    // pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
-    // --------------------------------------------------------------------------------
-    unsigned int irradianceMap;
-    glGenTextures(1, &irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-		// cubemap 只要 16x16  RGB 浮点 (不用mipmap)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO); // 单纯的深度buffer
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
-    // -----------------------------------------------------------------------------
-    irradianceShader.use();
-    irradianceShader.setInt("environmentMap", 0);
-    irradianceShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap); // 环境立方体贴图
-
-    glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        irradianceShader.setMat4("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// 在场景的中心, 渲染6个方向的场景(天空盒, 采样环境立方体贴图), 
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// 间接光光照IBL-漫反射--预计算部分  SH9球谐辐照度(使用时，参数是宏表面法线, 不用粗糙度)
+	// 不再渲染32x32的辐照图立方体贴图: 回读环境立方体贴图的mip4(32x32), CPU上6个面并行投影到9个系数,
+	// 放到UBO中, pbr.fs直接用法线计算SH, 少一个pass, 一张cubemap, 一次采样
+    // pbr: project the environment onto SH9 and upload the irradiance coefficients into a UBO.
+    // ----------------------------------------------------------------------------------------
+    SH9 irradianceSH = SH9::FromCubemap(envCubemap, 512, 4);
+    SH9UniformBuffer irradianceUBO(0);
+    irradianceUBO.Upload(irradianceSH);
+    irradianceUBO.Attach(pbrShader.ID);
+    irradianceUBO.Attach(backgroundShader.ID);
 
 
 
@@ -500,7 +468,7 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // render scene, supplying the convoluted irradiance map to the final shader.
+        // render scene, the SH9 irradiance coefficients are already bound through the UBO.
         // ------------------------------------------------------------------------------------------
         pbrShader.use();
         glm::mat4 view = camera.GetViewMatrix();
@@ -510,10 +478,8 @@ int main()
 		// printf("camera.Position = %f,%f,%f\n", camera.Position.x, camera.Position.y, camera.Position.z);
 
 
-		// 三个预计算的贴图
+		// 两个预计算的贴图 (辐照度在UBO中)
         // bind pre-computed IBL data
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
         glActiveTexture(GL_TEXTURE2);
@@ -574,17 +540,14 @@ int main()
             renderSphere();
         }
 
-		// 渲染天空盒  debug: 显示辐照图立方体贴图, 预滤波环境立方体贴图(level?)
+		// 渲染天空盒  debug: 显示SH9辐照度, 预滤波环境立方体贴图(level?)
         // render skybox (render as last to prevent overdraw)
         backgroundShader.use();
         backgroundShader.setMat4("view", view);
+        backgroundShader.setBool("showIrradianceSH", g_ShowIrradiance); // display SH9 irradiance
         glActiveTexture(GL_TEXTURE0);
 	 
-		if (g_ShowIrradiance)
-		{
-			glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap); // display irradiance map
-		}
-		else if (g_ShowPrefilter)
+		if (g_ShowPrefilter)
 		{
 			glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap); // display prefilter map
 		}
@@ -8,10 +8,12 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_build_queue.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
 #include <iostream>
+#include <string>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -36,8 +38,12 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+    // shader startup timing: run once with --cold (empty program binary cache) and once without to compare
+    if (argc > 1 && std::string(argv[1]) == "--cold")
+        ProgramCache::Clear();
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -85,12 +91,24 @@ int main()
 
     // build and compile shaders
     // -------------------------
-    Shader pbrShader("2.2.2.pbr.vs", "2.2.2.pbr.fs");
-    Shader equirectangularToCubemapShader("2.2.2.cubemap.vs", "2.2.2.equirectangular_to_cubemap.fs");
-    Shader irradianceShader("2.2.2.cubemap.vs", "2.2.2.irradiance_convolution.fs");
-    Shader prefilterShader("2.2.2.cubemap.vs", "2.2.2.prefilter.fs");
-    Shader brdfShader("2.2.2.brdf.vs", "2.2.2.brdf.fs");
-    Shader backgroundShader("2.2.2.background.vs", "2.2.2.background.fs");
+    // all programs are submitted together and compiled in parallel, errors are reported on first use
+    double shaderStart = glfwGetTime();
+    Shader pbrShader, equirectangularToCubemapShader, irradianceShader, prefilterShader, brdfShader, backgroundShader;
+    ShaderBuildQueue shaderQueue;
+    shaderQueue.Add(pbrShader, "2.2.2.pbr.vs", "2.2.2.pbr.fs");
+    shaderQueue.Add(equirectangularToCubemapShader, "2.2.2.cubemap.vs", "2.2.2.equirectangular_to_cubemap.fs");
+    shaderQueue.Add(irradianceShader, "2.2.2.cubemap.vs", "2.2.2.irradiance_convolution.fs");
+    shaderQueue.Add(prefilterShader, "2.2.2.cubemap.vs", "2.2.2.prefilter.fs");
+    shaderQueue.Add(brdfShader, "2.2.2.brdf.vs", "2.2.2.brdf.fs");
+    shaderQueue.Add(backgroundShader, "2.2.2.background.vs", "2.2.2.background.fs");
+    shaderQueue.Build((GLADloadproc)glfwGetProcAddress);
+    double shaderSubmitted = glfwGetTime();
+    glFinish();
+    const ProgramCacheStats &cacheStats = ProgramCache::Stats;
+    std::cout << "shader startup: " << (glfwGetTime() - shaderStart) * 1000.0 << " ms (submitted after "
+              << (shaderSubmitted - shaderStart) * 1000.0 << " ms" << (shaderQueue.ParallelCompile() ? ", parallel compile" : "") << ", "
+              << cacheStats.hits << " programs from cache, " << cacheStats.misses + cacheStats.rejected << " compiled, "
+              << cacheStats.rejected << " rejected binaries" << (ProgramCache::Supported() ? "" : ", program binaries not supported") << ")" << std::endl;
 
     pbrShader.use();
     pbrShader.setInt("irradianceMap", 0);
@@ -532,6 +550,9 @@ int main()
         glfwPollEvents();
     }
 
+    // programs of the queue that were never used still need their stages deleted (and binaries cached)
+    shaderQueue.Finish();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
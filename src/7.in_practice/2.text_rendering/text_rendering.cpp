@@ -1,5 +1,5 @@
 #include <iostream>
-#include <map>
+#include <random>
 #include <string>
 
 #include <glad/glad.h>
@@ -13,6 +13,7 @@
 #include FT_FREETYPE_H
 
 #include <learnopengl/filesystem.h>
+#include <learnopengl/glyph_cache.h>
 #include <learnopengl/shader.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -23,19 +24,13 @@ void RenderText(Shader &shader, std::string text, float x, float y, float scale,
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-/// Holds all state information relevant to a character as loaded using FreeType
-struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
-    glm::ivec2   Size;      // Size of glyph
-    glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
-    unsigned int Advance;   // Horizontal offset to advance to next glyph
-};
-
-std::map<wchar_t, Character> Characters;
+// glyphs are rasterized on first use, so any text in the font can be rendered
+GlyphCache Glyphs;
 unsigned int VAO, VBO;
 
 #include <string>
 #include <codecvt>
+#include <locale>
 
 std::wstring s2ws(const std::string& str)
 {
@@ -120,16 +115,8 @@ int main()
     shader.use();
     glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    // FreeType
-    // --------
-    FT_Library ft;
-    // All functions return a value different than 0 whenever an error occurred
-    if (FT_Init_FreeType(&ft))
-    {
-        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-        return -1;
-    }
-
+    // glyph cache
+    // -----------
 	// find path to font  字体库 
     std::string font_name = FileSystem::getPath("resources/fonts/LXGWWenKai-Regular.ttf");
     if (font_name.empty())
@@ -137,84 +124,28 @@ int main()
         std::cout << "ERROR::FREETYPE: Failed to load font_name" << std::endl;
         return -1;
     }
-	
-	// load font as face  将字体加载为"Face" ?  一个 FreeType face 包含一组字形 glyphs
-    FT_Face face;
-    if (FT_New_Face(ft, font_name.c_str(), 0, &face)) {
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+    // 字形在第一次使用时才由FreeType光栅化(在工作线程上), 存进图集页; 页数有上限, 满了就替换最久未使用的字形
+    // 2 pages of 1024x1024 at 48px hold ~800 glyphs in 2MB, whatever the size of the character set
+    if (!Glyphs.Init(font_name, 48, 1024, 2, 2))
         return -1;
-    }
-    else {
-        // set size to load glyphs as  字形的宽和高 宽为0让face根据高动态计算宽 
-        FT_Set_Pixel_Sizes(face, 0, 48);  
-
-        // disable byte-alignment restriction  关闭字节对齐
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        // 源文件要使用utf-8编码
-        std::wstring ustr = s2ws(std::string("预加载的字形OpenGL中文显示, 这是包含了所有要显示的字形演示实例"));
-
-        // load first 128 characters of ASCII set
-        for (unsigned char c = 0; c < ustr.size() ; c++)
-        {
-            //   typedef unsigned long  FT_ULong;
-            
-            
-
-            // Load character glyph  把其中一个字形设置为 活动字形
-            if (FT_Load_Char(face, ustr[c], FT_LOAD_RENDER))
-            {
-                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-                continue;
-            }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width, // 字形的宽和高 刚好是 纹理的大小 
-                face->glyph->bitmap.rows,  // 没有height只有rows作为高  
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            Character character = { // 一个字符串生成一个png图片 
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows), // 字形的宽高 刚好实际文字的开始和结束
-                glm::ivec2(face->glyph->bitmap_left,   face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x) // 单位是1/64pixels 所以是比较大的数字
-            };
-            Characters.insert(std::pair<wchar_t, Character>(ustr[c], character));
-        }
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
-    // destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
-
-    
-    // configure VAO/VBO for texture quads
-    // -----------------------------------
+    // configure VAO/VBO for texture quads (the buffer is resized as needed in RenderText)
+    // -----------------------------------------------------------------------------------
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
+    // random CJK text to stress the cache: a new line of CJK Unified Ideographs every 10 frames
+    std::minstd_rand random(2024);
+    std::wstring stressLine;
+    unsigned int frame = 0;
+    double lastTitleUpdate = glfwGetTime();
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -228,8 +159,29 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        RenderText(shader, "预加载的字形",              25.0f, 25.0f,     1.0f,    glm::vec3(0.5, 0.8f, 0.2f));
+        // upload the glyphs the workers rasterized since the last frame
+        Glyphs.Update();
+        if (frame++ % 10 == 0)
+        {
+            stressLine.clear();
+            for (int i = 0; i < 24; ++i)
+                stressLine += static_cast<wchar_t>(0x4E00 + random() % (0x9FFF - 0x4E00 + 1));
+        }
+
+        RenderText(shader, "按需加载的字形",              25.0f, 25.0f,     1.0f,    glm::vec3(0.5, 0.8f, 0.2f));
         RenderText(shader, "中文字形示例OpenGL",  540.0f, 570.0f,  0.5f,    glm::vec3(0.3, 0.7f, 0.9f));
+        RenderText(shader, ws2s(stressLine),  25.0f, 300.0f,  0.6f,    glm::vec3(0.9, 0.9f, 0.9f));
+
+        // cache statistics in the window title, once per second
+        if (glfwGetTime() - lastTitleUpdate > 1.0)
+        {
+            lastTitleUpdate = glfwGetTime();
+            const GlyphCacheStats &stats = Glyphs.Stats;
+            std::string title = "LearnOpenGL - glyphs: " + std::to_string(Glyphs.CachedCount()) + "/" + std::to_string(Glyphs.SlotCapacity()) +
+                " pages: " + std::to_string(Glyphs.PageCount()) + " hits: " + std::to_string(stats.hits) + " misses: " + std::to_string(stats.misses) +
+                " evictions: " + std::to_string(stats.evictions) + " uploads: " + std::to_string(stats.uploads);
+            glfwSetWindowTitle(window, title.c_str());
+        }
        
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -237,6 +189,7 @@ int main()
         glfwPollEvents();
     }
 
+    Glyphs.Destroy();
     glfwTerminate();
     return 0;
 }
@@ -265,25 +218,34 @@ void RenderText(Shader &shader, std::string text, float x, const float y, float
 {
     // x和y是这段文字的起始位置   y是基线
 
-    // activate corresponding render state	
-    shader.use();
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
+    // build the quads of all glyphs, grouped by the atlas page they live in
+    static std::vector<std::vector<float>> pageVertices;
+    for (std::vector<float> &vertices : pageVertices)
+        vertices.clear();
 
     // iterate through all characters
     std::wstring ws =  s2ws(text);
     
     for (auto itor = ws.begin(); itor != ws.end(); itor++)
     {
-        Character ch = Characters[*itor];
+        const CachedGlyph *ch = Glyphs.Get(static_cast<char32_t>(*itor));
+        // not cached (cache full with this batch) or still being rasterized: skip it this frame,
+        // but keep its room on the line so the following glyphs don't jump once it arrives
+        if (!ch || !ch->Ready)
+        {
+            x += (Glyphs.PlaceholderAdvance() >> 6) * scale;
+            continue;
+        }
 
         // x是以advance前进 
-        float xpos = x + ch.Bearing.x * scale; //  ch.Bearing.x 字形离原点的距离 
-        float ypos = y - (ch.Size.y - ch.Bearing.y) * scale; // ch.Size.y是字形的height  ch.Bearing.y是字形在base基线上的高度
+        float xpos = x + ch->Bearing.x * scale; //  ch->Bearing.x 字形离原点的距离 
+        float ypos = y - (ch->Size.y - ch->Bearing.y) * scale; // ch->Size.y是字形的height  ch->Bearing.y是字形在base基线上的高度
 
-        float w = ch.Size.x * scale;
-        float h = ch.Size.y * scale;
+        float w = ch->Size.x * scale;
+        float h = ch->Size.y * scale;
+        // 字形在图集页中的纹理坐标范围
+        float u0 = ch->UVRect.x, v0 = ch->UVRect.y;
+        float u1 = u0 + ch->UVRect.z, v1 = v0 + ch->UVRect.w;
 
         /*
           ypos + h       0(3)           (5)
@@ -295,28 +257,42 @@ void RenderText(Shader &shader, std::string text, float x, const float y, float
            逆时针 
         */
 
-        // update VBO for each character
         float vertices[6][4] = {
-            { xpos,       ypos + h,     0.0f, 0.0f },    // 顶点坐标xy,  纹理坐标zw        
-            { xpos,        ypos,          0.0f, 1.0f },
-            { xpos + w, ypos,          1.0f, 1.0f },
+            { xpos,       ypos + h,     u0, v0 },    // 顶点坐标xy,  纹理坐标zw        
+            { xpos,        ypos,          u0, v1 },
+            { xpos + w, ypos,          u1, v1 },
 
-            { xpos,        ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,         1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }           
+            { xpos,        ypos + h,   u0, v0 },
+            { xpos + w, ypos,         u1, v1 },
+            { xpos + w, ypos + h,   u1, v0 }           
         };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (pageVertices.size() <= ch->Page)
+            pageVertices.resize(ch->Page + 1);
+        pageVertices[ch->Page].insert(pageVertices[ch->Page].end(), &vertices[0][0], &vertices[0][0] + 24);
         // now advance cursors for next glyph (note that advance is number of 1/64 pixels)  advance 是 1/64 像素的数量
-        x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
+        x += (ch->Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
     }
+
+    // activate corresponding render state	
+    shader.use();
+    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // one draw call per atlas page instead of one per character
+    for (unsigned int page = 0; page < pageVertices.size(); ++page)
+    {
+        const std::vector<float> &vertices = pageVertices[page];
+        if (vertices.empty())
+            continue;
+        glBindTexture(GL_TEXTURE_2D, Glyphs.PageTexture(page));
+        // orphan the previous contents so the driver doesn't wait for the last draw
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size() / 4));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
+    // the glyphs of this line are drawn, their slots may be reused from now on
+    Glyphs.EndBatch();
 }
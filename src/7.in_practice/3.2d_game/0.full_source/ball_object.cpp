@@ -8,6 +8,9 @@
 ******************************************************************/
 #include "ball_object.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 BallObject::BallObject() 
     : GameObject(), Radius(12.5f), Stuck(true), Sticky(false), PassThrough(false)  { }
@@ -42,6 +45,82 @@ glm::vec2 BallObject::Move(float dt, unsigned int window_width)
     return this->Position;
 }
 
+bool BallObject::Sweep(const GameObject &box, float maxTime, float &time, glm::vec2 &normal) const
+{
+    glm::vec2 center = this->Position + this->Radius;
+    glm::vec2 boxMin = box.Position, boxMax = box.Position + box.Size;
+    // already touching: an immediate hit, as long as the ball is moving into the box
+    glm::vec2 offset = center - glm::clamp(center, boxMin, boxMax);
+    if (glm::dot(offset, offset) < this->Radius * this->Radius)
+    {
+        if (offset == glm::vec2(0.0f)) // center inside the box: push back against the velocity
+        {
+            if (this->Velocity == glm::vec2(0.0f))
+                return false;
+            normal = -glm::normalize(this->Velocity);
+        }
+        else
+            normal = glm::normalize(offset);
+        if (glm::dot(this->Velocity, normal) >= 0.0f)
+            return false;
+        time = 0.0f;
+        return true;
+    }
+    // the center touches the box once it enters the box grown by the radius (with rounded corners):
+    // first intersect the center's path with the grown box (slab test)...
+    float enter = 0.0f, exit = maxTime;
+    int axis = -1;
+    for (int i = 0; i < 2; ++i)
+    {
+        float low = boxMin[i] - this->Radius, high = boxMax[i] + this->Radius;
+        if (this->Velocity[i] == 0.0f)
+        {
+            if (center[i] < low || center[i] > high)
+                return false;
+            continue;
+        }
+        float t0 = (low - center[i]) / this->Velocity[i];
+        float t1 = (high - center[i]) / this->Velocity[i];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        if (t0 > enter)
+        {
+            enter = t0;
+            axis = i;
+        }
+        exit = std::min(exit, t1);
+        if (enter > exit)
+            return false;
+    }
+    // ...then, if that point lies beyond a corner of the box, against the circle around that corner
+    glm::vec2 point = center + this->Velocity * enter;
+    bool outsideX = point.x < boxMin.x || point.x > boxMax.x;
+    bool outsideY = point.y < boxMin.y || point.y > boxMax.y;
+    if (outsideX && outsideY)
+    {
+        glm::vec2 corner(point.x < boxMin.x ? boxMin.x : boxMax.x, point.y < boxMin.y ? boxMin.y : boxMax.y);
+        glm::vec2 m = center - corner;
+        float a = glm::dot(this->Velocity, this->Velocity);
+        float b = glm::dot(m, this->Velocity);
+        float c = glm::dot(m, m) - this->Radius * this->Radius;
+        float discriminant = b * b - a * c;
+        if (a == 0.0f || discriminant < 0.0f)
+            return false; // passes the corner
+        float t = (-b - std::sqrt(discriminant)) / a;
+        if (t < 0.0f || t > maxTime)
+            return false;
+        time = t;
+        normal = glm::normalize(m + this->Velocity * t);
+        return true;
+    }
+    if (axis < 0)
+        return false;
+    time = enter;
+    normal = glm::vec2(0.0f);
+    normal[axis] = this->Velocity[axis] > 0.0f ? -1.0f : 1.0f;
+    return true;
+}
+
 // resets the ball to initial Stuck Position (if ball is outside window bounds)
 void BallObject::Reset(glm::vec2 position, glm::vec2 velocity)
 {
@@ -32,6 +32,9 @@ public:
     BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite);
     // moves the ball, keeping it constrained within the window bounds (except bottom edge); returns new position
     glm::vec2 Move(float dt, unsigned int window_width);
+    // time of impact: the first time in [0, maxTime] at which the ball, moving at Velocity, touches box
+    // and the surface normal there; false if it doesn't hit (or is already moving away from the box)
+    bool      Sweep(const GameObject &box, float maxTime, float &time, glm::vec2 &normal) const;
     // resets the ball to original state with given position and velocity
     void      Reset(glm::vec2 position, glm::vec2 velocity);
 };
@@ -0,0 +1,136 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "collision_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+CollisionGrid::CollisionGrid()
+    : origin(0.0f), cellSize(1.0f), columns(0), rows(0)
+{
+
+}
+
+void CollisionGrid::Build(const std::vector<GameObject> &objects, glm::vec2 cellSize)
+{
+    this->Clear();
+    if (objects.empty() || cellSize.x <= 0.0f || cellSize.y <= 0.0f)
+        return;
+    // grid bounds: the union of all objects
+    glm::vec2 min = objects[0].Position, max = objects[0].Position + objects[0].Size;
+    for (const GameObject &object : objects)
+    {
+        min = glm::min(min, object.Position);
+        max = glm::max(max, object.Position + object.Size);
+    }
+    this->origin = min;
+    this->cellSize = cellSize;
+    this->columns = std::max(1, static_cast<int>(std::ceil((max.x - min.x) / cellSize.x)));
+    this->rows = std::max(1, static_cast<int>(std::ceil((max.y - min.y) / cellSize.y)));
+    unsigned int cellTotal = this->columns * this->rows;
+    // first pass counts the objects per cell, second pass fills the packed entries
+    std::vector<unsigned int> counts(cellTotal, 0);
+    glm::ivec2 first, last;
+    for (const GameObject &object : objects)
+    {
+        if (object.Destroyed || !this->cellRange(object.Position, object.Position + object.Size, true, first, last))
+            continue;
+        for (int y = first.y; y <= last.y; ++y)
+            for (int x = first.x; x <= last.x; ++x)
+                ++counts[y * this->columns + x];
+    }
+    this->cellStart.resize(cellTotal);
+    unsigned int total = 0;
+    for (unsigned int c = 0; c < cellTotal; ++c)
+    {
+        this->cellStart[c] = total;
+        total += counts[c];
+    }
+    this->cellCount.assign(cellTotal, 0);
+    this->entries.resize(total);
+    for (unsigned int i = 0; i < objects.size(); ++i)
+    {
+        const GameObject &object = objects[i];
+        if (object.Destroyed || !this->cellRange(object.Position, object.Position + object.Size, true, first, last))
+            continue;
+        for (int y = first.y; y <= last.y; ++y)
+            for (int x = first.x; x <= last.x; ++x)
+            {
+                unsigned int c = y * this->columns + x;
+                this->entries[this->cellStart[c] + this->cellCount[c]++] = i;
+            }
+    }
+}
+
+void CollisionGrid::Clear()
+{
+    this->columns = this->rows = 0;
+    this->cellStart.clear();
+    this->cellCount.clear();
+    this->entries.clear();
+}
+
+void CollisionGrid::Remove(unsigned int index, const GameObject &object)
+{
+    glm::ivec2 first, last;
+    if (!this->cellRange(object.Position, object.Position + object.Size, true, first, last))
+        return;
+    for (int y = first.y; y <= last.y; ++y)
+        for (int x = first.x; x <= last.x; ++x)
+        {
+            // swap-remove within the cell's range; order inside a cell doesn't matter
+            unsigned int c = y * this->columns + x;
+            unsigned int *cell = &this->entries[this->cellStart[c]];
+            for (unsigned int i = 0; i < this->cellCount[c]; ++i)
+                if (cell[i] == index)
+                {
+                    cell[i] = cell[--this->cellCount[c]];
+                    break;
+                }
+        }
+}
+
+void CollisionGrid::Query(glm::vec2 min, glm::vec2 max, std::vector<unsigned int> &result) const
+{
+    result.clear();
+    glm::ivec2 first, last;
+    if (!this->cellRange(min, max, false, first, last))
+        return;
+    for (int y = first.y; y <= last.y; ++y)
+        for (int x = first.x; x <= last.x; ++x)
+        {
+            unsigned int c = y * this->columns + x;
+            const unsigned int *cell = this->entries.data() + this->cellStart[c];
+            result.insert(result.end(), cell, cell + this->cellCount[c]);
+        }
+    // objects spanning several cells show up more than once; callers expect level order
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+bool CollisionGrid::cellRange(glm::vec2 min, glm::vec2 max, bool exclusive, glm::ivec2 &first, glm::ivec2 &last) const
+{
+    if (this->columns == 0)
+        return false;
+    glm::vec2 lo = (min - this->origin) / this->cellSize;
+    glm::vec2 hi = (max - this->origin) / this->cellSize;
+    // objects are bucketed with exclusive edges (a tile doesn't also land in its neighbors),
+    // queries are conservative and include the cells they only touch
+    glm::vec2 firstCell = exclusive ? glm::floor(lo) : glm::ceil(lo) - 1.0f;
+    glm::vec2 lastCell = exclusive ? glm::ceil(hi) - 1.0f : glm::floor(hi);
+    first = glm::ivec2(firstCell);
+    last = glm::ivec2(lastCell);
+    last = glm::max(last, first);
+    if (last.x < 0 || last.y < 0 || first.x >= static_cast<int>(this->columns) || first.y >= static_cast<int>(this->rows))
+        return false;
+    first = glm::max(first, glm::ivec2(0));
+    last = glm::min(last, glm::ivec2(this->columns - 1, this->rows - 1));
+    return true;
+}
@@ -0,0 +1,48 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef COLLISION_GRID_H
+#define COLLISION_GRID_H
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "game_object.h"
+
+
+// CollisionGrid is a uniform grid broadphase over a fixed set of
+// objects (the bricks of a level). Each cell stores the indices of
+// the objects overlapping it, packed into one array; destroyed objects
+// are removed from their cells without rebuilding. Queries only visit
+// the cells a box overlaps instead of every object.
+class CollisionGrid
+{
+public:
+    // constructor
+    CollisionGrid();
+    // buckets all non-destroyed objects into cells of the given size
+    void         Build(const std::vector<GameObject> &objects, glm::vec2 cellSize);
+    // removes every object
+    void         Clear();
+    // removes object 'index' (with its current position/size) from its cells
+    void         Remove(unsigned int index, const GameObject &object);
+    // stores the indices of all objects sharing a cell with box [min, max] in result, ascending and without duplicates
+    void         Query(glm::vec2 min, glm::vec2 max, std::vector<unsigned int> &result) const;
+    unsigned int Columns() const { return this->columns; }
+    unsigned int Rows() const { return this->rows; }
+private:
+    glm::vec2                 origin, cellSize;
+    unsigned int              columns, rows;
+    // cell c owns entries [cellStart[c], cellStart[c] + cellCount[c])
+    std::vector<unsigned int> cellStart, cellCount;
+    std::vector<unsigned int> entries;
+    // cell range covered by box [min, max]; false if it lies outside the grid
+    bool cellRange(glm::vec2 min, glm::vec2 max, bool exclusive, glm::ivec2 &first, glm::ivec2 &last) const;
+};
+
+#endif
@@ -7,6 +7,8 @@
 ** option) any later version.
 ******************************************************************/
 #include <algorithm>
+#include <chrono>
+#include <random>
 #include <sstream>
 #include <iostream>
 
@@ -18,6 +20,7 @@ using namespace irrklang;
 #include "game.h"
 #include "resource_manager.h"
 #include "sprite_renderer.h"
+#include "sprite_batch.h"
 #include "game_object.h"
 #include "ball_object.h"
 #include "particle_generator.h"
@@ -27,18 +30,28 @@ using namespace irrklang;
 
 // Game-related State data
 SpriteRenderer    *Renderer;
+SpriteBatch       *Batch;
 GameObject        *Player;
 BallObject        *Ball;
 ParticleGenerator *Particles;
 PostProcessor     *Effects;
-ISoundEngine      *SoundEngine = createIrrKlangDevice();
+ISoundEngine      *SoundEngine;
 TextRenderer      *Text;
 
 float ShakeTime = 0.0f;
+// post-processing effects as set by the simulation; they're copied onto
+// Effects when rendering, so the simulation also runs without a PostProcessor
+struct EffectState {
+    bool Confuse, Chaos, Shake;
+} EffectFlags;
+// level files; each is converted once to a binary level next to the executable
+const char *LevelNames[] = { "one", "two", "three", "four" };
+// bricks returned by the broadphase this frame (kept around to avoid reallocating)
+std::vector<unsigned int> BrickCandidates;
 
 
 Game::Game(unsigned int width, unsigned int height) 
-    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), Level(0), Lives(3)
+    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), Level(0), Lives(3), Headless(false), ShowProfile(false)
 { 
 
 }
@@ -46,72 +59,106 @@ Game::Game(unsigned int width, unsigned int height)
 Game::~Game()
 {
     delete Renderer;
+    delete Batch;
     delete Player;
     delete Ball;
     delete Particles;
     delete Effects;
     delete Text;
-    SoundEngine->drop();
+    if (SoundEngine)
+        SoundEngine->drop();
+}
+
+// plays a sound from the resources folder (no-op without audio, e.g. headless)
+void PlayAudio(const char *file, bool loop = false)
+{
+    if (SoundEngine)
+        SoundEngine->play2D(FileSystem::getPath(file).c_str(), loop);
 }
 
 void Game::Init()
+{
+    if (!this->Headless)
+        this->initGraphics();
+    // load levels
+    this->Levels.resize(4);
+    for (this->Level = 0; this->Level < 4; ++this->Level)
+        this->loadLevel();
+    this->Level = 0;
+    // configure game objects
+    glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
+    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetSprite("paddle"));
+    glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
+    Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("face"));
+    // audio
+    if (!this->Headless)
+    {
+        SoundEngine = createIrrKlangDevice();
+        PlayAudio("resources/audio/breakout.mp3", true);
+    }
+}
+
+void Game::initGraphics()
 {
     // load shaders
     ResourceManager::LoadShader("sprite.vs", "sprite.fs", nullptr, "sprite");
+    ResourceManager::LoadShader("sprite_batch.vs", "sprite_batch.fs", nullptr, "spritebatch");
     ResourceManager::LoadShader("particle.vs", "particle.fs", nullptr, "particle");
     ResourceManager::LoadShader("post_processing.vs", "post_processing.fs", nullptr, "postprocessing");
     // configure shaders
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width), static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
     ResourceManager::GetShader("sprite").Use().SetInteger("sprite", 0);
     ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
+    ResourceManager::GetShader("spritebatch").Use().SetInteger("sprite", 0);
+    ResourceManager::GetShader("spritebatch").SetMatrix4("projection", projection);
     ResourceManager::GetShader("particle").Use().SetInteger("sprite", 0);
     ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
     // load textures
     ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/background.jpg").c_str(), false, "background");
     ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/awesomeface.png").c_str(), true, "face");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/block.png").c_str(), false, "block");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/block_solid.png").c_str(), false, "block_solid");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/paddle.png").c_str(), true, "paddle");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/particle.png").c_str(), true, "particle");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_speed.png").c_str(), true, "powerup_speed");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_sticky.png").c_str(), true, "powerup_sticky");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_increase.png").c_str(), true, "powerup_increase");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_confuse.png").c_str(), true, "powerup_confuse");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_chaos.png").c_str(), true, "powerup_chaos");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_passthrough.png").c_str(), true, "powerup_passthrough");
+    // pack the small sprites into one atlas so they can share a texture (cached next to the executable)
+    std::vector<AtlasImage> sprites = {
+        { "block",               FileSystem::getPath("resources/textures/block.png"),               false },
+        { "block_solid",         FileSystem::getPath("resources/textures/block_solid.png"),         false },
+        { "paddle",              FileSystem::getPath("resources/textures/paddle.png"),              true  },
+        { "particle",            FileSystem::getPath("resources/textures/particle.png"),            true  },
+        { "powerup_speed",       FileSystem::getPath("resources/textures/powerup_speed.png"),       true  },
+        { "powerup_sticky",      FileSystem::getPath("resources/textures/powerup_sticky.png"),      true  },
+        { "powerup_increase",    FileSystem::getPath("resources/textures/powerup_increase.png"),    true  },
+        { "powerup_confuse",     FileSystem::getPath("resources/textures/powerup_confuse.png"),     true  },
+        { "powerup_chaos",       FileSystem::getPath("resources/textures/powerup_chaos.png"),       true  },
+        { "powerup_passthrough", FileSystem::getPath("resources/textures/powerup_passthrough.png"), true  },
+    };
+    ResourceManager::LoadAtlas(sprites, "breakout_sprites.atlas", 4, "sprites");
     // set render-specific controls
     Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
-    Particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500);
+    Batch = new SpriteBatch(ResourceManager::GetShader("spritebatch"));
+    Particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetSprite("particle"), 500);
     Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
     Text = new TextRenderer(this->Width, this->Height);
     Text->Load(FileSystem::getPath("resources/fonts/OCRAEXT.TTF").c_str(), 24);
-    // load levels
-    GameLevel one; one.Load(FileSystem::getPath("resources/levels/one.lvl").c_str(), this->Width, this->Height / 2);
-    GameLevel two; two.Load(FileSystem::getPath("resources/levels/two.lvl").c_str(), this->Width, this->Height /2 );
-    GameLevel three; three.Load(FileSystem::getPath("resources/levels/three.lvl").c_str(), this->Width, this->Height / 2);
-    GameLevel four; four.Load(FileSystem::getPath("resources/levels/four.lvl").c_str(), this->Width, this->Height / 2);
-    this->Levels.push_back(one);
-    this->Levels.push_back(two);
-    this->Levels.push_back(three);
-    this->Levels.push_back(four);
-    this->Level = 0;
-    // configure game objects
-    glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"));
-    glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
-    Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("face"));
-    // audio
-    SoundEngine->play2D(FileSystem::getPath("resources/audio/breakout.mp3").c_str(), true);
+}
+
+void Game::Step(float dt)
+{
+    // remember where moving objects were, so Render can interpolate towards the new state
+    Player->PreviousPosition = Player->Position;
+    Ball->PreviousPosition = Ball->Position;
+    for (PowerUp &powerUp : this->PowerUps)
+        powerUp.PreviousPosition = powerUp.Position;
+    this->ProcessInput(dt);
+    this->Update(dt);
 }
 
 void Game::Update(float dt)
 {
-    // update objects
-    Ball->Move(dt, this->Width);
-    // check for collisions
+    // update objects (the ball resolves its own impacts along the way)
+    this->MoveBall(dt);
+    // check for remaining collisions
     this->DoCollisions();
     // update particles
-    Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
+    if (Particles)
+        Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
     // update PowerUps
     this->UpdatePowerUps(dt);
     // reduce shake time
@@ -119,7 +166,7 @@ void Game::Update(float dt)
     {
         ShakeTime -= dt;
         if (ShakeTime <= 0.0f)
-            Effects->Shake = false;
+            EffectFlags.Shake = false;
     }
     // check loss condition
     if (Ball->Position.y >= this->Height) // did ball reach bottom edge?
@@ -138,7 +185,7 @@ void Game::Update(float dt)
     {
         this->ResetLevel();
         this->ResetPlayer();
-        Effects->Chaos = true;
+        EffectFlags.Chaos = true;
         this->State = GAME_WIN;
     }
 }
@@ -173,7 +220,7 @@ void Game::ProcessInput(float dt)
         if (this->Keys[GLFW_KEY_ENTER])
         {
             this->KeysProcessed[GLFW_KEY_ENTER] = true;
-            Effects->Chaos = false;
+            EffectFlags.Chaos = false;
             this->State = GAME_MENU;
         }
     }
@@ -204,69 +251,102 @@ void Game::ProcessInput(float dt)
     }
 }
 
-void Game::Render()
+void Game::Render(float alpha)
 {
     if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
     {
+        Effects->Confuse = EffectFlags.Confuse;
+        Effects->Chaos = EffectFlags.Chaos;
+        Effects->Shake = EffectFlags.Shake;
         // begin rendering to postprocessing framebuffer
+        this->Profiler.Begin("scene");
         Effects->BeginRender();
-            // draw background
-            Renderer->DrawSprite(ResourceManager::GetTexture("background"), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
-            // draw level
-            this->Levels[this->Level].Draw(*Renderer);
-            // draw player
-            Player->Draw(*Renderer);
-            // draw PowerUps
-            for (PowerUp &powerUp : this->PowerUps)
-                if (!powerUp.Destroyed)
-                    powerUp.Draw(*Renderer);
+            // batch background, level, player and PowerUps: one instanced draw per layer/texture
+            this->Profiler.Begin("sprites");
+            Batch->Begin();
+                // draw background
+                Batch->Draw(ResourceManager::GetTexture("background"), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f, glm::vec3(1.0f), 0);
+                // draw level
+                this->Levels[this->Level].Draw(*Batch, 1);
+                // draw player
+                Player->Draw(*Batch, 2, alpha);
+                // draw PowerUps
+                for (PowerUp &powerUp : this->PowerUps)
+                    if (!powerUp.Destroyed)
+                        powerUp.Draw(*Batch, 2, alpha);
+            Batch->End();
+            this->Profiler.End();
             // draw particles	
+            this->Profiler.Begin("particles");
             Particles->Draw();
-            // draw ball
-            Ball->Draw(*Renderer);            
+            this->Profiler.End();
+            // draw ball (after the particles, so it stays on top of its trail)
+            Ball->Draw(*Renderer, alpha);            
         // end rendering to postprocessing framebuffer
         Effects->EndRender();
+        this->Profiler.End();
         // render postprocessing quad
+        this->Profiler.Begin("postprocess");
         Effects->Render(glfwGetTime());
+        this->Profiler.End();
         // render text (don't include in postprocessing)
         std::stringstream ss; ss << this->Lives;
-        Text->RenderText("Lives:" + ss.str(), 5.0f, 5.0f, 1.0f);
+        Text->QueueText("Lives:" + ss.str(), 5.0f, 5.0f, 1.0f);
     }
     if (this->State == GAME_MENU)
     {
-        Text->RenderText("Press ENTER to start", 250.0f, this->Height / 2.0f, 1.0f);
-        Text->RenderText("Press W or S to select level", 245.0f, this->Height / 2.0f + 20.0f, 0.75f);
+        Text->QueueText("Press ENTER to start", 250.0f, this->Height / 2.0f, 1.0f);
+        Text->QueueText("Press W or S to select level", 245.0f, this->Height / 2.0f + 20.0f, 0.75f);
     }
     if (this->State == GAME_WIN)
     {
-        Text->RenderText("You WON!!!", 320.0f, this->Height / 2.0f - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-        Text->RenderText("Press ENTER to retry or ESC to quit", 130.0f, this->Height / 2.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f));
+        Text->QueueText("You WON!!!", 320.0f, this->Height / 2.0f - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+        Text->QueueText("Press ENTER to retry or ESC to quit", 130.0f, this->Height / 2.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f));
     }
+    // profiler overlay: the pass breakdown of a few frames ago, one line per pass
+    if (this->ShowProfile)
+    {
+        std::istringstream report(this->Profiler.Report());
+        std::string line;
+        float y = 30.0f;
+        while (std::getline(report, line))
+        {
+            Text->QueueText(line, 5.0f, y, 0.5f, glm::vec3(1.0f, 1.0f, 0.0f));
+            y += 12.0f;
+        }
+    }
+    // all text in one draw call
+    this->Profiler.Begin("text");
+    Text->Flush();
+    this->Profiler.End();
 }
 
 
 void Game::ResetLevel()
 {
-    if (this->Level == 0)
-        this->Levels[0].Load("levels/one.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 1)
-        this->Levels[1].Load("levels/two.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 2)
-        this->Levels[2].Load("levels/three.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 3)
-        this->Levels[3].Load("levels/four.lvl", this->Width, this->Height / 2);
+    this->loadLevel();
 
     this->Lives = 3;
 }
 
+void Game::loadLevel()
+{
+    std::string name = LevelNames[this->Level];
+    std::string textFile = FileSystem::getPath("resources/levels/" + name + ".lvl");
+    this->Levels[this->Level].LoadCached(textFile.c_str(), (name + ".blvl").c_str(), this->Width, this->Height / 2);
+}
+
 void Game::ResetPlayer()
 {
     // reset player/ball stats
     Player->Size = PLAYER_SIZE;
     Player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
     Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
+    // teleported, don't interpolate from the old positions
+    Player->PreviousPosition = Player->Position;
+    Ball->PreviousPosition = Ball->Position;
     // also disable all active powerups
-    Effects->Chaos = Effects->Confuse = false;
+    EffectFlags.Chaos = EffectFlags.Confuse = false;
     Ball->PassThrough = Ball->Sticky = false;
     Player->Color = glm::vec3(1.0f);
     Ball->Color = glm::vec3(1.0f);
@@ -310,14 +390,14 @@ void Game::UpdatePowerUps(float dt)
                 {
                     if (!IsOtherPowerUpActive(this->PowerUps, "confuse"))
                     {	// only reset if no other PowerUp of type confuse is active
-                        Effects->Confuse = false;
+                        EffectFlags.Confuse = false;
                     }
                 }
                 else if (powerUp.Type == "chaos")
                 {
                     if (!IsOtherPowerUpActive(this->PowerUps, "chaos"))
                     {	// only reset if no other PowerUp of type chaos is active
-                        Effects->Chaos = false;
+                        EffectFlags.Chaos = false;
                     }
                 }
             }
@@ -330,25 +410,25 @@ void Game::UpdatePowerUps(float dt)
     ), this->PowerUps.end());
 }
 
-bool ShouldSpawn(unsigned int chance)
+bool ShouldSpawn(std::minstd_rand &generator, unsigned int chance)
 {
-    unsigned int random = rand() % chance;
+    unsigned int random = generator() % chance;
     return random == 0;
 }
 void Game::SpawnPowerUps(GameObject &block)
 {
-    if (ShouldSpawn(75)) // 1 in 75 chance
-        this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_speed")));
-    if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, block.Position, ResourceManager::GetTexture("powerup_sticky")));
-    if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, block.Position, ResourceManager::GetTexture("powerup_passthrough")));
-    if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, block.Position, ResourceManager::GetTexture("powerup_increase")));
-    if (ShouldSpawn(15)) // Negative powerups should spawn more often
-        this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_confuse")));
-    if (ShouldSpawn(15))
-        this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_chaos")));
+    if (ShouldSpawn(this->Random, 75)) // 1 in 75 chance
+        this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, block.Position, ResourceManager::GetSprite("powerup_speed")));
+    if (ShouldSpawn(this->Random, 75))
+        this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, block.Position, ResourceManager::GetSprite("powerup_sticky")));
+    if (ShouldSpawn(this->Random, 75))
+        this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, block.Position, ResourceManager::GetSprite("powerup_passthrough")));
+    if (ShouldSpawn(this->Random, 75))
+        this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, block.Position, ResourceManager::GetSprite("powerup_increase")));
+    if (ShouldSpawn(this->Random, 15)) // Negative powerups should spawn more often
+        this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, block.Position, ResourceManager::GetSprite("powerup_confuse")));
+    if (ShouldSpawn(this->Random, 15))
+        this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, block.Position, ResourceManager::GetSprite("powerup_chaos")));
 }
 
 void ActivatePowerUp(PowerUp &powerUp)
@@ -373,13 +453,13 @@ void ActivatePowerUp(PowerUp &powerUp)
     }
     else if (powerUp.Type == "confuse")
     {
-        if (!Effects->Chaos)
-            Effects->Confuse = true; // only activate if chaos wasn't already active
+        if (!EffectFlags.Chaos)
+            EffectFlags.Confuse = true; // only activate if chaos wasn't already active
     }
     else if (powerUp.Type == "chaos")
     {
-        if (!Effects->Confuse)
-            Effects->Chaos = true;
+        if (!EffectFlags.Confuse)
+            EffectFlags.Chaos = true;
     }
 }
 
@@ -401,55 +481,30 @@ bool IsOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type)
 bool CheckCollision(GameObject &one, GameObject &two);
 Collision CheckCollision(BallObject &one, GameObject &two);
 Direction VectorDirection(glm::vec2 closest);
+void ResolveCollision(BallObject &ball, GameObject &box, Collision collision);
+void QueryBrickCandidates(GameLevel &level, BallObject &ball, unsigned int first, std::vector<unsigned int> &candidates);
 
 void Game::DoCollisions()
 {
-    for (GameObject &box : this->Levels[this->Level].Bricks)
+    GameLevel &level = this->Levels[this->Level];
+    // broadphase: only test the bricks in cells near the ball
+    QueryBrickCandidates(level, *Ball, 0, BrickCandidates);
+    unsigned int next = 0;
+    while (next < BrickCandidates.size())
     {
+        unsigned int index = BrickCandidates[next++];
+        GameObject &box = level.Bricks[index];
         if (!box.Destroyed)
         {
             Collision collision = CheckCollision(*Ball, box);
             if (std::get<0>(collision)) // if collision is true
             {
-                // destroy block if not solid
-                if (!box.IsSolid)
-                {
-                    box.Destroyed = true;
-                    this->SpawnPowerUps(box);
-                    SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.mp3").c_str(), false);
-                }
-                else
-                {   // if block is solid, enable shake effect
-                    ShakeTime = 0.05f;
-                    Effects->Shake = true;
-                    SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.mp3").c_str(), false);
-                }
+                this->hitBrick(index);
                 // collision resolution
-                Direction dir = std::get<1>(collision);
-                glm::vec2 diff_vector = std::get<2>(collision);
-                if (!(Ball->PassThrough && !box.IsSolid)) // don't do collision resolution on non-solid bricks if pass-through is activated
-                {
-                    if (dir == LEFT || dir == RIGHT) // horizontal collision
-                    {
-                        Ball->Velocity.x = -Ball->Velocity.x; // reverse horizontal velocity
-                        // relocate
-                        float penetration = Ball->Radius - std::abs(diff_vector.x);
-                        if (dir == LEFT)
-                            Ball->Position.x += penetration; // move ball to right
-                        else
-                            Ball->Position.x -= penetration; // move ball to left;
-                    }
-                    else // vertical collision
-                    {
-                        Ball->Velocity.y = -Ball->Velocity.y; // reverse vertical velocity
-                        // relocate
-                        float penetration = Ball->Radius - std::abs(diff_vector.y);
-                        if (dir == UP)
-                            Ball->Position.y -= penetration; // move ball bback up
-                        else
-                            Ball->Position.y += penetration; // move ball back down
-                    }
-                }
+                ResolveCollision(*Ball, box, collision);
+                // the ball may have moved: continue with the later bricks around its new position
+                QueryBrickCandidates(level, *Ball, index + 1, BrickCandidates);
+                next = 0;
             }
         }    
     }
@@ -468,32 +523,163 @@ void Game::DoCollisions()
                 ActivatePowerUp(powerUp);
                 powerUp.Destroyed = true;
                 powerUp.Activated = true;
-                SoundEngine->play2D(FileSystem::getPath("resources/audio/powerup.wav").c_str(), false);
+                PlayAudio("resources/audio/powerup.wav");
             }
         }
     }
 
-    // and finally check collisions for player pad (unless stuck)
+    // and finally check collisions for player pad (unless stuck); MoveBall already bounces the
+    // ball off the paddle, this catches the paddle moving into the ball
     Collision result = CheckCollision(*Ball, *Player);
     if (!Ball->Stuck && std::get<0>(result))
+        this->hitPaddle();
+}
+
+void Game::MoveBall(float dt)
+{
+    if (Ball->Stuck)
+        return;
+    GameLevel &level = this->Levels[this->Level];
+    float remaining = dt;
+    for (unsigned int impact = 0; impact < MAX_BALL_IMPACTS && remaining > 0.0f; ++impact)
+    {
+        // find the earliest impact within the rest of this step
+        float hitTime = remaining;
+        glm::vec2 hitNormal(0.0f);
+        int hitBrickIndex = -1;
+        bool hitWall = false, hitPlayer = false;
+        float time;
+        glm::vec2 normal;
+        // walls: left, right and top (the bottom edge is open)
+        float right = this->Width - 2.0f * Ball->Radius;
+        if (Ball->Velocity.x < 0.0f && (time = std::max(0.0f, -Ball->Position.x / Ball->Velocity.x)) < hitTime)
+        {
+            hitTime = time; hitNormal = glm::vec2(1.0f, 0.0f); hitWall = true;
+        }
+        if (Ball->Velocity.x > 0.0f && (time = std::max(0.0f, (right - Ball->Position.x) / Ball->Velocity.x)) < hitTime)
+        {
+            hitTime = time; hitNormal = glm::vec2(-1.0f, 0.0f); hitWall = true;
+        }
+        if (Ball->Velocity.y < 0.0f && (time = std::max(0.0f, -Ball->Position.y / Ball->Velocity.y)) < hitTime)
+        {
+            hitTime = time; hitNormal = glm::vec2(0.0f, 1.0f); hitWall = true;
+        }
+        // bricks: only those in cells covered by the ball's path (ties go to the first brick in level order)
+        glm::vec2 from = Ball->Position, to = Ball->Position + Ball->Velocity * remaining;
+        level.Grid.Query(glm::min(from, to), glm::max(from, to) + 2.0f * Ball->Radius, BrickCandidates);
+        for (unsigned int index : BrickCandidates)
+        {
+            if (!level.Bricks[index].Destroyed && Ball->Sweep(level.Bricks[index], hitTime, time, normal) && time < hitTime)
+            {
+                hitTime = time; hitNormal = normal; hitBrickIndex = index; hitWall = false;
+            }
+        }
+        // paddle
+        if (Ball->Sweep(*Player, hitTime, time, normal) && time < hitTime)
+        {
+            hitTime = time; hitNormal = normal; hitPlayer = true; hitBrickIndex = -1; hitWall = false;
+        }
+        // advance to the impact (or the end of the step) and respond
+        Ball->Position += Ball->Velocity * hitTime;
+        remaining -= hitTime;
+        if (hitPlayer)
+        {
+            this->hitPaddle();
+            if (Ball->Stuck)
+                return;
+        }
+        else if (hitBrickIndex >= 0)
+        {
+            bool passThrough = Ball->PassThrough && !level.Bricks[hitBrickIndex].IsSolid;
+            this->hitBrick(hitBrickIndex);
+            if (!passThrough)
+                Ball->Velocity -= 2.0f * glm::dot(Ball->Velocity, hitNormal) * hitNormal;
+        }
+        else if (hitWall)
+            Ball->Velocity -= 2.0f * glm::dot(Ball->Velocity, hitNormal) * hitNormal;
+        else
+            return; // no impact: moved through the whole step
+    }
+    // out of impacts for this step: move the rest of the way discretely (DoCollisions resolves overlaps)
+    if (remaining > 0.0f)
+        Ball->Move(remaining, this->Width);
+}
+
+void Game::hitBrick(unsigned int index)
+{
+    GameLevel &level = this->Levels[this->Level];
+    GameObject &box = level.Bricks[index];
+    // destroy block if not solid
+    if (!box.IsSolid)
     {
-        // check where it hit the board, and change velocity based on where it hit the board
-        float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
-        float distance = (Ball->Position.x + Ball->Radius) - centerBoard;
-        float percentage = distance / (Player->Size.x / 2.0f);
-        // then move accordingly
-        float strength = 2.0f;
-        glm::vec2 oldVelocity = Ball->Velocity;
-        Ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength; 
-        //Ball->Velocity.y = -Ball->Velocity.y;
-        Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity); // keep speed consistent over both axes (multiply by length of old velocity, so total strength is not changed)
-        // fix sticky paddle
-        Ball->Velocity.y = -1.0f * abs(Ball->Velocity.y);
-
-        // if Sticky powerup is activated, also stick ball to paddle once new velocity vectors were calculated
-        Ball->Stuck = Ball->Sticky;
-
-        SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.wav").c_str(), false);
+        level.DestroyBrick(index);
+        this->SpawnPowerUps(box);
+        PlayAudio("resources/audio/bleep.mp3");
+    }
+    else
+    {   // if block is solid, enable shake effect
+        ShakeTime = 0.05f;
+        EffectFlags.Shake = true;
+        PlayAudio("resources/audio/bleep.mp3");
+    }
+}
+
+void Game::hitPaddle()
+{
+    // check where it hit the board, and change velocity based on where it hit the board
+    float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
+    float distance = (Ball->Position.x + Ball->Radius) - centerBoard;
+    float percentage = distance / (Player->Size.x / 2.0f);
+    // then move accordingly
+    float strength = 2.0f;
+    glm::vec2 oldVelocity = Ball->Velocity;
+    Ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength; 
+    //Ball->Velocity.y = -Ball->Velocity.y;
+    Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity); // keep speed consistent over both axes (multiply by length of old velocity, so total strength is not changed)
+    // fix sticky paddle
+    Ball->Velocity.y = -1.0f * abs(Ball->Velocity.y);
+
+    // if Sticky powerup is activated, also stick ball to paddle once new velocity vectors were calculated
+    Ball->Stuck = Ball->Sticky;
+
+    PlayAudio("resources/audio/bleep.wav");
+}
+
+// bricks in the cells overlapped by the ball, in level order starting at brick 'first'; visiting
+// these (and querying again after every resolution) tests the same bricks in the same order as
+// a full scan of the level would
+void QueryBrickCandidates(GameLevel &level, BallObject &ball, unsigned int first, std::vector<unsigned int> &candidates)
+{
+    level.Grid.Query(ball.Position, ball.Position + 2.0f * ball.Radius, candidates);
+    candidates.erase(candidates.begin(), std::lower_bound(candidates.begin(), candidates.end(), first));
+}
+
+void ResolveCollision(BallObject &ball, GameObject &box, Collision collision)
+{
+    Direction dir = std::get<1>(collision);
+    glm::vec2 diff_vector = std::get<2>(collision);
+    if (!(ball.PassThrough && !box.IsSolid)) // don't do collision resolution on non-solid bricks if pass-through is activated
+    {
+        if (dir == LEFT || dir == RIGHT) // horizontal collision
+        {
+            ball.Velocity.x = -ball.Velocity.x; // reverse horizontal velocity
+            // relocate
+            float penetration = ball.Radius - std::abs(diff_vector.x);
+            if (dir == LEFT)
+                ball.Position.x += penetration; // move ball to right
+            else
+                ball.Position.x -= penetration; // move ball to left;
+        }
+        else // vertical collision
+        {
+            ball.Velocity.y = -ball.Velocity.y; // reverse vertical velocity
+            // relocate
+            float penetration = ball.Radius - std::abs(diff_vector.y);
+            if (dir == UP)
+                ball.Position.y -= penetration; // move ball bback up
+            else
+                ball.Position.y += penetration; // move ball back down
+        }
     }
 }
 
@@ -552,3 +738,141 @@ Direction VectorDirection(glm::vec2 target)
     }
     return (Direction)best_match;
 }
+
+
+// collision benchmark
+void BenchmarkCollisions(unsigned int columns, unsigned int rows, unsigned int frames)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const float dt = 1.0f / 60.0f;
+    const glm::vec2 brickSize(40.0f, 20.0f);
+    // generate a fixed random layout: ~10% solid, ~60% breakable, the rest empty
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<unsigned int> tileDistribution(0, 9);
+    std::vector<std::vector<unsigned int>> tileData(rows, std::vector<unsigned int>(columns));
+    for (std::vector<unsigned int> &row : tileData)
+        for (unsigned int &tile : row)
+        {
+            unsigned int roll = tileDistribution(generator);
+            tile = roll == 0 ? 1 : (roll <= 6 ? 2 + roll % 4 : 0);
+        }
+    unsigned int levelWidth = static_cast<unsigned int>(columns * brickSize.x), levelHeight = static_cast<unsigned int>(rows * brickSize.y);
+    // leave room below the bricks for the ball to come back down
+    float worldHeight = levelHeight * 1.25f + 100.0f;
+    GameLevel source;
+    source.Load(tileData, levelWidth, levelHeight);
+    std::cout << "Collision benchmark: " << columns << "x" << rows << " level (" << source.Bricks.size() << " bricks, "
+              << source.Grid.Columns() << "x" << source.Grid.Rows() << " grid cells), " << frames << " frames" << std::endl;
+
+    // replay the same ball through the level with and without the broadphase; results must match
+    glm::vec2 finalPosition[2];
+    unsigned int destroyed[2];
+    for (int useGrid = 0; useGrid < 2; ++useGrid)
+    {
+        GameLevel level = source;
+        BallObject ball(glm::vec2(levelWidth / 2.0f, worldHeight - 4.0f * BALL_RADIUS), BALL_RADIUS, glm::vec2(2000.0f, -2400.0f), ResourceManager::GetTexture("face"));
+        ball.Stuck = false;
+        std::vector<unsigned int> candidates;
+        unsigned int tests = 0;
+        destroyed[useGrid] = 0;
+        double ms = 0.0;
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            ball.Move(dt, levelWidth);
+            // bounce off the bottom edge instead of losing a life
+            if (ball.Position.y + 2.0f * ball.Radius >= worldHeight)
+            {
+                ball.Velocity.y = -std::abs(ball.Velocity.y);
+                ball.Position.y = worldHeight - 2.0f * ball.Radius;
+            }
+            auto start = Clock::now();
+            if (useGrid)
+                QueryBrickCandidates(level, ball, 0, candidates);
+            unsigned int next = 0;
+            while (next < (useGrid ? candidates.size() : level.Bricks.size()))
+            {
+                unsigned int index = useGrid ? candidates[next++] : next++;
+                GameObject &box = level.Bricks[index];
+                if (box.Destroyed)
+                    continue;
+                ++tests;
+                Collision collision = CheckCollision(ball, box);
+                if (std::get<0>(collision))
+                {
+                    if (!box.IsSolid)
+                    {
+                        level.DestroyBrick(index);
+                        ++destroyed[useGrid];
+                    }
+                    ResolveCollision(ball, box, collision);
+                    if (useGrid)
+                    {
+                        QueryBrickCandidates(level, ball, index + 1, candidates);
+                        next = 0;
+                    }
+                }
+            }
+            ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+        finalPosition[useGrid] = ball.Position;
+        std::cout << "  " << (useGrid ? "uniform grid" : "brute force ") << ": " << ms / frames << " ms/frame, "
+                  << static_cast<double>(tests) / frames << " narrowphase tests/frame, " << destroyed[useGrid] << " bricks destroyed" << std::endl;
+    }
+    bool match = destroyed[0] == destroyed[1] && finalPosition[0] == finalPosition[1];
+    std::cout << "  replays " << (match ? "match" : "DIFFER") << std::endl;
+}
+
+
+// headless simulation
+void SimulateGames(Game &game, unsigned int games, unsigned int seed, float dt)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    // give up on games the autopilot can neither win nor lose (10 simulated minutes)
+    const unsigned int maxSteps = static_cast<unsigned int>(600.0f / dt);
+    game.Random.seed(seed);
+    // the autopilot aims at the ball with an offset that changes on every paddle hit, so it also misses
+    std::minstd_rand autopilot(seed);
+    std::uniform_real_distribution<float> aimDistribution(-0.6f, 0.6f);
+    unsigned int wins = 0, losses = 0, timeouts = 0;
+    unsigned long long totalSteps = 0, checksum = 0;
+    auto start = Clock::now();
+    for (unsigned int n = 0; n < games; ++n)
+    {
+        game.Level = n % game.Levels.size();
+        game.ResetLevel();
+        game.ResetPlayer();
+        game.PowerUps.clear();
+        game.State = GAME_ACTIVE;
+        float aim = 0.0f;
+        bool rising = true;
+        unsigned int steps = 0;
+        while (game.State == GAME_ACTIVE && steps < maxSteps)
+        {
+            // new aim whenever the ball turns back down towards the paddle
+            if (rising && Ball->Velocity.y > 0.0f)
+                aim = aimDistribution(autopilot) * Player->Size.x;
+            rising = Ball->Velocity.y <= 0.0f;
+            float target = Ball->Position.x + Ball->Radius + aim;
+            float paddle = Player->Position.x + Player->Size.x / 2.0f;
+            game.Keys[GLFW_KEY_A] = target < paddle - 5.0f;
+            game.Keys[GLFW_KEY_D] = target > paddle + 5.0f;
+            game.Keys[GLFW_KEY_SPACE] = true;
+            game.Step(dt);
+            ++steps;
+        }
+        if (game.State == GAME_WIN)
+            ++wins;
+        else if (game.State == GAME_MENU)
+            ++losses;
+        else
+            ++timeouts;
+        totalSteps += steps;
+        // fold the outcome into the checksum (FNV-1a style)
+        checksum = (checksum ^ (steps * 4ull + game.State)) * 1099511628211ull;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Simulated " << games << " games (" << wins << " won, " << losses << " lost, " << timeouts << " timed out), "
+              << totalSteps << " steps in " << seconds << " s: " << totalSteps / seconds << " steps/s, "
+              << games / seconds << " games/s" << std::endl;
+    std::cout << "  checksum " << std::hex << checksum << std::dec << " (seed " << seed << ")" << std::endl;
+}
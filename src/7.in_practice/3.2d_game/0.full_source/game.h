@@ -10,10 +10,13 @@
 #define GAME_H
 #include <vector>
 #include <tuple>
+#include <random>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <learnopengl/gpu_profiler.h>
+
 #include "game_level.h"
 #include "power_up.h"
 
@@ -42,6 +45,8 @@ const float PLAYER_VELOCITY(500.0f);
 const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -350.0f);
 // Radius of the ball object
 const float BALL_RADIUS = 12.5f;
+// Most impacts the ball resolves continuously within one simulation step
+const unsigned int MAX_BALL_IMPACTS = 16;
 
 // Game holds all game-related state and functionality.
 // Combines all game-related data into a single class for
@@ -58,15 +63,24 @@ public:
     std::vector<PowerUp>    PowerUps;
     unsigned int            Level;
     unsigned int            Lives;
+    // simulation only: no rendering, audio or GL resources (set before Init)
+    bool                    Headless;
+    // all gameplay randomness (PowerUp spawns); seed it for reproducible runs
+    std::minstd_rand        Random;
+    // GPU/CPU time of each render pass; ShowProfile draws the breakdown on screen
+    GpuProfiler             Profiler;
+    bool                    ShowProfile;
     // constructor/destructor
     Game(unsigned int width, unsigned int height);
     ~Game();
     // initialize game state (load all shaders/textures/levels)
     void Init();
     // game loop
+    void Step(float dt); // one fixed simulation step: ProcessInput and Update
     void ProcessInput(float dt);
     void Update(float dt);
-    void Render();
+    void Render(float alpha = 1.0f); // alpha: progress into the next simulation step, for interpolation
+    void MoveBall(float dt); // continuous: advances the ball from impact to impact (walls, bricks, paddle)
     void DoCollisions();
     // reset
     void ResetLevel();
@@ -74,6 +88,24 @@ public:
     // powerups
     void SpawnPowerUps(GameObject &block);
     void UpdatePowerUps(float dt);
+private:
+    // load shaders/textures and create renderers, post-processing and text (skipped when headless)
+    void initGraphics();
+    // effects of the ball hitting a brick of the current level (destroy/spawn PowerUps or shake)
+    void hitBrick(unsigned int index);
+    // bounces the ball off the paddle, angled by where it hit
+    void hitPaddle();
+    // (re)loads level Level from its file
+    void loadLevel();
 };
 
+// replays a ball through a generated columns x rows level, once testing every brick and once
+// through the level's CollisionGrid; prints the collision time per frame and checks both agree.
+void BenchmarkCollisions(unsigned int columns, unsigned int rows, unsigned int frames);
+
+// plays games back to back on an initialized headless Game as fast as possible, steering the
+// paddle with a seeded autopilot; prints win/loss counts, steps per second and a checksum of
+// the outcomes (the same seed must always give the same checksum)
+void SimulateGames(Game &game, unsigned int games, unsigned int seed, float dt);
+
 #endif
\ No newline at end of file
@@ -7,34 +7,174 @@
 ** option) any later version.
 ******************************************************************/
 #include "game_level.h"
+#include <learnopengl/mapped_file.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <random>
 #include <sstream>
 
 
+// Binary level layout (little endian, written as-is):
+//   magic, version, width, height, brick count, run count,
+//   runs: one unsigned int each, tile code in the low 8 bits and run length in the high 24;
+//   runs never cross a row, so every row's runs add up to width
+static const unsigned int LEVEL_BINARY_MAGIC = 0x4C564C42; // "BLVL"
+static const unsigned int LEVEL_BINARY_VERSION = 1;
+static const unsigned int LEVEL_RUN_MAX = 0xFFFFFF;
+
+
 void GameLevel::Load(const char *file, unsigned int levelWidth, unsigned int levelHeight)
 {
     // clear old data
     this->Bricks.clear();
+    this->Grid.Clear();
     // load from file
-    unsigned int tileCode;
-    GameLevel level;
-    std::string line;
-    std::ifstream fstream(file);
     std::vector<std::vector<unsigned int>> tileData;
-    if (fstream)
+    if (readTileData(file, tileData) && tileData.size() > 0)
+        this->init(tileData, levelWidth, levelHeight);
+}
+
+void GameLevel::Load(const std::vector<std::vector<unsigned int>> &tileData, unsigned int levelWidth, unsigned int levelHeight)
+{
+    this->Bricks.clear();
+    this->Grid.Clear();
+    if (tileData.size() > 0)
+        this->init(tileData, levelWidth, levelHeight);
+}
+
+bool GameLevel::LoadBinary(const char *file, unsigned int levelWidth, unsigned int levelHeight)
+{
+    this->Bricks.clear();
+    this->Grid.Clear();
+    MappedFile mapped(file);
+    if (!mapped.Data)
+        return false;
+    unsigned int header[6];
+    if (mapped.Size < sizeof(header))
+        return false;
+    memcpy(header, mapped.Data, sizeof(header));
+    unsigned int width = header[2], height = header[3], brickCount = header[4], runCount = header[5];
+    if (header[0] != LEVEL_BINARY_MAGIC || header[1] != LEVEL_BINARY_VERSION || width == 0 || height == 0 ||
+        (mapped.Size - sizeof(header)) / sizeof(unsigned int) < runCount || brickCount > (unsigned long long)width * height)
+    {
+        std::cout << "ERROR::LEVEL: Invalid binary level " << file << std::endl;
+        return false;
+    }
+    const unsigned char *runs = mapped.Data + sizeof(header);
+    // same tile dimensions as the text loader
+    float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / height;
+    glm::vec2 size(unit_width, unit_height);
+    AtlasSprite block = ResourceManager::GetSprite("block"), blockSolid = ResourceManager::GetSprite("block_solid");
+    // construct bricks in place, straight from the mapped runs
+    this->Bricks.reserve(brickCount);
+    unsigned int x = 0, y = 0;
+    for (unsigned int i = 0; i < runCount; ++i)
+    {
+        unsigned int run;
+        memcpy(&run, runs + i * sizeof(unsigned int), sizeof(run));
+        unsigned int tileCode = run & 0xFF, length = run >> 8;
+        if (length == 0 || x + length > width || y >= height)
+            break;
+        if (tileCode != 0)
+            for (unsigned int n = 0; n < length; ++n)
+                this->addBrick(tileCode, glm::vec2(unit_width * (x + n), unit_height * y), size, block, blockSolid);
+        x += length;
+        if (x == width)
+        {
+            x = 0;
+            ++y;
+        }
+    }
+    if (y != height || x != 0 || this->Bricks.size() != brickCount)
+    {
+        std::cout << "ERROR::LEVEL: Corrupt binary level " << file << std::endl;
+        this->Bricks.clear();
+        return false;
+    }
+    this->Grid.Build(this->Bricks, size);
+    return true;
+}
+
+void GameLevel::LoadCached(const char *textFile, const char *binaryFile, unsigned int levelWidth, unsigned int levelHeight)
+{
+    std::error_code error, binaryError;
+    auto textTime = std::filesystem::last_write_time(textFile, error);
+    auto binaryTime = std::filesystem::last_write_time(binaryFile, binaryError);
+    bool stale = binaryError || (!error && binaryTime < textTime);
+    if (stale && !ConvertLevel(textFile, binaryFile))
     {
-        while (std::getline(fstream, line)) // read each line from level file
+        // no writable cache: fall back to the text file
+        this->Load(textFile, levelWidth, levelHeight);
+        return;
+    }
+    if (!this->LoadBinary(binaryFile, levelWidth, levelHeight))
+        this->Load(textFile, levelWidth, levelHeight);
+}
+
+bool GameLevel::WriteBinary(const std::vector<std::vector<unsigned int>> &tileData, const char *binaryFile)
+{
+    if (tileData.empty() || tileData[0].empty())
+        return false;
+    // rows are made as wide as the first one (missing tiles are empty), like the text loader expects
+    unsigned int width = (unsigned int)tileData[0].size(), height = (unsigned int)tileData.size();
+    unsigned int brickCount = 0;
+    std::vector<unsigned int> runs;
+    for (const std::vector<unsigned int> &row : tileData)
+    {
+        unsigned int x = 0;
+        while (x < width)
         {
-            std::istringstream sstream(line);
-            std::vector<unsigned int> row;
-            while (sstream >> tileCode) // read each word separated by spaces
-                row.push_back(tileCode);
-            tileData.push_back(row);
+            unsigned int tileCode = x < row.size() ? row[x] : 0;
+            if (tileCode > 0xFF)
+            {
+                std::cout << "ERROR::LEVEL: Tile code " << tileCode << " doesn't fit the binary level format" << std::endl;
+                return false;
+            }
+            unsigned int length = 1;
+            while (x + length < width && length < LEVEL_RUN_MAX && (x + length < row.size() ? row[x + length] : 0) == tileCode)
+                ++length;
+            runs.push_back(length << 8 | tileCode);
+            if (tileCode != 0)
+                brickCount += length;
+            x += length;
         }
-        if (tileData.size() > 0)
-            this->init(tileData, levelWidth, levelHeight);
     }
+    std::ofstream out(binaryFile, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "ERROR::LEVEL: Failed to write binary level " << binaryFile << std::endl;
+        return false;
+    }
+    unsigned int header[6] = { LEVEL_BINARY_MAGIC, LEVEL_BINARY_VERSION, width, height, brickCount, (unsigned int)runs.size() };
+    out.write((const char*)header, sizeof(header));
+    out.write((const char*)runs.data(), runs.size() * sizeof(unsigned int));
+    return (bool)out;
+}
+
+bool GameLevel::ConvertLevel(const char *textFile, const char *binaryFile)
+{
+    std::vector<std::vector<unsigned int>> tileData;
+    if (!readTileData(textFile, tileData))
+    {
+        std::cout << "ERROR::LEVEL: Failed to read level " << textFile << std::endl;
+        return false;
+    }
+    return WriteBinary(tileData, binaryFile);
+}
+
+void GameLevel::DestroyBrick(unsigned int index)
+{
+    GameObject &brick = this->Bricks[index];
+    if (brick.Destroyed)
+        return;
+    brick.Destroyed = true;
+    this->Grid.Remove(index, brick);
 }
 
 void GameLevel::Draw(SpriteRenderer &renderer)
@@ -44,6 +184,13 @@ void GameLevel::Draw(SpriteRenderer &renderer)
             tile.Draw(renderer);
 }
 
+void GameLevel::Draw(SpriteBatch &batch, int layer)
+{
+    for (GameObject &tile : this->Bricks)
+        if (!tile.Destroyed)
+            tile.Draw(batch, layer);
+}
+
 bool GameLevel::IsCompleted()
 {
     for (GameObject &tile : this->Bricks)
@@ -52,42 +199,124 @@ bool GameLevel::IsCompleted()
     return true;
 }
 
-void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+void GameLevel::init(const std::vector<std::vector<unsigned int>> &tileData, unsigned int levelWidth, unsigned int levelHeight)
 {
     // calculate dimensions
     unsigned int height = tileData.size();
     unsigned int width = tileData[0].size(); // note we can index vector at [0] since this function is only called if height > 0
     float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / height; 
+    glm::vec2 size(unit_width, unit_height);
+    // look the sprites up once, not per tile
+    AtlasSprite block = ResourceManager::GetSprite("block"), blockSolid = ResourceManager::GetSprite("block_solid");
     // initialize level tiles based on tileData		
     for (unsigned int y = 0; y < height; ++y)
     {
         for (unsigned int x = 0; x < width; ++x)
         {
             // check block type from level data (2D level array)
-            if (tileData[y][x] == 1) // solid
-            {
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                GameObject obj(pos, size, ResourceManager::GetTexture("block_solid"), glm::vec3(0.8f, 0.8f, 0.7f));
-                obj.IsSolid = true;
-                this->Bricks.push_back(obj);
-            }
-            else if (tileData[y][x] > 1)	// non-solid; now determine its color based on level data
-            {
-                glm::vec3 color = glm::vec3(1.0f); // original: white
-                if (tileData[y][x] == 2)
-                    color = glm::vec3(0.2f, 0.6f, 1.0f);
-                else if (tileData[y][x] == 3)
-                    color = glm::vec3(0.0f, 0.7f, 0.0f);
-                else if (tileData[y][x] == 4)
-                    color = glm::vec3(0.8f, 0.8f, 0.4f);
-                else if (tileData[y][x] == 5)
-                    color = glm::vec3(1.0f, 0.5f, 0.0f);
-
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), color));
-            }
+            if (tileData[y][x] > 0)
+                this->addBrick(tileData[y][x], glm::vec2(unit_width * x, unit_height * y), size, block, blockSolid);
+        }
+    }
+    // tiles never move, so bucket them once with the tile size as cell size
+    this->Grid.Build(this->Bricks, size);
+}
+
+void GameLevel::addBrick(unsigned int tileCode, glm::vec2 pos, glm::vec2 size, const AtlasSprite &block, const AtlasSprite &blockSolid)
+{
+    if (tileCode == 1) // solid
+    {
+        this->Bricks.emplace_back(pos, size, blockSolid, glm::vec3(0.8f, 0.8f, 0.7f));
+        this->Bricks.back().IsSolid = true;
+    }
+    else	// non-solid; now determine its color based on level data
+    {
+        glm::vec3 color = glm::vec3(1.0f); // original: white
+        if (tileCode == 2)
+            color = glm::vec3(0.2f, 0.6f, 1.0f);
+        else if (tileCode == 3)
+            color = glm::vec3(0.0f, 0.7f, 0.0f);
+        else if (tileCode == 4)
+            color = glm::vec3(0.8f, 0.8f, 0.4f);
+        else if (tileCode == 5)
+            color = glm::vec3(1.0f, 0.5f, 0.0f);
+
+        this->Bricks.emplace_back(pos, size, block, color);
+    }
+}
+
+bool GameLevel::readTileData(const char *file, std::vector<std::vector<unsigned int>> &tileData)
+{
+    unsigned int tileCode;
+    std::string line;
+    std::ifstream fstream(file);
+    if (!fstream)
+        return false;
+    while (std::getline(fstream, line)) // read each line from level file
+    {
+        std::istringstream sstream(line);
+        std::vector<unsigned int> row;
+        while (sstream >> tileCode) // read each word separated by spaces
+            row.push_back(tileCode);
+        tileData.push_back(row);
+    }
+    return true;
+}
+
+
+void BenchmarkLevelLoading(unsigned int columns, unsigned int rows)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const char *textFile = "benchmark_level.lvl", *binaryFile = "benchmark_level.blvl";
+    // generate horizontal runs of random length and tile, like the hand-made levels (~25% empty)
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<unsigned int> tileDistribution(0, 7), lengthDistribution(1, 24);
+    std::vector<std::vector<unsigned int>> tileData(rows);
+    for (std::vector<unsigned int> &row : tileData)
+        while (row.size() < columns)
+        {
+            unsigned int tile = tileDistribution(generator);
+            tile = tile > 5 ? 0 : tile;
+            row.insert(row.end(), std::min(lengthDistribution(generator), columns - (unsigned int)row.size()), tile);
+        }
+    {
+        std::ofstream out(textFile);
+        for (const std::vector<unsigned int> &row : tileData)
+        {
+            for (unsigned int tile : row)
+                out << tile << ' ';
+            out << '\n';
         }
     }
-}
\ No newline at end of file
+    unsigned long long tileDataBytes = 0;
+    for (const std::vector<unsigned int> &row : tileData)
+        tileDataBytes += sizeof(row) + row.capacity() * sizeof(unsigned int);
+    tileData.clear();
+    tileData.shrink_to_fit();
+
+    auto start = Clock::now();
+    bool converted = GameLevel::ConvertLevel(textFile, binaryFile);
+    double convertMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (!converted)
+        return;
+    std::cout << "Level loading benchmark: " << columns << "x" << rows << " tiles, text " << std::filesystem::file_size(textFile) / 1024.0 / 1024.0
+              << " MB, binary " << std::filesystem::file_size(binaryFile) / 1024.0 / 1024.0 << " MB (converted in " << convertMs << " ms)" << std::endl;
+
+    for (int binary = 0; binary < 2; ++binary)
+    {
+        GameLevel level;
+        start = Clock::now();
+        if (binary)
+            level.LoadBinary(binaryFile, 800, 300);
+        else
+            level.Load(textFile, 800, 300);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        // the text loader holds every tile in a vector per row while building; the binary loader reads the mapped file
+        double bricksMB = level.Bricks.capacity() * sizeof(GameObject) / 1024.0 / 1024.0;
+        double scratchMB = binary ? 0.0 : tileDataBytes / 1024.0 / 1024.0;
+        std::cout << "  " << (binary ? "binary (mmap)" : "text (.lvl)  ") << ": " << ms << " ms, " << level.Bricks.size() << " bricks, "
+                  << bricksMB << " MB brick storage (capacity " << level.Bricks.capacity() << "), " << scratchMB << " MB tile data" << std::endl;
+    }
+    std::remove(textFile);
+    std::remove(binaryFile);
+}
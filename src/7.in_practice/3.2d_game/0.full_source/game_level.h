@@ -14,6 +14,7 @@
 #include <glm/glm.hpp>
 
 #include "game_object.h"
+#include "collision_grid.h"
 #include "sprite_renderer.h"
 #include "resource_manager.h"
 
@@ -25,17 +26,41 @@ class GameLevel
 public:
     // level state
     std::vector<GameObject> Bricks;
+    // broadphase over Bricks (one cell per tile), destroyed bricks are removed from it
+    CollisionGrid           Grid;
     // constructor
     GameLevel() { }
     // loads level from file
     void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight);
+    // loads level from tile data (rows of tile codes, as in the level files)
+    void Load(const std::vector<std::vector<unsigned int>> &tileData, unsigned int levelWidth, unsigned int levelHeight);
+    // loads level from a binary level file (memory mapped); false if it is missing or invalid
+    bool LoadBinary(const char *file, unsigned int levelWidth, unsigned int levelHeight);
+    // loads the binary version of a text level, converting it first if it is missing or older than the text file
+    void LoadCached(const char *textFile, const char *binaryFile, unsigned int levelWidth, unsigned int levelHeight);
+    // writes tile data as a binary level: a header followed by run-length encoded tile rows
+    static bool WriteBinary(const std::vector<std::vector<unsigned int>> &tileData, const char *binaryFile);
+    // converts a text level file to a binary level file
+    static bool ConvertLevel(const char *textFile, const char *binaryFile);
+    // marks a brick destroyed and removes it from the broadphase
+    void DestroyBrick(unsigned int index);
     // render level
     void Draw(SpriteRenderer &renderer);
+    // queue level into a sprite batch (one instanced draw per brick texture)
+    void Draw(SpriteBatch &batch, int layer = 0);
     // check if the level is completed (all non-solid tiles are destroyed)
     bool IsCompleted();
 private:
     // initialize level from tile data
-    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight);
+    void init(const std::vector<std::vector<unsigned int>> &tileData, unsigned int levelWidth, unsigned int levelHeight);
+    // appends the brick for a (non-empty) tile code
+    void addBrick(unsigned int tileCode, glm::vec2 pos, glm::vec2 size, const AtlasSprite &block, const AtlasSprite &blockSolid);
+    // reads the rows of tile codes from a text level file
+    static bool readTileData(const char *file, std::vector<std::vector<unsigned int>> &tileData);
 };
 
+// generates a columns x rows level, saves it as text and binary and compares
+// load time and memory of both loaders; prints the results
+void BenchmarkLevelLoading(unsigned int columns, unsigned int rows);
+
 #endif
\ No newline at end of file
@@ -10,12 +10,20 @@
 
 
 GameObject::GameObject() 
-    : Position(0.0f, 0.0f), Size(1.0f, 1.0f), Velocity(0.0f), Color(1.0f), Rotation(0.0f), Sprite(), IsSolid(false), Destroyed(false) { }
+    : Position(0.0f, 0.0f), Size(1.0f, 1.0f), Velocity(0.0f), PreviousPosition(0.0f, 0.0f), Color(1.0f), Rotation(0.0f), IsSolid(false), Destroyed(false), Sprite(), SpriteRect(0.0f, 0.0f, 1.0f, 1.0f) { }
 
 GameObject::GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color, glm::vec2 velocity) 
-    : Position(pos), Size(size), Velocity(velocity), Color(color), Rotation(0.0f), Sprite(sprite), IsSolid(false), Destroyed(false) { }
+    : Position(pos), Size(size), Velocity(velocity), PreviousPosition(pos), Color(color), Rotation(0.0f), IsSolid(false), Destroyed(false), Sprite(sprite), SpriteRect(0.0f, 0.0f, 1.0f, 1.0f) { }
 
-void GameObject::Draw(SpriteRenderer &renderer)
+GameObject::GameObject(glm::vec2 pos, glm::vec2 size, AtlasSprite sprite, glm::vec3 color, glm::vec2 velocity) 
+    : Position(pos), Size(size), Velocity(velocity), PreviousPosition(pos), Color(color), Rotation(0.0f), IsSolid(false), Destroyed(false), Sprite(sprite.Texture), SpriteRect(sprite.UVRect) { }
+
+void GameObject::Draw(SpriteRenderer &renderer, float alpha)
+{
+    renderer.DrawSprite(this->Sprite, glm::mix(this->PreviousPosition, this->Position, alpha), this->Size, this->Rotation, this->Color, this->SpriteRect);
+}
+
+void GameObject::Draw(SpriteBatch &batch, int layer, float alpha)
 {
-    renderer.DrawSprite(this->Sprite, this->Position, this->Size, this->Rotation, this->Color);
+    batch.Draw(this->Sprite, glm::mix(this->PreviousPosition, this->Position, alpha), this->Size, this->Rotation, this->Color, layer, this->SpriteRect);
 }
\ No newline at end of file
@@ -13,7 +13,9 @@
 #include <glm/glm.hpp>
 
 #include "texture.h"
+#include "texture_atlas.h"
 #include "sprite_renderer.h"
+#include "sprite_batch.h"
 
 
 // Container object for holding all state relevant for a single
@@ -24,17 +26,22 @@ class GameObject
 public:
     // object state
     glm::vec2   Position, Size, Velocity;
+    glm::vec2   PreviousPosition; // Position at the start of the last simulation step, for render interpolation
     glm::vec3   Color;
     float       Rotation;
     bool        IsSolid;
     bool        Destroyed;
     // render state
     Texture2D   Sprite;	
+    glm::vec4   SpriteRect; // sub-rect of Sprite (uv offset, uv scale); the whole texture unless it is an atlas
     // constructor(s)
     GameObject();
     GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
-    // draw sprite
-    virtual void Draw(SpriteRenderer &renderer);
+    GameObject(glm::vec2 pos, glm::vec2 size, AtlasSprite sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
+    // draw sprite; alpha interpolates between PreviousPosition (0) and Position (1)
+    virtual void Draw(SpriteRenderer &renderer, float alpha = 1.0f);
+    // queue sprite into a batch
+    virtual void Draw(SpriteBatch &batch, int layer = 0, float alpha = 1.0f);
 };
 
 #endif
\ No newline at end of file
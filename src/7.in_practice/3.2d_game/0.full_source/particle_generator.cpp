@@ -7,9 +7,13 @@
 ** option) any later version.
 ******************************************************************/
 #include "particle_generator.h"
+#include <learnopengl/gl_state.h>
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-    : shader(shader), texture(texture), amount(amount)
+// every generator gets its own random sequence
+static unsigned int generatorSeed = 1;
+
+ParticleGenerator::ParticleGenerator(Shader shader, AtlasSprite sprite, unsigned int amount)
+    : particles(amount, generatorSeed++), amount(amount), shader(shader), texture(sprite.Texture), uvRect(sprite.UVRect)
 {
     this->init();
 }
@@ -18,43 +22,37 @@ void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newPar
 {
     // add new particles 
     for (unsigned int i = 0; i < newParticles; ++i)
-    {
-        int unusedParticle = this->firstUnusedParticle();
-        this->respawnParticle(this->particles[unusedParticle], object, offset);
-    }
-    // update all particles
-    for (unsigned int i = 0; i < this->amount; ++i)
-    {
-        Particle &p = this->particles[i];
-        p.Life -= dt; // reduce life
-        if (p.Life > 0.0f)
-        {	// particle is alive, thus update
-            p.Position -= p.Velocity * dt; 
-            p.Color.a -= dt * 2.5f;
-        }
-    }
+        this->respawnParticle(object, offset);
+    // update all alive particles (dead ones are removed)
+    this->particles.Update(dt, 2.5f);
 }
 
 // render all particles
 void ParticleGenerator::Draw()
 {
     // use additive blending to give it a 'glow' effect
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    this->shader.Use();
-    for (Particle particle : this->particles)
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    unsigned int count = this->particles.Count();
+    if (count > 0)
     {
-        if (particle.Life > 0.0f)
-        {
-            this->shader.SetVector2f("offset", particle.Position);
-            this->shader.SetVector4f("color", particle.Color);
-            this->texture.Bind();
-            glBindVertexArray(this->VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
-        }
+        // orphan last frame's storage, then copy the alive range of every SoA array into its section
+        const std::vector<float> *arrays[6] = { &this->particles.PositionX, &this->particles.PositionY,
+            &this->particles.ColorR, &this->particles.ColorG, &this->particles.ColorB, &this->particles.ColorA };
+        GLsizeiptr section = this->amount * sizeof(float);
+        glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 6 * section, nullptr, GL_STREAM_DRAW);
+        for (unsigned int i = 0; i < 6; ++i)
+            glBufferSubData(GL_ARRAY_BUFFER, i * section, count * sizeof(float), arrays[i]->data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        this->shader.Use();
+        this->shader.SetVector4f("uvRect", this->uvRect);
+        this->texture.Bind();
+        GLState::BindVertexArray(this->VAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
     }
     // don't forget to reset to default blending mode
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void ParticleGenerator::init()
@@ -72,49 +70,30 @@ void ParticleGenerator::init()
     }; 
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &VBO);
-    glBindVertexArray(this->VAO);
+    GLState::BindVertexArray(this->VAO);
     // fill mesh buffer
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
     // set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glBindVertexArray(0);
-
-    // create this->amount default particle instances
-    for (unsigned int i = 0; i < this->amount; ++i)
-        this->particles.push_back(Particle());
-}
-
-// stores the index of the last particle used (for quick access to next dead particle)
-unsigned int lastUsedParticle = 0;
-unsigned int ParticleGenerator::firstUnusedParticle()
-{
-    // first search from last used particle, this will usually return almost instantly
-    for (unsigned int i = lastUsedParticle; i < this->amount; ++i){
-        if (this->particles[i].Life <= 0.0f){
-            lastUsedParticle = i;
-            return i;
-        }
-    }
-    // otherwise, do a linear search
-    for (unsigned int i = 0; i < lastUsedParticle; ++i){
-        if (this->particles[i].Life <= 0.0f){
-            lastUsedParticle = i;
-            return i;
-        }
+    // instance attributes 1..6 (offset x/y, color r/g/b/a), each one tightly packed float array
+    glGenBuffers(1, &this->instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 6 * this->amount * sizeof(float), nullptr, GL_STREAM_DRAW);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        glEnableVertexAttribArray(1 + i);
+        glVertexAttribPointer(1 + i, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(i * this->amount * sizeof(float)));
+        glVertexAttribDivisor(1 + i, 1);
     }
-    // all particles are taken, override the first one (note that if it repeatedly hits this case, more particles should be reserved)
-    lastUsedParticle = 0;
-    return 0;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::BindVertexArray(0);
 }
 
-void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset)
+void ParticleGenerator::respawnParticle(GameObject &object, glm::vec2 offset)
 {
-    float random = ((rand() % 100) - 50) / 10.0f;
-    float rColor = 0.5f + ((rand() % 100) / 100.0f);
-    particle.Position = object.Position + random + offset;
-    particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
-    particle.Life = 1.0f;
-    particle.Velocity = object.Velocity * 0.1f;
+    float random = this->particles.Random() * 10.0f - 5.0f;
+    float rColor = 0.5f + this->particles.Random();
+    this->particles.Spawn(object.Position + random + offset, object.Velocity * 0.1f, glm::vec4(rColor, rColor, rColor, 1.0f), 1.0f);
 }
\ No newline at end of file
@@ -15,45 +15,39 @@
 
 #include "shader.h"
 #include "texture.h"
+#include "texture_atlas.h"
 #include "game_object.h"
-
-
-// Represents a single particle and its state
-struct Particle {
-    glm::vec2 Position, Velocity;
-    glm::vec4 Color;
-    float     Life;
-
-    Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
-};
+#include "particle_system.h"
 
 
 // ParticleGenerator acts as a container for rendering a large number of 
 // particles by repeatedly spawning and updating particles and killing 
-// them after a given amount of time.
+// them after a given amount of time. The simulation itself lives in
+// ParticleSystem (SoA storage, alive particles kept contiguous).
 class ParticleGenerator
 {
 public:
     // constructor
-    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
+    ParticleGenerator(Shader shader, AtlasSprite sprite, unsigned int amount);
     // update all particles
     void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
-    // render all particles
+    // render all particles with one instanced draw call
     void Draw();
 private:
     // state
-    std::vector<Particle> particles;
+    ParticleSystem particles;
     unsigned int amount;
     // render state
     Shader shader;
     Texture2D texture;
+    glm::vec4 uvRect;
     unsigned int VAO;
+    // per-instance data: the SoA arrays are copied as-is into consecutive sections of one buffer
+    unsigned int instanceVBO;
     // initializes buffer and vertex attributes
     void init();
-    // returns the first Particle index that's currently unused e.g. Life <= 0.0f or 0 if no particle is currently inactive
-    unsigned int firstUnusedParticle();
-    // respawns particle
-    void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    // spawns a new particle at the object
+    void respawnParticle(GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "particle_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLE_SSE 1
+#endif
+
+
+ParticleSystem::ParticleSystem(unsigned int capacity, unsigned int seed)
+    : capacity(capacity), count(0), replaceCursor(0), random(seed)
+{
+    std::vector<float>* arrays[] = { &PositionX, &PositionY, &VelocityX, &VelocityY, &ColorR, &ColorG, &ColorB, &ColorA, &Life };
+    for (std::vector<float>* array : arrays)
+        array->resize(capacity, 0.0f);
+}
+
+void ParticleSystem::Spawn(glm::vec2 position, glm::vec2 velocity, glm::vec4 color, float life)
+{
+    if (this->capacity == 0)
+        return;
+    unsigned int i;
+    if (this->count < this->capacity)
+        i = this->count++;
+    else
+    {
+        // all particles are taken, recycle slots in turn (if this happens a lot, reserve more particles)
+        i = this->replaceCursor;
+        this->replaceCursor = (this->replaceCursor + 1) % this->capacity;
+    }
+    this->PositionX[i] = position.x;
+    this->PositionY[i] = position.y;
+    this->VelocityX[i] = velocity.x;
+    this->VelocityY[i] = velocity.y;
+    this->ColorR[i] = color.r;
+    this->ColorG[i] = color.g;
+    this->ColorB[i] = color.b;
+    this->ColorA[i] = color.a;
+    this->Life[i] = life;
+}
+
+void ParticleSystem::Update(float dt, float fadeRate, bool allowThreads)
+{
+    unsigned int threadCount = allowThreads ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    if (this->count < PARALLEL_THRESHOLD || threadCount == 1)
+        this->integrate(0, this->count, dt, fadeRate);
+    else
+    {
+        // split into chunks that are a multiple of 4, so only the last chunk has a scalar tail
+        unsigned int chunk = (this->count / threadCount + 3) & ~3u;
+        std::vector<std::thread> workers;
+        for (unsigned int first = 0; first < this->count; first += chunk)
+        {
+            unsigned int last = std::min(first + chunk, this->count);
+            workers.emplace_back(&ParticleSystem::integrate, this, first, last, dt, fadeRate);
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+    this->removeDead();
+}
+
+void ParticleSystem::integrate(unsigned int first, unsigned int last, float dt, float fadeRate)
+{
+    float *px = this->PositionX.data(), *py = this->PositionY.data();
+    const float *vx = this->VelocityX.data(), *vy = this->VelocityY.data();
+    float *alpha = this->ColorA.data(), *life = this->Life.data();
+    unsigned int i = first;
+#ifdef PARTICLE_SSE
+    const __m128 dt4 = _mm_set1_ps(dt);
+    const __m128 fade4 = _mm_set1_ps(dt * fadeRate);
+    for (; i + 4 <= last; i += 4)
+    {
+        _mm_storeu_ps(px + i, _mm_sub_ps(_mm_loadu_ps(px + i), _mm_mul_ps(_mm_loadu_ps(vx + i), dt4)));
+        _mm_storeu_ps(py + i, _mm_sub_ps(_mm_loadu_ps(py + i), _mm_mul_ps(_mm_loadu_ps(vy + i), dt4)));
+        _mm_storeu_ps(alpha + i, _mm_sub_ps(_mm_loadu_ps(alpha + i), fade4));
+        _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), dt4));
+    }
+#endif
+    // scalar tail (or everything, without SSE; simple enough for the compiler to auto-vectorize)
+    const float fade = dt * fadeRate;
+    for (; i < last; ++i)
+    {
+        px[i] -= vx[i] * dt;
+        py[i] -= vy[i] * dt;
+        alpha[i] -= fade;
+        life[i] -= dt;
+    }
+}
+
+void ParticleSystem::removeDead()
+{
+    unsigned int i = 0;
+    while (i < this->count)
+    {
+        if (this->Life[i] > 0.0f)
+        {
+            ++i;
+            continue;
+        }
+        // move the last alive particle into this slot and test the slot again
+        unsigned int last = --this->count;
+        this->PositionX[i] = this->PositionX[last];
+        this->PositionY[i] = this->PositionY[last];
+        this->VelocityX[i] = this->VelocityX[last];
+        this->VelocityY[i] = this->VelocityY[last];
+        this->ColorR[i] = this->ColorR[last];
+        this->ColorG[i] = this->ColorG[last];
+        this->ColorB[i] = this->ColorB[last];
+        this->ColorA[i] = this->ColorA[last];
+        this->Life[i] = this->Life[last];
+    }
+    if (this->replaceCursor >= this->count)
+        this->replaceCursor = 0;
+}
+
+
+// The previous ParticleGenerator storage: AoS, a linear search for dead
+// slots and every slot updated, alive or not. Only used as the baseline.
+struct LegacyParticle {
+    glm::vec2 Position, Velocity;
+    glm::vec4 Color;
+    float     Life;
+
+    LegacyParticle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
+};
+
+static unsigned int legacyFirstUnused(std::vector<LegacyParticle> &particles, unsigned int &lastUsed)
+{
+    for (unsigned int i = lastUsed; i < particles.size(); ++i)
+        if (particles[i].Life <= 0.0f) { lastUsed = i; return i; }
+    for (unsigned int i = 0; i < lastUsed; ++i)
+        if (particles[i].Life <= 0.0f) { lastUsed = i; return i; }
+    lastUsed = 0;
+    return 0;
+}
+
+void BenchmarkParticles(unsigned int particleCount, unsigned int frames)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const float dt = 1.0f / 60.0f;
+    // every particle lives ~1 second, so spawn enough per frame to keep the emitter full
+    const unsigned int spawnPerFrame = std::max(1u, particleCount / 60);
+
+    std::cout << "Particle benchmark: " << particleCount << " particles, " << spawnPerFrame << " spawned per frame, " << frames << " frames" << std::endl;
+
+    // baseline: AoS with rand() and linear search
+    {
+        std::vector<LegacyParticle> particles(particleCount);
+        unsigned int lastUsed = 0;
+        auto start = Clock::now();
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            for (unsigned int n = 0; n < spawnPerFrame; ++n)
+            {
+                LegacyParticle &p = particles[legacyFirstUnused(particles, lastUsed)];
+                float random = ((rand() % 100) - 50) / 10.0f;
+                float rColor = 0.5f + ((rand() % 100) / 100.0f);
+                p.Position = glm::vec2(400.0f + random, 300.0f + random);
+                p.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
+                p.Life = 1.0f;
+                p.Velocity = glm::vec2(25.0f, -35.0f);
+            }
+            for (LegacyParticle &p : particles)
+            {
+                p.Life -= dt;
+                if (p.Life > 0.0f)
+                {
+                    p.Position -= p.Velocity * dt;
+                    p.Color.a -= dt * 2.5f;
+                }
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << "  AoS (old ParticleGenerator): " << ms / frames << " ms/frame" << std::endl;
+    }
+
+    // ParticleSystem, single and multi threaded
+    for (int threaded = 0; threaded < 2; ++threaded)
+    {
+        ParticleSystem system(particleCount, 1234);
+        auto start = Clock::now();
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            for (unsigned int n = 0; n < spawnPerFrame; ++n)
+            {
+                float random = system.Random() * 10.0f - 5.0f;
+                float rColor = 0.5f + system.Random();
+                system.Spawn(glm::vec2(400.0f + random, 300.0f + random), glm::vec2(25.0f, -35.0f), glm::vec4(rColor, rColor, rColor, 1.0f), 1.0f);
+            }
+            system.Update(dt, 2.5f, threaded != 0);
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        unsigned int threads = threaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        std::cout << "  SoA (ParticleSystem), " << threads << " thread(s): " << ms / frames << " ms/frame (" << system.Count() << " alive)" << std::endl;
+    }
+}
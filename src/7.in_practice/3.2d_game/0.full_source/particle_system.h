@@ -0,0 +1,77 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+// Small, fast xorshift32 random number generator. Every particle
+// system owns one, so emitters don't share (or lock) global rand() state.
+class ParticleRandom
+{
+public:
+    ParticleRandom(unsigned int seed) : state(seed != 0 ? seed : 0x9E3779B9u) { }
+    // uniform float in [0, 1)
+    float Next()
+    {
+        this->state ^= this->state << 13;
+        this->state ^= this->state >> 17;
+        this->state ^= this->state << 5;
+        return (this->state >> 8) * (1.0f / 16777216.0f);
+    }
+private:
+    unsigned int state;
+};
+
+
+// ParticleSystem holds the simulation state of a particle emitter without
+// any rendering. Particles are stored as a structure of arrays and the
+// alive particles are always kept contiguous in [0, Count()): spawning
+// appends at the end and dead particles are swap-removed with the last one.
+// Update integrates positions and fades colors four particles at a time
+// (SSE when available) and splits large emitters over several threads.
+class ParticleSystem
+{
+public:
+    // particle state (structure of arrays), only the first Count() entries are alive
+    std::vector<float> PositionX, PositionY;
+    std::vector<float> VelocityX, VelocityY;
+    std::vector<float> ColorR, ColorG, ColorB, ColorA;
+    std::vector<float> Life;
+    // emitters with at least this many alive particles are updated on multiple threads
+    static const unsigned int PARALLEL_THRESHOLD = 65536;
+    // constructor
+    ParticleSystem(unsigned int capacity, unsigned int seed = 1);
+    // adds a particle in O(1); when full, the oldest slots are overwritten in turn
+    void          Spawn(glm::vec2 position, glm::vec2 velocity, glm::vec4 color, float life);
+    // moves particles against their velocity, fades alpha by fadeRate per second and removes dead particles
+    void          Update(float dt, float fadeRate, bool allowThreads = true);
+    // number of alive particles
+    unsigned int  Count() const { return this->count; }
+    unsigned int  Capacity() const { return this->capacity; }
+    // per-system random numbers in [0, 1)
+    float         Random() { return this->random.Next(); }
+private:
+    unsigned int   capacity;
+    unsigned int   count;
+    unsigned int   replaceCursor;
+    ParticleRandom random;
+    // integrates and fades particles [first, last)
+    void           integrate(unsigned int first, unsigned int last, float dt, float fadeRate);
+    // swap-removes all particles whose life ran out
+    void           removeDead();
+};
+
+// compares the old AoS update (linear search for dead slots, every slot touched)
+// with ParticleSystem on one and on all threads; prints the average time per frame
+void BenchmarkParticles(unsigned int particleCount, unsigned int frames);
+
+#endif
@@ -34,8 +34,8 @@ public:
     float       Duration;	
     bool        Activated;
     // constructor
-    PowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position, Texture2D texture) 
-        : GameObject(position, POWERUP_SIZE, texture, color, VELOCITY), Type(type), Duration(duration), Activated() { }
+    PowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position, AtlasSprite sprite) 
+        : GameObject(position, POWERUP_SIZE, sprite, color, VELOCITY), Type(type), Duration(duration), Activated() { }
 };
 
 #endif
\ No newline at end of file
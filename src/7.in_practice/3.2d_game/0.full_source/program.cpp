@@ -11,8 +11,14 @@
 
 #include "game.h"
 #include "resource_manager.h"
+#include "particle_system.h"
+#include <learnopengl/gl_state.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 // GLFW function declarations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -22,11 +28,76 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 const unsigned int SCREEN_WIDTH = 800;
 // The height of the screen
 const unsigned int SCREEN_HEIGHT = 600;
+// The duration of one simulation step in seconds (the simulation runs at a fixed rate, independent of rendering)
+const float SIM_STEP = 1.0f / 120.0f;
+// Longest frame time fed to the simulation; after a stall we slow down rather than try to catch up
+const float MAX_FRAME_TIME = 0.25f;
 
 Game Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
 
 int main(int argc, char *argv[])
 {
+    // all of Breakout's binds go through GLState, so it can skip the redundant ones
+    GLState::Filter = true;
+    // headless particle benchmark: Breakout --particle-benchmark [count]
+    if (argc > 1 && strcmp(argv[1], "--particle-benchmark") == 0)
+    {
+        unsigned int count = argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 1000000;
+        BenchmarkParticles(count, 120);
+        return 0;
+    }
+    // headless collision benchmark: Breakout --collision-benchmark [columns] [rows]
+    if (argc > 1 && strcmp(argv[1], "--collision-benchmark") == 0)
+    {
+        unsigned int columns = argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 200;
+        unsigned int rows = argc > 3 ? (unsigned int)strtoul(argv[3], nullptr, 10) : columns;
+        BenchmarkCollisions(columns, rows, 600);
+        return 0;
+    }
+    // level loading benchmark: Breakout --level-benchmark [columns] [rows]
+    if (argc > 1 && strcmp(argv[1], "--level-benchmark") == 0)
+    {
+        unsigned int columns = argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 1024;
+        unsigned int rows = argc > 3 ? (unsigned int)strtoul(argv[3], nullptr, 10) : columns;
+        BenchmarkLevelLoading(columns, rows);
+        return 0;
+    }
+    // headless simulation (no window, GL or audio): Breakout --headless [games] [seed]
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+    {
+        unsigned int games = argc > 2 ? (unsigned int)strtoul(argv[2], nullptr, 10) : 1000;
+        unsigned int seed = argc > 3 ? (unsigned int)strtoul(argv[3], nullptr, 10) : 1;
+        Breakout.Headless = true;
+        Breakout.Init();
+        SimulateGames(Breakout, games, seed, SIM_STEP);
+        return 0;
+    }
+
+    // render loop options: --state-stats prints the GL calls of the last frame once a second,
+    // --no-state-filter issues redundant state changes anyway (to compare against),
+    // --profile shows the per-pass GPU/CPU times, --profile-csv <file> / --profile-trace <file>
+    // write every profiled frame at exit (the trace opens in chrome://tracing or Perfetto) and
+    // --profile-frames <count> quits after that many frames
+    bool stateStats = false;
+    std::string profileCSV, profileTrace;
+    unsigned long profileFrames = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--state-stats") == 0)
+            stateStats = true;
+        else if (strcmp(argv[i], "--no-state-filter") == 0)
+            GLState::Filter = false;
+        else if (strcmp(argv[i], "--profile") == 0)
+            Breakout.ShowProfile = true;
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+            profileCSV = argv[++i];
+        else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc)
+            profileTrace = argv[++i];
+        else if (strcmp(argv[i], "--profile-frames") == 0 && i + 1 < argc)
+            profileFrames = strtoul(argv[++i], nullptr, 10);
+    }
+    Breakout.Profiler.KeepHistory = !profileCSV.empty() || !profileTrace.empty();
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -53,44 +124,73 @@ int main(int argc, char *argv[])
     // OpenGL configuration
     // --------------------
     glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // initialize game
     // ---------------
     Breakout.Init();
 
-    // deltaTime variables
-    // -------------------
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+    // timing variables
+    // ----------------
+    float accumulator = 0.0f;
+    double lastFrame = glfwGetTime();
+    double lastStats = lastFrame;
+    unsigned long frames = 0;
 
     while (!glfwWindowShouldClose(window))
     {
-        // calculate delta time
+        // calculate frame time
         // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
+        double currentFrame = glfwGetTime();
+        float frameTime = std::min(static_cast<float>(currentFrame - lastFrame), MAX_FRAME_TIME);
         lastFrame = currentFrame;
         glfwPollEvents();
 
-        // manage user input
-        // -----------------
-        Breakout.ProcessInput(deltaTime);
+        Breakout.Profiler.BeginFrame();
 
-        // update game state
-        // -----------------
-        Breakout.Update(deltaTime);
+        // manage user input and update game state in fixed steps
+        // -----------------------------------------------------
+        Breakout.Profiler.Begin("update");
+        accumulator += frameTime;
+        while (accumulator >= SIM_STEP)
+        {
+            Breakout.Step(SIM_STEP);
+            accumulator -= SIM_STEP;
+        }
+        Breakout.Profiler.End();
 
-        // render
+        // render (interpolated by how far we are into the next step)
         // ------
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        Breakout.Render();
+        Breakout.Render(accumulator / SIM_STEP);
+        Breakout.Profiler.EndFrame();
+        GLState::EndFrame();
+        if (stateStats && currentFrame - lastStats >= 1.0)
+        {
+            std::cout << "GL state calls per frame: " << GLState::LastFrame.issued << " issued, "
+                      << GLState::LastFrame.filtered << " redundant" << (GLState::Filter ? " (skipped)" : "") << std::endl;
+            lastStats = currentFrame;
+        }
 
         glfwSwapBuffers(window);
+        if (profileFrames > 0 && ++frames >= profileFrames)
+            glfwSetWindowShouldClose(window, true);
     }
 
+    // profiler output (waits for the frames still in flight first)
+    // -------------------------------------------------------------
+    if (!profileCSV.empty() || !profileTrace.empty())
+        Breakout.Profiler.Flush();
+    if (!profileCSV.empty() && !Breakout.Profiler.WriteCSV(profileCSV))
+        std::cout << "ERROR::PROFILER: Failed to write " << profileCSV << std::endl;
+    if (!profileTrace.empty() && !Breakout.Profiler.WriteChromeTrace(profileTrace))
+        std::cout << "ERROR::PROFILER: Failed to write " << profileTrace << std::endl;
+    if (Breakout.Profiler.Dropped > 0)
+        std::cout << "Profiler: " << Breakout.Profiler.Dropped << " frames dropped (queries not ready in time)" << std::endl;
+    Breakout.Profiler.Destroy();
+
     // delete all resources as loaded using the resource manager
     // ---------------------------------------------------------
     ResourceManager::Clear();
@@ -7,6 +7,7 @@
 ** option) any later version.
 ******************************************************************/
 #include "resource_manager.h"
+#include <learnopengl/gl_state.h>
 
 #include <iostream>
 #include <sstream>
@@ -17,6 +18,8 @@
 // Instantiate static variables
 std::map<std::string, Texture2D>    ResourceManager::Textures;
 std::map<std::string, Shader>       ResourceManager::Shaders;
+std::map<std::string, TextureAtlas> ResourceManager::Atlases;
+std::map<std::string, AtlasSprite>  ResourceManager::Sprites;
 
 
 Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name)
@@ -41,14 +44,45 @@ Texture2D ResourceManager::GetTexture(std::string name)
     return Textures[name];
 }
 
+TextureAtlas ResourceManager::LoadAtlas(const std::vector<AtlasImage> &images, const char *cacheFile, unsigned int padding, std::string name)
+{
+    TextureAtlas &atlas = Atlases[name];
+    if (cacheFile != nullptr && atlas.LoadCache(cacheFile, images, padding))
+        std::cout << "Loaded atlas " << name << " from cache " << cacheFile << std::endl;
+    else if (atlas.Build(images, padding) && cacheFile != nullptr)
+        atlas.SaveCache(cacheFile);
+    for (auto &iter : atlas.Regions)
+        Sprites[iter.first] = atlas.GetSprite(iter.first);
+    return atlas;
+}
+
+AtlasSprite ResourceManager::GetSprite(std::string name)
+{
+    auto iter = Sprites.find(name);
+    if (iter != Sprites.end())
+        return iter->second;
+    // not packed: fall back to the whole texture
+    auto texture = Textures.find(name);
+    if (texture == Textures.end())
+    {
+        // e.g. an atlas image that failed to load
+        std::cout << "ERROR::SPRITE: No atlas image or texture named " << name << std::endl;
+        return AtlasSprite();
+    }
+    return AtlasSprite(texture->second);
+}
+
 void ResourceManager::Clear()
 {
     // (properly) delete all shaders	
     for (auto iter : Shaders)
-        glDeleteProgram(iter.second.ID);
+        GLState::DeleteProgram(iter.second.ID);
     // (properly) delete all textures
     for (auto iter : Textures)
-        glDeleteTextures(1, &iter.second.ID);
+        GLState::DeleteTexture(iter.second.ID);
+    // (properly) delete all atlases
+    for (auto &iter : Atlases)
+        GLState::DeleteTexture(iter.second.Texture.ID);
 }
 
 Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
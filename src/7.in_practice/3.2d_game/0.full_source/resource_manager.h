@@ -11,11 +11,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 
 #include "texture.h"
 #include "shader.h"
+#include "texture_atlas.h"
 
 
 // A static singleton ResourceManager class that hosts several
@@ -29,6 +31,8 @@ public:
     // resource storage
     static std::map<std::string, Shader>    Shaders;
     static std::map<std::string, Texture2D> Textures;
+    static std::map<std::string, TextureAtlas> Atlases;
+    static std::map<std::string, AtlasSprite> Sprites;
     // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
     static Shader    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
     // retrieves a stored sader
@@ -37,6 +41,10 @@ public:
     static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
     // retrieves a stored texture
     static Texture2D GetTexture(std::string name);
+    // packs images into one atlas texture (or loads it from cacheFile if no image changed since it was written); every image becomes a sprite stored under its own name
+    static TextureAtlas LoadAtlas(const std::vector<AtlasImage> &images, const char *cacheFile, unsigned int padding, std::string name);
+    // retrieves a stored sprite: an atlas sub-rect, or a whole texture loaded with LoadTexture
+    static AtlasSprite GetSprite(std::string name);
     // properly de-allocates all loaded resources
     static void      Clear();
 private:
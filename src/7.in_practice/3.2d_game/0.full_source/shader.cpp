@@ -7,12 +7,13 @@
 ** option) any later version.
 ******************************************************************/
 #include "shader.h"
+#include <learnopengl/gl_state.h>
 
 #include <iostream>
 
 Shader &Shader::Use()
 {
-    glUseProgram(this->ID);
+    GLState::UseProgram(this->ID);
     return *this;
 }
 
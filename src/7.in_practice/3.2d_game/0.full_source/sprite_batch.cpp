@@ -0,0 +1,140 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "sprite_batch.h"
+#include <learnopengl/gl_state.h>
+
+#include <algorithm>
+#include <cstddef>
+
+
+SpriteBatch::SpriteBatch(Shader shader, unsigned int initialCapacity)
+    : shader(shader), capacity(initialCapacity > 0 ? initialCapacity : 1), lastSpriteCount(0), lastDrawCalls(0)
+{
+    this->initRenderData();
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    GLState::DeleteVertexArray(this->quadVAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->instanceVBO);
+}
+
+void SpriteBatch::Begin()
+{
+    this->sprites.clear();
+    this->keys.clear();
+}
+
+void SpriteBatch::Draw(const Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color, int layer, glm::vec4 uvRect)
+{
+    SpriteInstance sprite;
+    sprite.PositionSize = glm::vec4(position, size);
+    sprite.ColorRotation = glm::vec4(color, glm::radians(rotate));
+    sprite.UVRect = uvRect;
+
+    SpriteKey key;
+    // bias the layer so negative layers sort before positive ones
+    key.Key = (static_cast<unsigned long long>(static_cast<unsigned int>(layer) ^ 0x80000000u) << 32) | texture.ID;
+    key.Texture = texture.ID;
+    key.Index = static_cast<unsigned int>(this->sprites.size());
+
+    this->sprites.push_back(sprite);
+    this->keys.push_back(key);
+}
+
+void SpriteBatch::End()
+{
+    this->lastSpriteCount = static_cast<unsigned int>(this->sprites.size());
+    this->lastDrawCalls = 0;
+    if (this->sprites.empty())
+        return;
+
+    // sort by layer, then texture; stable so sprites keep their submission order within a run
+    std::stable_sort(this->keys.begin(), this->keys.end(), [](const SpriteKey &a, const SpriteKey &b) { return a.Key < b.Key; });
+    this->sorted.resize(this->sprites.size());
+    for (size_t i = 0; i < this->keys.size(); ++i)
+        this->sorted[i] = this->sprites[this->keys[i].Index];
+
+    // upload all instances at once; orphan the old storage so the driver doesn't wait for the previous frame
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    if (this->sorted.size() > this->capacity)
+    {
+        while (this->capacity < this->sorted.size())
+            this->capacity *= 2;
+    }
+    glBufferData(GL_ARRAY_BUFFER, this->capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, this->sorted.size() * sizeof(SpriteInstance), this->sorted.data());
+
+    this->shader.Use();
+    GLState::ActiveTexture(GL_TEXTURE0);
+    GLState::BindVertexArray(this->quadVAO);
+    // one instanced draw per run of sprites with the same layer and texture
+    size_t first = 0;
+    while (first < this->keys.size())
+    {
+        size_t last = first + 1;
+        while (last < this->keys.size() && this->keys[last].Key == this->keys[first].Key)
+            ++last;
+
+        GLState::BindTexture(GL_TEXTURE_2D, this->keys[first].Texture);
+        this->setInstanceOffset(static_cast<unsigned int>(first));
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(last - first));
+        ++this->lastDrawCalls;
+
+        first = last;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpriteBatch::initRenderData()
+{
+    // configure VAO/VBO (same unit quad as SpriteRenderer)
+    float vertices[] = { 
+        // pos      // tex
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f, 
+
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f
+    };
+
+    glGenVertexArrays(1, &this->quadVAO);
+    glGenBuffers(1, &this->quadVBO);
+    glGenBuffers(1, &this->instanceVBO);
+
+    GLState::BindVertexArray(this->quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    // per-instance attributes, advanced once per sprite
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, this->capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+    for (unsigned int i = 1; i <= 3; ++i)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    this->setInstanceOffset(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::BindVertexArray(0);
+}
+
+void SpriteBatch::setInstanceOffset(unsigned int firstInstance)
+{
+    // expects the VAO and instance buffer to be bound
+    size_t base = firstInstance * sizeof(SpriteInstance);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, PositionSize)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, ColorRotation)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, UVRect)));
+}
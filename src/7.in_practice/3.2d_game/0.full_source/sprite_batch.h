@@ -0,0 +1,74 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "texture.h"
+#include "shader.h"
+
+
+// SpriteBatch collects all sprites of a frame (between Begin and End),
+// sorts them by layer and texture and renders each run of sprites that
+// share a layer and texture with a single instanced draw call. The
+// per-sprite transform is done in the vertex shader, so no model matrix
+// is built on the CPU. Within one layer sprites are drawn grouped by
+// texture; overlapping sprites that rely on draw order should be put
+// in different layers.
+class SpriteBatch
+{
+public:
+    // constructor (inits shaders/shapes); the instance buffer grows as needed
+    SpriteBatch(Shader shader, unsigned int initialCapacity = 1024);
+    // destructor
+    ~SpriteBatch();
+    // starts collecting sprites for a new batch
+    void Begin();
+    // queues a sprite; uvRect is (offset.x, offset.y, scale.x, scale.y) into the texture
+    void Draw(const Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f), int layer = 0, glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+    // sorts and renders all queued sprites
+    void End();
+    // statistics of the last End()
+    unsigned int SpriteCount() const { return this->lastSpriteCount; }
+    unsigned int DrawCalls() const { return this->lastDrawCalls; }
+private:
+    // per-instance vertex data, matches the attributes in sprite_batch.vs
+    struct SpriteInstance {
+        glm::vec4 PositionSize;   // xy: top-left position, zw: size
+        glm::vec4 ColorRotation;  // rgb: color, a: rotation in radians
+        glm::vec4 UVRect;         // xy: uv offset, zw: uv scale
+    };
+    // sort key: layer in the high bits, texture ID in the low bits
+    struct SpriteKey {
+        unsigned long long Key;
+        unsigned int       Texture;
+        unsigned int       Index;
+    };
+    // render state
+    Shader       shader;
+    unsigned int quadVAO;
+    unsigned int quadVBO;
+    unsigned int instanceVBO;
+    unsigned int capacity;
+    // sprites of the current batch
+    std::vector<SpriteInstance> sprites;
+    std::vector<SpriteKey>      keys;
+    std::vector<SpriteInstance> sorted;
+    unsigned int lastSpriteCount;
+    unsigned int lastDrawCalls;
+    // initializes the quad and instance buffers and their vertex attributes
+    void initRenderData();
+    // points the instance attributes at the given first instance (no base instance in GL 3.3)
+    void setInstanceOffset(unsigned int firstInstance);
+};
+
+#endif
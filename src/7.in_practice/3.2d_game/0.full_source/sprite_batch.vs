@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+// per-instance data
+layout (location = 1) in vec4 positionSize;  // <vec2 position, vec2 size>
+layout (location = 2) in vec4 colorRotation; // <vec3 color, float rotation (radians)>
+layout (location = 3) in vec4 uvRect;        // <vec2 offset, vec2 scale>
+
+out vec2 TexCoords;
+out vec3 SpriteColor;
+
+uniform mat4 projection;
+
+void main()
+{
+    // same transform as SpriteRenderer: scale, rotate around the quad's center, translate
+    vec2 size = positionSize.zw;
+    vec2 local = (vertex.xy - 0.5) * size;
+    float s = sin(colorRotation.w);
+    float c = cos(colorRotation.w);
+    vec2 rotated = vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    vec2 world = positionSize.xy + 0.5 * size + rotated;
+
+    TexCoords = uvRect.xy + vertex.zw * uvRect.zw;
+    SpriteColor = colorRotation.rgb;
+    gl_Position = projection * vec4(world, 0.0, 1.0);
+}
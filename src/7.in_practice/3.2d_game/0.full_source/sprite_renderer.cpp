@@ -7,6 +7,7 @@
 ** option) any later version.
 ******************************************************************/
 #include "sprite_renderer.h"
+#include <learnopengl/gl_state.h>
 
 
 SpriteRenderer::SpriteRenderer(Shader &shader)
@@ -17,10 +18,11 @@ SpriteRenderer::SpriteRenderer(Shader &shader)
 
 SpriteRenderer::~SpriteRenderer()
 {
-    glDeleteVertexArrays(1, &this->quadVAO);
+    GLState::DeleteVertexArray(this->quadVAO);
+    this->quadBuffer.Destroy();
 }
 
-void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color)
+void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color, glm::vec4 uvRect)
 {
     // prepare transformations
     this->shader.Use();
@@ -37,19 +39,18 @@ void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec
 
     // render textured quad
     this->shader.SetVector3f("spriteColor", color);
+    this->shader.SetVector4f("uvRect", uvRect);
 
-    glActiveTexture(GL_TEXTURE0);
+    GLState::ActiveTexture(GL_TEXTURE0);
     texture.Bind();
 
-    glBindVertexArray(this->quadVAO);
+    GLState::BindVertexArray(this->quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
 }
 
 void SpriteRenderer::initRenderData()
 {
     // configure VAO/VBO
-    unsigned int VBO;
     float vertices[] = { 
         // pos      // tex
         0.0f, 1.0f, 0.0f, 1.0f,
@@ -61,15 +62,10 @@ void SpriteRenderer::initRenderData()
         1.0f, 0.0f, 1.0f, 0.0f
     };
 
-    glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindVertexArray(this->quadVAO);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // immutable buffer and a layout built without binding anything (see gl_resources.h)
+    this->quadBuffer.Create(sizeof(vertices), vertices);
+    this->quadLayout.Create();
+    this->quadLayout.Attribute(0, 0, 4, GL_FLOAT, 0);
+    this->quadLayout.VertexBuffer(0, this->quadBuffer, 0, 4 * sizeof(float));
+    this->quadVAO = this->quadLayout.ID;
 }
\ No newline at end of file
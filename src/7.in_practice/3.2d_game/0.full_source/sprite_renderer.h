@@ -12,6 +12,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <learnopengl/gl_resources.h>
 
 #include "texture.h"
 #include "shader.h"
@@ -25,11 +26,14 @@ public:
     // Destructor
     ~SpriteRenderer();
     // Renders a defined quad textured with given sprite
-    void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
+    // uvRect selects a sub-rect of the texture (uv offset, uv scale), e.g. a sprite in an atlas
+    void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f), glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
 private:
     // Render state
-    Shader       shader; 
-    unsigned int quadVAO;
+    Shader         shader; 
+    unsigned int   quadVAO;
+    GLBuffer       quadBuffer;
+    GLVertexLayout quadLayout;
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
 };
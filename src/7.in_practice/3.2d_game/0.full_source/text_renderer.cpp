@@ -6,6 +6,7 @@
 ** Creative Commons, either version 4 of the License, or (at your
 ** option) any later version.
 ******************************************************************/
+#include <algorithm>
 #include <iostream>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -14,30 +15,42 @@
 
 #include "text_renderer.h"
 #include "resource_manager.h"
+#include <learnopengl/gl_state.h>
+
+
+// floats per vertex: <vec2 pos, vec2 tex, vec3 color>
+static const unsigned int TEXT_VERTEX_FLOATS = 7;
+// width of the glyph atlas; its height is the next power of two that fits all glyphs
+static const unsigned int TEXT_ATLAS_WIDTH = 512;
+// empty texels around each glyph, so linear filtering doesn't pick up neighbors
+static const unsigned int TEXT_ATLAS_PADDING = 1;
 
 
 TextRenderer::TextRenderer(unsigned int width, unsigned int height)
+    : Characters(), capacity(0)
 {
     // load and configure shader
     this->TextShader = ResourceManager::LoadShader("text_2d.vs", "text_2d.fs", nullptr, "text");
     this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f), true);
     this->TextShader.SetInteger("text", 0);
-    // configure VAO/VBO for texture quads
+    // configure VAO/VBO for texture quads (the buffer is sized on first flush)
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &this->VBO);
-    glBindVertexArray(this->VAO);
+    GLState::BindVertexArray(this->VAO);
     glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, TEXT_VERTEX_FLOATS * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, TEXT_VERTEX_FLOATS * sizeof(float), (void*)(4 * sizeof(float)));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 }
 
 void TextRenderer::Load(std::string font, unsigned int fontSize)
 {
     // first clear the previously loaded Characters
-    this->Characters.clear();
+    for (Character &character : this->Characters)
+        character = Character();
     // then initialize and load the FreeType library
     FT_Library ft;    
     if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
@@ -48,93 +61,125 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
     // set size to load glyphs as
     FT_Set_Pixel_Sizes(face, 0, fontSize);
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); 
-    // then for the first 128 ASCII characters, pre-load/compile their characters and store them
+    // rasterize the first 128 ASCII characters and pack them into rows (shelves) of the atlas
+    struct Bitmap { std::vector<unsigned char> Pixels; unsigned int X, Y; };
+    // value-initialized: a glyph that fails to load keeps an empty bitmap at (0, 0)
+    Bitmap bitmaps[128] = {};
+    unsigned int penX = TEXT_ATLAS_PADDING, penY = TEXT_ATLAS_PADDING, shelfHeight = 0;
     for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
     {
         // load character glyph 
         if (FT_Load_Char(face, c, FT_LOAD_RENDER))
         {
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+            this->Characters[c] = { glm::vec4(0.0f), glm::ivec2(0), glm::ivec2(0), 0 };
             continue;
         }
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-            );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-       
-        // now store character for later use
+        FT_Bitmap &bitmap = face->glyph->bitmap;
+        if (penX + bitmap.width + TEXT_ATLAS_PADDING > TEXT_ATLAS_WIDTH)
+        {
+            penX = TEXT_ATLAS_PADDING;
+            penY += shelfHeight + TEXT_ATLAS_PADDING;
+            shelfHeight = 0;
+        }
+        // copy the rows (FreeType's pitch may be larger than the width)
+        bitmaps[c].X = penX;
+        bitmaps[c].Y = penY;
+        bitmaps[c].Pixels.resize(bitmap.width * bitmap.rows);
+        for (unsigned int row = 0; row < bitmap.rows; ++row)
+            std::copy(bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width, bitmaps[c].Pixels.begin() + row * bitmap.width);
+        // now store character for later use (uv rect is filled in once the atlas size is known)
         Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+            glm::vec4(0.0f),
+            glm::ivec2(bitmap.width, bitmap.rows),
             glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
+            static_cast<unsigned int>(face->glyph->advance.x)
         };
-        Characters.insert(std::pair<char, Character>(c, character));
+        this->Characters[c] = character;
+        penX += bitmap.width + TEXT_ATLAS_PADDING;
+        shelfHeight = std::max(shelfHeight, bitmap.rows);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
     // destroy FreeType once we're finished
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
+
+    unsigned int atlasHeight = 1;
+    while (atlasHeight < penY + shelfHeight + TEXT_ATLAS_PADDING)
+        atlasHeight *= 2;
+    std::vector<unsigned char> pixels(TEXT_ATLAS_WIDTH * atlasHeight, 0);
+    for (unsigned int c = 0; c < 128; ++c)
+    {
+        Character &character = this->Characters[c];
+        for (int row = 0; row < character.Size.y; ++row)
+            std::copy(bitmaps[c].Pixels.begin() + row * character.Size.x, bitmaps[c].Pixels.begin() + (row + 1) * character.Size.x,
+                      pixels.begin() + (bitmaps[c].Y + row) * TEXT_ATLAS_WIDTH + bitmaps[c].X);
+        character.UVRect = glm::vec4(bitmaps[c].X / static_cast<float>(TEXT_ATLAS_WIDTH), bitmaps[c].Y / static_cast<float>(atlasHeight),
+                                     character.Size.x / static_cast<float>(TEXT_ATLAS_WIDTH), character.Size.y / static_cast<float>(atlasHeight));
+    }
+    // upload the atlas (rows are tightly packed single bytes: disable the byte-alignment restriction)
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); 
+    this->Atlas.Internal_Format = GL_RED;
+    this->Atlas.Image_Format = GL_RED;
+    this->Atlas.Wrap_S = GL_CLAMP_TO_EDGE;
+    this->Atlas.Wrap_T = GL_CLAMP_TO_EDGE;
+    this->Atlas.Generate(TEXT_ATLAS_WIDTH, atlasHeight, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
 void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
 {
-    // activate corresponding render state	
-    this->TextShader.Use();
-    this->TextShader.SetVector3f("textColor", color);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(this->VAO);
+    this->QueueText(text, x, y, scale, color);
+    this->Flush();
+}
 
+void TextRenderer::QueueText(const std::string &text, float x, float y, float scale, glm::vec3 color)
+{
+    float top = this->Characters['H'].Bearing.y;
     // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    for (char c : text)
     {
-        Character ch = Characters[*c];
+        const Character &ch = this->Characters[static_cast<unsigned char>(c) & 0x7F];
 
         float xpos = x + ch.Bearing.x * scale;
-        float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        float ypos = y + (top - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 0.0f },
+        float u0 = ch.UVRect.x, v0 = ch.UVRect.y, u1 = ch.UVRect.x + ch.UVRect.z, v1 = ch.UVRect.y + ch.UVRect.w;
+        // append the glyph's quad
+        if (w > 0.0f && h > 0.0f)
+        {
+            float quad[6][TEXT_VERTEX_FLOATS] = {
+                { xpos,     ypos + h,   u0, v1, color.r, color.g, color.b },
+                { xpos + w, ypos,       u1, v0, color.r, color.g, color.b },
+                { xpos,     ypos,       u0, v0, color.r, color.g, color.b },
 
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f }
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+                { xpos,     ypos + h,   u0, v1, color.r, color.g, color.b },
+                { xpos + w, ypos + h,   u1, v1, color.r, color.g, color.b },
+                { xpos + w, ypos,       u1, v0, color.r, color.g, color.b }
+            };
+            this->vertices.insert(this->vertices.end(), &quad[0][0], &quad[0][0] + 6 * TEXT_VERTEX_FLOATS);
+        }
         // now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+}
+
+void TextRenderer::Flush()
+{
+    if (this->vertices.empty())
+        return;
+    // upload all quads at once: orphan the buffer (growing it when needed) and refill it
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    this->capacity = std::max(this->capacity, this->vertices.size());
+    glBufferData(GL_ARRAY_BUFFER, this->capacity * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, this->vertices.size() * sizeof(float), this->vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // activate corresponding render state and draw every glyph with one call
+    this->TextShader.Use();
+    GLState::ActiveTexture(GL_TEXTURE0);
+    this->Atlas.Bind();
+    GLState::BindVertexArray(this->VAO);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(this->vertices.size() / TEXT_VERTEX_FLOATS));
+    this->vertices.clear();
+}
@@ -9,7 +9,8 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -20,7 +21,7 @@
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
+    glm::vec4    UVRect;    // region of the glyph in the atlas: uv offset, uv scale
     glm::ivec2   Size;      // size of glyph
     glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
     unsigned int Advance;   // horizontal offset to advance to next glyph
@@ -28,24 +29,35 @@ struct Character {
 
 
 // A renderer class for rendering text displayed by a font loaded using the 
-// FreeType library. A single font is loaded, processed into a list of Character
-// items for later rendering.
+// FreeType library. A single font is loaded and its ASCII glyphs are packed
+// into one atlas texture. Text is built into a single vertex buffer, so every
+// string queued between two flushes is drawn with one draw call.
 class TextRenderer
 {
 public:
-    // holds a list of pre-compiled Characters
-    std::map<char, Character> Characters; 
+    // the pre-compiled ASCII Characters, indexed by character code
+    Character Characters[128];
+    // atlas holding all glyphs (single red channel)
+    Texture2D Atlas;
     // shader used for text rendering
     Shader TextShader;
     // constructor
     TextRenderer(unsigned int width, unsigned int height);
     // pre-compiles a list of characters from the given font
     void Load(std::string font, unsigned int fontSize);
-    // renders a string of text using the precompiled list of characters
+    // renders a string of text using the precompiled list of characters (one draw call)
     void RenderText(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    // adds a string to the batch; nothing is drawn until Flush
+    void QueueText(const std::string &text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    // draws all queued text in one call
+    void Flush();
 private:
     // render state
     unsigned int VAO, VBO;
+    // size of VBO in floats
+    size_t capacity;
+    // queued quads: 6 vertices of <vec2 pos, vec2 tex, vec3 color> per glyph
+    std::vector<float> vertices;
 };
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,373 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "texture_atlas.h"
+#include <learnopengl/gl_state.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "stb_image.h"
+
+
+// Skyline bottom-left packer: the top edge of everything packed so far is
+// kept as a list of horizontal segments; a new rectangle goes where its
+// top ends up lowest (ties: the segment that wastes the least width).
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height) : width(width), height(height)
+    {
+        this->skyline.push_back({ 0, 0, width });
+    }
+    // finds a place for a w*h rectangle and reserves it; returns false if it doesn't fit
+    bool Insert(int w, int h, int &outX, int &outY)
+    {
+        int bestIndex = -1, bestTop = INT_MAX, bestWidth = INT_MAX;
+        for (int i = 0; i < (int)this->skyline.size(); ++i)
+        {
+            int y;
+            if (!this->fits(i, w, h, y))
+                continue;
+            if (y + h < bestTop || (y + h == bestTop && this->skyline[i].Width < bestWidth))
+            {
+                bestIndex = i;
+                bestTop = y + h;
+                bestWidth = this->skyline[i].Width;
+                outX = this->skyline[i].X;
+                outY = y;
+            }
+        }
+        if (bestIndex < 0)
+            return false;
+        this->addSegment(bestIndex, outX, outY, w, h);
+        return true;
+    }
+private:
+    struct Segment { int X, Y, Width; };
+    int width, height;
+    std::vector<Segment> skyline;
+    // a rectangle starting at segment i rests on the highest segment it spans
+    bool fits(int i, int w, int h, int &y) const
+    {
+        int x = this->skyline[i].X;
+        if (x + w > this->width)
+            return false;
+        int widthLeft = w;
+        y = this->skyline[i].Y;
+        while (widthLeft > 0)
+        {
+            if (i >= (int)this->skyline.size())
+                return false;
+            y = std::max(y, this->skyline[i].Y);
+            if (y + h > this->height)
+                return false;
+            widthLeft -= this->skyline[i].Width;
+            ++i;
+        }
+        return true;
+    }
+    void addSegment(int index, int x, int y, int w, int h)
+    {
+        this->skyline.insert(this->skyline.begin() + index, { x, y + h, w });
+        // shrink or remove the segments now covered by the new one
+        for (size_t i = index + 1; i < this->skyline.size(); )
+        {
+            Segment &previous = this->skyline[i - 1];
+            Segment &current = this->skyline[i];
+            if (current.X >= previous.X + previous.Width)
+                break;
+            int shrink = previous.X + previous.Width - current.X;
+            current.X += shrink;
+            current.Width -= shrink;
+            if (current.Width > 0)
+                break;
+            this->skyline.erase(this->skyline.begin() + i);
+        }
+        // merge neighbours at the same height
+        for (size_t i = 0; i + 1 < this->skyline.size(); )
+        {
+            if (this->skyline[i].Y == this->skyline[i + 1].Y)
+            {
+                this->skyline[i].Width += this->skyline[i + 1].Width;
+                this->skyline.erase(this->skyline.begin() + i + 1);
+            }
+            else
+                ++i;
+        }
+    }
+};
+
+
+// Cache file layout (little endian, written as-is):
+//   magic, version, padding, width, height, stamp count, stamps (length + chars),
+//   region count, regions (name length + chars, x, y, width, height), RGBA8 pixels
+static const unsigned int ATLAS_CACHE_MAGIC = 0x4C544142; // "BATL"
+static const unsigned int ATLAS_CACHE_VERSION = 1;
+
+static unsigned int alignUp(unsigned int value, unsigned int alignment)
+{
+    if (alignment == 0)
+        return value;
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void writeString(std::ofstream &out, const std::string &value)
+{
+    unsigned int length = (unsigned int)value.size();
+    out.write((const char*)&length, sizeof(length));
+    out.write(value.data(), length);
+}
+
+static bool readString(std::ifstream &in, std::string &value)
+{
+    unsigned int length = 0;
+    if (!in.read((char*)&length, sizeof(length)) || length > 4096)
+        return false;
+    value.resize(length);
+    return (bool)in.read(&value[0], length);
+}
+
+
+TextureAtlas::TextureAtlas()
+    : Width(0), Height(0), Padding(0)
+{
+    this->Texture.Internal_Format = GL_RGBA;
+    this->Texture.Image_Format = GL_RGBA;
+    this->Texture.Wrap_S = GL_CLAMP_TO_EDGE;
+    this->Texture.Wrap_T = GL_CLAMP_TO_EDGE;
+}
+
+bool TextureAtlas::Build(const std::vector<AtlasImage> &images, unsigned int padding, unsigned int maxSize)
+{
+    struct LoadedImage { const AtlasImage *Source; int Width, Height; unsigned char *Data; };
+    std::vector<LoadedImage> loaded;
+    for (const AtlasImage &image : images)
+    {
+        LoadedImage entry = { &image, 0, 0, nullptr };
+        int nrChannels;
+        // always expand to RGBA; images loaded without alpha are made opaque below
+        entry.Data = stbi_load(image.File.c_str(), &entry.Width, &entry.Height, &nrChannels, 4);
+        if (!entry.Data)
+        {
+            std::cout << "ERROR::ATLAS: Failed to load image " << image.File << std::endl;
+            continue;
+        }
+        loaded.push_back(entry);
+    }
+
+    // place tall images first, the skyline stays flatter that way
+    std::vector<LoadedImage> order = loaded;
+    std::sort(order.begin(), order.end(), [](const LoadedImage &a, const LoadedImage &b) {
+        return a.Height != b.Height ? a.Height > b.Height : a.Width > b.Width;
+    });
+
+    // grow the atlas (alternating width/height) until everything fits
+    std::map<std::string, AtlasRegion> regions;
+    unsigned int width = 256, height = 256;
+    bool packed = false;
+    while (!packed && width <= maxSize && height <= maxSize)
+    {
+        SkylinePacker packer(width, height);
+        regions.clear();
+        packed = true;
+        for (const LoadedImage &image : order)
+        {
+            // cells are padding aligned so mip level log2(padding) still doesn't mix images
+            int cellWidth = alignUp(image.Width + 2 * padding, padding);
+            int cellHeight = alignUp(image.Height + 2 * padding, padding);
+            int x, y;
+            if (!packer.Insert(cellWidth, cellHeight, x, y))
+            {
+                packed = false;
+                break;
+            }
+            AtlasRegion region;
+            region.X = x + padding;
+            region.Y = y + padding;
+            region.Width = image.Width;
+            region.Height = image.Height;
+            regions[image.Source->Name] = region;
+        }
+        if (!packed)
+        {
+            if (width <= height) width *= 2;
+            else                 height *= 2;
+        }
+    }
+    if (!packed)
+    {
+        std::cout << "ERROR::ATLAS: Images don't fit into a " << maxSize << "x" << maxSize << " atlas" << std::endl;
+        for (LoadedImage &image : loaded)
+            stbi_image_free(image.Data);
+        return false;
+    }
+
+    // copy images into the atlas and extrude their edges into the padding
+    this->Width = width;
+    this->Height = height;
+    this->Padding = padding;
+    this->pixels.assign((size_t)width * height * 4, 0);
+    for (LoadedImage &image : loaded)
+    {
+        AtlasRegion &region = regions[image.Source->Name];
+        for (int y = -(int)padding; y < image.Height + (int)padding; ++y)
+        {
+            int srcY = std::min(std::max(y, 0), image.Height - 1);
+            for (int x = -(int)padding; x < image.Width + (int)padding; ++x)
+            {
+                int srcX = std::min(std::max(x, 0), image.Width - 1);
+                const unsigned char *src = image.Data + ((size_t)srcY * image.Width + srcX) * 4;
+                unsigned char *dst = &this->pixels[((size_t)(region.Y + y) * width + (region.X + x)) * 4];
+                memcpy(dst, src, 4);
+                if (!image.Source->Alpha)
+                    dst[3] = 255;
+            }
+        }
+        region.UVRect = glm::vec4((float)region.X / width, (float)region.Y / height,
+                                  (float)region.Width / width, (float)region.Height / height);
+        stbi_image_free(image.Data);
+    }
+    this->Regions = regions;
+    this->sourceStamps = stampImages(images);
+    this->upload();
+    std::cout << "Packed " << this->Regions.size() << " images into a " << width << "x" << height << " atlas" << std::endl;
+    if (this->Regions.size() < images.size())
+        std::cout << "ERROR::ATLAS: " << images.size() - this->Regions.size() << " image(s) missing from the atlas, see above" << std::endl;
+    return true;
+}
+
+bool TextureAtlas::LoadCache(const char *file, const std::vector<AtlasImage> &images, unsigned int padding)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        return false;
+    unsigned int header[5];
+    if (!in.read((char*)header, sizeof(header)))
+        return false;
+    if (header[0] != ATLAS_CACHE_MAGIC || header[1] != ATLAS_CACHE_VERSION || header[2] != padding)
+        return false;
+    unsigned int width = header[3], height = header[4];
+    if (width == 0 || height == 0 || width > 16384 || height > 16384)
+        return false;
+
+    // any added, removed or modified image invalidates the cache
+    std::vector<std::string> stamps = stampImages(images);
+    unsigned int stampCount = 0;
+    if (!in.read((char*)&stampCount, sizeof(stampCount)) || stampCount != stamps.size())
+        return false;
+    for (unsigned int i = 0; i < stampCount; ++i)
+    {
+        std::string stamp;
+        if (!readString(in, stamp) || stamp != stamps[i])
+            return false;
+    }
+
+    std::map<std::string, AtlasRegion> regions;
+    unsigned int regionCount = 0;
+    if (!in.read((char*)&regionCount, sizeof(regionCount)))
+        return false;
+    for (unsigned int i = 0; i < regionCount; ++i)
+    {
+        std::string name;
+        AtlasRegion region;
+        unsigned int rect[4];
+        if (!readString(in, name) || !in.read((char*)rect, sizeof(rect)))
+            return false;
+        region.X = rect[0]; region.Y = rect[1]; region.Width = rect[2]; region.Height = rect[3];
+        region.UVRect = glm::vec4((float)region.X / width, (float)region.Y / height,
+                                  (float)region.Width / width, (float)region.Height / height);
+        regions[name] = region;
+    }
+
+    std::vector<unsigned char> data((size_t)width * height * 4);
+    if (!in.read((char*)data.data(), data.size()))
+        return false;
+
+    this->Width = width;
+    this->Height = height;
+    this->Padding = padding;
+    this->Regions = regions;
+    this->sourceStamps = stamps;
+    this->pixels.swap(data);
+    this->upload();
+    return true;
+}
+
+bool TextureAtlas::SaveCache(const char *file) const
+{
+    if (this->pixels.empty())
+        return false;
+    std::ofstream out(file, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "ERROR::ATLAS: Failed to write atlas cache " << file << std::endl;
+        return false;
+    }
+    unsigned int header[5] = { ATLAS_CACHE_MAGIC, ATLAS_CACHE_VERSION, this->Padding, this->Width, this->Height };
+    out.write((const char*)header, sizeof(header));
+    unsigned int stampCount = (unsigned int)this->sourceStamps.size();
+    out.write((const char*)&stampCount, sizeof(stampCount));
+    for (const std::string &stamp : this->sourceStamps)
+        writeString(out, stamp);
+    unsigned int regionCount = (unsigned int)this->Regions.size();
+    out.write((const char*)&regionCount, sizeof(regionCount));
+    for (auto &iter : this->Regions)
+    {
+        writeString(out, iter.first);
+        unsigned int rect[4] = { iter.second.X, iter.second.Y, iter.second.Width, iter.second.Height };
+        out.write((const char*)rect, sizeof(rect));
+    }
+    out.write((const char*)this->pixels.data(), this->pixels.size());
+    return (bool)out;
+}
+
+AtlasSprite TextureAtlas::GetSprite(const std::string &name) const
+{
+    auto iter = this->Regions.find(name);
+    if (iter == this->Regions.end())
+    {
+        std::cout << "ERROR::ATLAS: No image named " << name << " in atlas" << std::endl;
+        return AtlasSprite(this->Texture);
+    }
+    return AtlasSprite(this->Texture, iter->second.UVRect);
+}
+
+void TextureAtlas::upload()
+{
+    this->Texture.Generate(this->Width, this->Height, this->pixels.data());
+    // only the mip levels whose texels stay inside a cell's padding are safe
+    int maxLevel = 0;
+    while ((2u << maxLevel) <= this->Padding)
+        ++maxLevel;
+    this->Texture.Bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    if (maxLevel > 0)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    GLState::BindTexture(GL_TEXTURE_2D, 0);
+}
+
+std::vector<std::string> TextureAtlas::stampImages(const std::vector<AtlasImage> &images)
+{
+    std::vector<std::string> stamps;
+    for (const AtlasImage &image : images)
+    {
+        std::error_code error;
+        std::uintmax_t size = std::filesystem::file_size(image.File, error);
+        long long time = error ? 0 : (long long)std::filesystem::last_write_time(image.File, error).time_since_epoch().count();
+        stamps.push_back(image.Name + "|" + image.File + "|" + (image.Alpha ? "1" : "0") + "|" + std::to_string(size) + "|" + std::to_string(time));
+    }
+    return stamps;
+}
@@ -0,0 +1,81 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "texture.h"
+
+
+// An image file that should be packed into an atlas
+struct AtlasImage {
+    std::string Name;
+    std::string File;
+    bool        Alpha;
+};
+
+// Location of a packed image inside the atlas (in pixels, excluding padding)
+struct AtlasRegion {
+    unsigned int X, Y, Width, Height;
+    glm::vec4    UVRect; // xy: uv offset, zw: uv scale
+};
+
+// A sprite is a texture plus the sub-rect of it that should be drawn;
+// a standalone texture is a sprite with UVRect (0, 0, 1, 1).
+struct AtlasSprite {
+    Texture2D Texture;
+    glm::vec4 UVRect;
+
+    AtlasSprite() : Texture(), UVRect(0.0f, 0.0f, 1.0f, 1.0f) { }
+    AtlasSprite(Texture2D texture, glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)) : Texture(texture), UVRect(uvRect) { }
+};
+
+
+// TextureAtlas packs many small images into one texture with a skyline
+// (bottom-left) packer, so sprites that use different images can be drawn
+// with the same texture bound. Every image is surrounded by Padding pixels
+// that repeat its edge texels and every cell starts on a Padding aligned
+// pixel, so bilinear filtering and the first log2(Padding) mip levels never
+// sample a neighbouring image. The packed pixels and regions can be cached
+// to disk; the cache is only used while none of the source images changed.
+class TextureAtlas
+{
+public:
+    // atlas state
+    Texture2D                          Texture;
+    unsigned int                       Width, Height;
+    unsigned int                       Padding;
+    std::map<std::string, AtlasRegion> Regions;
+    // constructor
+    TextureAtlas();
+    // loads and packs all images and uploads the atlas; padding must be a power of two
+    bool        Build(const std::vector<AtlasImage> &images, unsigned int padding, unsigned int maxSize = 4096);
+    // loads a previously built atlas; fails if the cache is missing or any image differs from the cached one
+    bool        LoadCache(const char *file, const std::vector<AtlasImage> &images, unsigned int padding);
+    // writes the atlas built by Build() to disk
+    bool        SaveCache(const char *file) const;
+    // retrieves the atlas texture and sub-rect of a packed image
+    AtlasSprite GetSprite(const std::string &name) const;
+private:
+    // CPU copy of the atlas (RGBA8), kept after Build() so it can be cached
+    std::vector<unsigned char> pixels;
+    // size and modification time of every source image, used to validate the cache
+    std::vector<std::string>   sourceStamps;
+    // uploads the pixels into Texture and generates the mip levels that are safe to use
+    void        upload();
+    // describes the source images (name, file, size, modification time) for cache validation
+    static std::vector<std::string> stampImages(const std::vector<AtlasImage> &images);
+};
+
+#endif
@@ -38,6 +38,7 @@ void main()
     case 1: result = bloom_none(); break;
     case 2: result = bloom_old(); break;
     case 3: result = bloom_new(); break;
+    case 4: result = bloom_new(); break;
     default:
         result = bloom_none(); break;
     }
@@ -0,0 +1,55 @@
+#version 430 core
+
+// Compute version of 6.new_upsample.fs. Instead of additive blending the shader reads the
+// texel the downsample left in the destination mip and adds the filtered lower mip to it.
+// BLOOM_IMAGE_FORMAT (r11f_g11f_b10f / rgba16f) is defined by BloomRenderer to match the mip textures.
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform sampler2D srcTexture;
+uniform float filterRadius;
+
+layout (BLOOM_IMAGE_FORMAT, binding = 0) uniform image2D dstImage;
+
+void main()
+{
+	ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 dstSize = imageSize(dstImage);
+	if (texelCoord.x >= dstSize.x || texelCoord.y >= dstSize.y)
+		return;
+	vec2 texCoord = (vec2(texelCoord) + 0.5) / vec2(dstSize);
+
+	// The filter kernel is applied with a radius, specified in texture
+	// coordinates, so that the radius will vary across mip resolutions.
+	float x = filterRadius;
+	float y = filterRadius;
+
+	// Take 9 samples around current texel:
+	// a - b - c
+	// d - e - f
+	// g - h - i
+	// === ('e' is the current texel) ===
+	vec3 a = texture(srcTexture, vec2(texCoord.x - x, texCoord.y + y)).rgb;
+	vec3 b = texture(srcTexture, vec2(texCoord.x,     texCoord.y + y)).rgb;
+	vec3 c = texture(srcTexture, vec2(texCoord.x + x, texCoord.y + y)).rgb;
+
+	vec3 d = texture(srcTexture, vec2(texCoord.x - x, texCoord.y)).rgb;
+	vec3 e = texture(srcTexture, vec2(texCoord.x,     texCoord.y)).rgb;
+	vec3 f = texture(srcTexture, vec2(texCoord.x + x, texCoord.y)).rgb;
+
+	vec3 g = texture(srcTexture, vec2(texCoord.x - x, texCoord.y - y)).rgb;
+	vec3 h = texture(srcTexture, vec2(texCoord.x,     texCoord.y - y)).rgb;
+	vec3 i = texture(srcTexture, vec2(texCoord.x + x, texCoord.y - y)).rgb;
+
+	// 3x3 tent filter:
+	//  1   | 1 2 1 |
+	// -- * | 2 4 2 |
+	// 16   | 1 2 1 |
+	vec3 upsample = e*4.0;
+	upsample += (b+d+f+h)*2.0;
+	upsample += (a+c+g+i);
+	upsample *= 1.0 / 16.0;
+
+	vec3 current = imageLoad(dstImage, texelCoord).rgb;
+	imageStore(dstImage, texelCoord, vec4(current + upsample, 1.0));
+}
@@ -10,6 +10,7 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/bloom.h>
 
 #include <iostream>
 #include <vector>
@@ -29,6 +30,13 @@ bool bloom = true;
 float exposure = 1.0f;
 int programChoice = 1;
 float bloomFilterRadius = 0.005f;
+// bloom settings, toggled at runtime (F: fixed-cost mode, M: mip count)
+BloomSettings bloomSettings;
+const unsigned int BLOOM_MIP_COUNTS[] = { 4, 5, 6, 7, 8 };
+int bloomMipCountIndex = 2;
+bool bloomSettingsChanged = false;
+bool fixedCostKeyPressed = false;
+bool mipCountKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -40,289 +48,13 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// bloom stuff
-struct bloomMip
-{
-	glm::vec2 size;
-	glm::ivec2 intSize;
-	unsigned int texture;
-};
-
-class bloomFBO
-{
-public:
-	bloomFBO();
-	~bloomFBO();
-	bool Init(unsigned int windowWidth, unsigned int windowHeight, unsigned int mipChainLength);
-	void Destroy();
-	void BindForWriting();
-	const std::vector<bloomMip>& MipChain() const;
-
-private:
-	bool mInit;
-	unsigned int mFBO;
-	std::vector<bloomMip> mMipChain;
-};
-
-bloomFBO::bloomFBO() : mInit(false) {}
-bloomFBO::~bloomFBO() {}
-
-bool bloomFBO::Init(unsigned int windowWidth, unsigned int windowHeight, unsigned int mipChainLength)
-{
-	if (mInit) return true;
-
-	glGenFramebuffers(1, &mFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
-
-	glm::vec2 mipSize((float)windowWidth, (float)windowHeight);
-	glm::ivec2 mipIntSize((int)windowWidth, (int)windowHeight);
-	// Safety check
-	if (windowWidth > (unsigned int)INT_MAX || windowHeight > (unsigned int)INT_MAX) {
-		std::cerr << "Window size conversion overflow - cannot build bloom FBO!" << std::endl;
-		return false;
-	}
-
-	for (GLuint i = 0; i < mipChainLength; i++)
-	{
-		bloomMip mip;
-
-		mipSize *= 0.5f;
-		mipIntSize /= 2;
-		mip.size = mipSize;
-		mip.intSize = mipIntSize;
-
-		glGenTextures(1, &mip.texture);
-		glBindTexture(GL_TEXTURE_2D, mip.texture);
-		// we are downscaling an HDR color buffer, so we need a float texture format
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F,
-		             (int)mipSize.x, (int)mipSize.y,
-		             0, GL_RGB, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		std::cout << "Created bloom mip " << mipIntSize.x << 'x' << mipIntSize.y << std::endl;
-		mMipChain.emplace_back(mip);
-	}
-
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-	                       GL_TEXTURE_2D, mMipChain[0].texture, 0);
-
-	// setup attachments
-	unsigned int attachments[1] = { GL_COLOR_ATTACHMENT0 };
-	glDrawBuffers(1, attachments);
-
-	// check completion status
-	int status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (status != GL_FRAMEBUFFER_COMPLETE)
-	{
-		printf("gbuffer FBO error, status: 0x%x\n", status);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		return false;
-	}
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	mInit = true;
-	return true;
-}
-
-void bloomFBO::Destroy()
-{
-	for (int i = 0; i < (int)mMipChain.size(); i++) {
-		glDeleteTextures(1, &mMipChain[i].texture);
-		mMipChain[i].texture = 0;
-	}
-	glDeleteFramebuffers(1, &mFBO);
-	mFBO = 0;
-	mInit = false;
-}
-
-void bloomFBO::BindForWriting()
-{
-	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
-}
-
-const std::vector<bloomMip>& bloomFBO::MipChain() const
-{
-	return mMipChain;
-}
-
-
-
-class BloomRenderer
-{
-public:
-	BloomRenderer();
-	~BloomRenderer();
-	bool Init(unsigned int windowWidth, unsigned int windowHeight);
-	void Destroy();
-	void RenderBloomTexture(unsigned int srcTexture, float filterRadius);
-	unsigned int BloomTexture();
-	unsigned int BloomMip_i(int index);
-
-private:
-	void RenderDownsamples(unsigned int srcTexture);
-	void RenderUpsamples(float filterRadius);
-
-	bool mInit;
-	bloomFBO mFBO;
-	glm::ivec2 mSrcViewportSize;
-	glm::vec2 mSrcViewportSizeFloat;
-	Shader* mDownsampleShader;
-	Shader* mUpsampleShader;
-
-	bool mKarisAverageOnDownsample = true;
-};
-
-BloomRenderer::BloomRenderer() : mInit(false) {}
-BloomRenderer::~BloomRenderer() {}
-
-bool BloomRenderer::Init(unsigned int windowWidth, unsigned int windowHeight)
-{
-	if (mInit) return true;
-	mSrcViewportSize = glm::ivec2(windowWidth, windowHeight);
-	mSrcViewportSizeFloat = glm::vec2((float)windowWidth, (float)windowHeight);
-
-	// Framebuffer
-	const unsigned int num_bloom_mips = 6; // TODO: Play around with this value
-	bool status = mFBO.Init(windowWidth, windowHeight, num_bloom_mips);
-	if (!status) {
-		std::cerr << "Failed to initialize bloom FBO - cannot create bloom renderer!\n";
-		return false;
-	}
-
-	// Shaders
-	mDownsampleShader = new Shader("6.new_downsample.vs", "6.new_downsample.fs");
-    mUpsampleShader = new Shader("6.new_upsample.vs", "6.new_upsample.fs");
-
-	// Downsample
-    mDownsampleShader->use();
-    mDownsampleShader->setInt("srcTexture", 0);
-    glUseProgram(0);
-
-    // Upsample
-    mUpsampleShader->use();
-    mUpsampleShader->setInt("srcTexture", 0);
-    glUseProgram(0);
-
-    return true;
-}
-
-void BloomRenderer::Destroy()
-{
-	mFBO.Destroy();
-	delete mDownsampleShader;
-	delete mUpsampleShader;
-}
-
-void BloomRenderer::RenderDownsamples(unsigned int srcTexture)
-{
-	const std::vector<bloomMip>& mipChain = mFBO.MipChain();
-
-	mDownsampleShader->use();
-	mDownsampleShader->setVec2("srcResolution", mSrcViewportSizeFloat);
-	if (mKarisAverageOnDownsample) {
-		mDownsampleShader->setInt("mipLevel", 0);
-	}
-
-	// Bind srcTexture (HDR color buffer) as initial texture input
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, srcTexture);
-
-	// Progressively downsample through the mip chain
-	for (int i = 0; i < (int)mipChain.size(); i++)
-	{
-		const bloomMip& mip = mipChain[i];
-		glViewport(0, 0, mip.size.x, mip.size.y);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-		                       GL_TEXTURE_2D, mip.texture, 0);
-
-		// Render screen-filled quad of resolution of current mip
-		renderQuad();
-
-		// Set current mip resolution as srcResolution for next iteration
-		mDownsampleShader->setVec2("srcResolution", mip.size);
-		// Set current mip as texture input for next iteration
-		glBindTexture(GL_TEXTURE_2D, mip.texture);
-		// Disable Karis average for consequent downsamples
-		if (i == 0) { mDownsampleShader->setInt("mipLevel", 1); }
-	}
-
-	glUseProgram(0);
-}
-
-void BloomRenderer::RenderUpsamples(float filterRadius)
-{
-	const std::vector<bloomMip>& mipChain = mFBO.MipChain();
-
-	mUpsampleShader->use();
-	mUpsampleShader->setFloat("filterRadius", filterRadius);
-
-	// Enable additive blending
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-	glBlendEquation(GL_FUNC_ADD);
-
-	for (int i = (int)mipChain.size() - 1; i > 0; i--)
-	{
-		const bloomMip& mip = mipChain[i];
-		const bloomMip& nextMip = mipChain[i-1];
-
-		// Bind viewport and texture from where to read
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, mip.texture);
-
-		// Set framebuffer render target (we write to this texture)
-		glViewport(0, 0, nextMip.size.x, nextMip.size.y);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-		                       GL_TEXTURE_2D, nextMip.texture, 0);
-
-		// Render screen-filled quad of resolution of current mip
-		renderQuad();
-	}
-
-	// Disable additive blending
-	//glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_BLEND);
-
-	glUseProgram(0);
-}
-
-void BloomRenderer::RenderBloomTexture(unsigned int srcTexture, float filterRadius)
-{
-	mFBO.BindForWriting();
-
-	this->RenderDownsamples(srcTexture);
-	this->RenderUpsamples(filterRadius);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// Restore viewport
-	glViewport(0, 0, mSrcViewportSize.x, mSrcViewportSize.y);
-}
-
-GLuint BloomRenderer::BloomTexture()
-{
-	return mFBO.MipChain()[0].texture;
-}
-
-GLuint BloomRenderer::BloomMip_i(int index)
-{
-	const std::vector<bloomMip>& mipChain = mFBO.MipChain();
-	int size = (int)mipChain.size();
-	return mipChain[(index > size-1) ? size-1 : (index < 0) ? 0 : index].texture;
-}
-
-
-
-
-
 int main()
 {
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // ask for 4.3 first so the compute bloom path is available, fall back to 3.3 below
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -334,6 +66,12 @@ int main()
     // --------------------
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    }
+    if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -450,10 +188,18 @@ int main()
     shaderBloomFinal.setInt("scene", 0);
     shaderBloomFinal.setInt("bloomBlur", 1);
 
-    // bloom renderer
-    // --------------
+    // bloom renderers: fragment passes (3) and compute passes (4) share the same settings
+    // ----------------------------------------------------------------------------------
+    bloomSettings.mipCount = BLOOM_MIP_COUNTS[bloomMipCountIndex];
     BloomRenderer bloomRenderer;
-    bloomRenderer.Init(SCR_WIDTH, SCR_HEIGHT);
+    BloomRenderer bloomRendererCompute;
+    BloomSettings fragmentSettings = bloomSettings;
+    fragmentSettings.useCompute = false;
+    bloomRenderer.Init(SCR_WIDTH, SCR_HEIGHT, fragmentSettings, "6.new_");
+    bloomRendererCompute.Init(SCR_WIDTH, SCR_HEIGHT, bloomSettings, "6.new_");
+
+    // GPU time of step 2 (blur / mip chain), printed every 60 frames for the current mode
+    BloomPassTimer bloomTimer(60);
 
     // render loop
     // -----------
@@ -554,10 +300,25 @@ int main()
         }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        if (programChoice < 1 || programChoice > 3) { programChoice = 1; }
+        if (programChoice < 1 || programChoice > 4) { programChoice = 1; }
         bloom = (programChoice == 1) ? false : true;
         bool horizontal = true;
 
+        if (bloomSettingsChanged)
+        {
+            bloomSettingsChanged = false;
+            bloomSettings.mipCount = BLOOM_MIP_COUNTS[bloomMipCountIndex];
+            BloomSettings fragmentSettings = bloomSettings;
+            fragmentSettings.useCompute = false;
+            bloomRenderer.Destroy();
+            bloomRendererCompute.Destroy();
+            bloomRenderer.Init(SCR_WIDTH, SCR_HEIGHT, fragmentSettings, "6.new_");
+            bloomRendererCompute.Init(SCR_WIDTH, SCR_HEIGHT, bloomSettings, "6.new_");
+        }
+
+        if (bloom)
+            bloomTimer.Begin();
+
         // 2.A) bloom is disabled
         // ----------------------
         if (programChoice == 1)
@@ -592,6 +353,31 @@ int main()
 	        bloomRenderer.RenderBloomTexture(colorBuffers[1], bloomFilterRadius);
         }
 
+        // 2.D) same mip chain with compute shaders (falls back to fragment passes below GL 4.3)
+        // ------------------------------------------------------------------------------------
+        else if (programChoice == 4)
+        {
+	        bloomRendererCompute.RenderBloomTexture(colorBuffers[1], bloomFilterRadius);
+        }
+
+        if (bloom)
+        {
+	        bloomTimer.End();
+	        std::string label;
+	        if (programChoice == 2)
+		        label = "bloom gaussian ping-pong (10 passes, full resolution)";
+	        else
+	        {
+		        const BloomRenderer& renderer = (programChoice == 3) ? bloomRenderer : bloomRendererCompute;
+		        const bloomMip& mip0 = renderer.MipChain()[0];
+		        label = std::string("bloom mip chain ") + (renderer.UsingCompute() ? "compute" : "fragment")
+			        + ", " + std::to_string(renderer.MipChain().size()) + " mips from "
+			        + std::to_string(mip0.intSize.x) + "x" + std::to_string(mip0.intSize.y)
+			        + (bloomSettings.fixedCost ? " (fixed cost)" : "");
+	        }
+	        bloomTimer.Report(label);
+        }
+
         // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         // --------------------------------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -608,6 +394,9 @@ int main()
         else if (programChoice == 3) {
 	        glBindTexture(GL_TEXTURE_2D, bloomRenderer.BloomTexture());
         }
+        else if (programChoice == 4) {
+	        glBindTexture(GL_TEXTURE_2D, bloomRendererCompute.BloomTexture());
+        }
         shaderBloomFinal.setInt("programChoice", programChoice);
         shaderBloomFinal.setFloat("exposure", exposure);
         renderQuad();
@@ -621,6 +410,7 @@ int main()
     }
 
     bloomRenderer.Destroy();
+    bloomRendererCompute.Destroy();
     glfwTerminate();
     return 0;
 }
@@ -771,6 +561,32 @@ void processInput(GLFWwindow *window)
     {
 	    programChoice = 3;
     }
+    else if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
+    {
+	    programChoice = 4;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS && !fixedCostKeyPressed)
+    {
+	    bloomSettings.fixedCost = !bloomSettings.fixedCost;
+	    bloomSettingsChanged = true;
+	    fixedCostKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE)
+    {
+	    fixedCostKeyPressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !mipCountKeyPressed)
+    {
+	    bloomMipCountIndex = (bloomMipCountIndex + 1) % (int)(sizeof(BLOOM_MIP_COUNTS) / sizeof(BLOOM_MIP_COUNTS[0]));
+	    bloomSettingsChanged = true;
+	    mipCountKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE)
+    {
+	    mipCountKeyPressed = false;
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
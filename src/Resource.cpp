@@ -1,47 +1,23 @@
 #include "Resource.h"
+#include <learnopengl/gl_resources.h>
+#include <learnopengl/texture_compression.h>
 #include <string>
 #include <iostream>
 
-GLuint Resource::LoadTexture(const GLchar* path, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode, bool genMipmap)
+GLuint Resource::LoadTexture(const GLchar* path, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode, bool genMipmap, bool twoChannelNormals)
 {
-	GLuint textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-    
-	//float borderColor[] = { 1.0f, 0.6f, 0.6f, 1.0f };
-	//glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilterMode);
+	GLuint cookedID = loadCookedTexture(path, wrapMode, MagFilterMode, MinFilterMode, twoChannelNormals);
+	if (cookedID != 0)
+		return cookedID;
 
 	int width, height, nrChannels;
 	unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
+	GLuint textureID = 0;
 	if (data)
-	{
-		GLenum format;
-		if (nrChannels == 1)
-			format = GL_RED;
-		else if (nrChannels == 3)
-			format = GL_RGB;
-		else if (nrChannels == 4)
-			format = GL_RGBA;
-
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        
-        if (genMipmap)
-        {
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-	}
+		textureID = createTexture(data, width, height, nrChannels, wrapMode, MagFilterMode, MinFilterMode, genMipmap);
 	else
-	{
 		std::cout << "Failed to load texture" << std::endl;
-	}
 	stbi_image_free(data);
-	glBindTexture(GL_TEXTURE_2D, 0);
 	return textureID;
 }
 
@@ -49,16 +25,6 @@ GLuint Resource::LoadTextureFromAssImp(const aiTexture* aiTex, GLint wrapMode, G
 {
 	if (aiTex == nullptr)
 		return 0;
-	GLuint textureID = 0;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilterMode);
-
 
 	int width, height, nrChannels;
 	unsigned char* image_data = nullptr;
@@ -71,18 +37,121 @@ GLuint Resource::LoadTextureFromAssImp(const aiTexture* aiTex, GLint wrapMode, G
 		image_data = stbi_load_from_memory(reinterpret_cast<unsigned char*>(aiTex->pcData), aiTex->mWidth * aiTex->mHeight, &width, &height, &nrChannels, 0);
 	}
 
+	GLuint textureID = 0;
 	if (image_data != nullptr)
+		textureID = createTexture(image_data, width, height, nrChannels, wrapMode, MagFilterMode, MinFilterMode, true);
+	stbi_image_free(image_data);
+	return textureID;
+}
+
+GLuint Resource::createTexture(const unsigned char* data, int width, int height, int nrChannels, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode, bool genMipmap)
+{
+	GLenum format, internalFormat;
+	if (nrChannels == 1)
+	{
+		format = GL_RED;
+		internalFormat = GL_R8;
+	}
+	else if (nrChannels == 2)
+	{
+		format = GL_RG;
+		internalFormat = GL_RG8;
+	}
+	else if (nrChannels == 3)
 	{
-		GLenum format;
-		if (nrChannels == 1)
-			format = GL_RED;
-		else if (nrChannels == 3)
-			format = GL_RGB;
-		else if (nrChannels == 4)
-			format = GL_RGBA;
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image_data);
+		format = GL_RGB;
+		internalFormat = GL_RGB8;
 	}
+	else
+	{
+		format = GL_RGBA;
+		internalFormat = GL_RGBA8;
+	}
+
+	// without mipmaps the storage has a single level, so a mipmap min filter still samples level 0
+	GLTexture texture;
+	texture.Create(GL_TEXTURE_2D, internalFormat, width, height, genMipmap ? 0 : 1);
+
+	//float borderColor[] = { 1.0f, 0.6f, 0.6f, 1.0f };
+	//texture.Parameter(GL_TEXTURE_BORDER_COLOR, borderColor);
 
-	glGenerateMipmap(GL_TEXTURE_2D);
+	texture.SetWrap(wrapMode);
+	texture.SetFilter(MinFilterMode, MagFilterMode);
+	if (nrChannels == 2)
+	{
+		// grey + alpha: sample it as (grey, grey, grey, alpha)
+		texture.Parameter(GL_TEXTURE_SWIZZLE_G, GL_RED);
+		texture.Parameter(GL_TEXTURE_SWIZZLE_B, GL_RED);
+		texture.Parameter(GL_TEXTURE_SWIZZLE_A, GL_GREEN);
+	}
+	texture.Upload(0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+	if (genMipmap)
+		texture.GenerateMipmaps();
+	return texture.ID;
+}
+
+GLuint Resource::loadCookedTexture(const std::string& path, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode, bool twoChannelNormals)
+{
+	std::string cookedPath = path;
+	size_t extension = cookedPath.find_last_of('.');
+	if (extension != std::string::npos && cookedPath.find_first_of("/\\", extension) == std::string::npos)
+		cookedPath.erase(extension);
+	cookedPath += ".dds";
+
+	CompressedTexture cooked;
+	if (!cooked.ReadDDS(cookedPath))
+		return 0;
+	// texture(normalMap).rgb * 2 - 1 would read z as -1
+	if (cooked.Format == BlockCompression::BC5 && !twoChannelNormals)
+	{
+		std::cout << "Cooked texture " << cookedPath << " is BC5 (x and y only) but the caller expects rgb, using the source image" << std::endl;
+		return 0;
+	}
+	// the cooker never flips, so match what stbi_load would return for the source image
+	if (stbFlipsVertically() && !cooked.FlipVertically())
+	{
+		std::cout << "Can't flip cooked texture " << cookedPath << ", using the source image" << std::endl;
+		return 0;
+	}
+	GLuint textureID = createCompressedTexture(cooked, wrapMode, MagFilterMode, MinFilterMode);
+	if (textureID == 0)
+		std::cout << "Failed to load cooked texture " << cookedPath << ", using the source image" << std::endl;
 	return textureID;
 }
+
+GLuint Resource::createCompressedTexture(const CompressedTexture& cooked, GLint wrapMode, GLint MagFilterMode, GLint MinFilterMode)
+{
+	// the mip chain comes from the file: a single level file gets a single level texture
+	GLTexture texture;
+	if (BlockCompression::Supported(cooked.Format))
+	{
+		texture.Create(GL_TEXTURE_2D, BlockCompression::InternalFormat(cooked.Format), cooked.Width, cooked.Height, cooked.Levels());
+		for (int level = 0; level < cooked.Levels(); ++level)
+			texture.UploadCompressed(level, 0, 0, cooked.LevelWidth(level), cooked.LevelHeight(level), (GLsizei)cooked.LevelSize(level), cooked.Level(level));
+	}
+	else
+	{
+		// no hardware support for the format (e.g. BC7 before GL 4.2): decode on the CPU and upload RGBA8
+		std::vector<std::vector<unsigned char>> levels(cooked.Levels());
+		for (int level = 0; level < cooked.Levels(); ++level)
+			if (!BlockCompression::Decompress(cooked.Format, cooked.Level(level), cooked.LevelWidth(level), cooked.LevelHeight(level), levels[level]))
+				return 0;
+		texture.Create(GL_TEXTURE_2D, GL_RGBA8, cooked.Width, cooked.Height, cooked.Levels());
+		for (int level = 0; level < cooked.Levels(); ++level)
+			texture.Upload(level, 0, 0, cooked.LevelWidth(level), cooked.LevelHeight(level), GL_RGBA, GL_UNSIGNED_BYTE, levels[level].data());
+	}
+	texture.SetWrap(wrapMode);
+	texture.SetFilter(MinFilterMode, MagFilterMode);
+	return texture.ID;
+}
+
+bool Resource::stbFlipsVertically()
+{
+	// stb_image has no getter for stbi_set_flip_vertically_on_load, so decode a 1x2 grey PGM and see which row comes first
+	static const unsigned char pgm[] = "P5\n1 2\n255\n\x00\xff";
+	int width, height, nrChannels;
+	unsigned char* data = stbi_load_from_memory(pgm, sizeof(pgm) - 1, &width, &height, &nrChannels, 1);
+	bool flipped = data != nullptr && data[0] == 255;
+	stbi_image_free(data);
+	return flipped;
+}
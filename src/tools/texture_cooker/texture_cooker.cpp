@@ -0,0 +1,193 @@
+#include <learnopengl/texture_compression.h>
+#include <stb_image.h>
+
+extern "C" {
+#include <image_DXT.h>
+}
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Offline texture cooking: compresses an image and its mip chain into a DDS file next to it, which
+// Resource::LoadTexture then loads instead of the image (no decoding, no glGenerateMipmap, 4-8x less upload).
+//
+//   texture_cooker <image> [output.dds] [--format bc1|bc3|bc5|bc7] [--normal] [--no-mips] [--threads count]
+//   texture_cooker --report <image>...
+//
+// The format defaults to BC3 for images with alpha, BC1 otherwise and BC5 with --normal (normal maps:
+// only x and y are stored, mips are renormalized; LoadTexture only uses them when called with
+// twoChannelNormals, from shaders that rebuild z = sqrt(1 - x*x - y*y)).
+// --report compresses the top level of each image with every format, and with SOIL's DXT1/DXT5
+// encoder (includes/image_DXT.c) for comparison, and prints encode time and PSNR against the source.
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// PSNR over the channels set in the mask
+static double psnr(const unsigned char* a, const unsigned char* b, size_t texels, const bool channels[4])
+{
+    double error = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < texels; ++i)
+        for (int c = 0; c < 4; ++c)
+            if (channels[c])
+            {
+                double d = (double)a[i * 4 + c] - b[i * 4 + c];
+                error += d * d;
+                ++count;
+            }
+    if (error == 0.0)
+        return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 / (error / count));
+}
+
+static void reportLine(const char* encoder, const char* format, unsigned int threads, double seconds, size_t bytes, size_t rawBytes, double quality)
+{
+    printf("  %-6s %-4s %3u thread(s) %9.2f ms  %5.1f:1  %6.2f dB\n", encoder, format, threads, seconds * 1000.0, (double)rawBytes / bytes, quality);
+}
+
+static void report(const char* path)
+{
+    int width, height, channels;
+    unsigned char* rgba = stbi_load(path, &width, &height, &channels, 4);
+    if (!rgba)
+    {
+        std::cout << "ERROR::TEXTURE_COOKER: Failed to load " << path << std::endl;
+        return;
+    }
+    size_t texels = (size_t)width * height, rawBytes = texels * (channels == 3 ? 3 : 4);
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    printf("%s: %dx%d, %d channels (ratio against %s)\n", path, width, height, channels, channels == 3 ? "RGB8" : "RGBA8");
+
+    const bool rgb[4] = { true, true, true, false }, all[4] = { true, true, true, true }, rg[4] = { true, true, false, false };
+    struct Case { BlockCompression::Format format; const bool* channels; };
+    const Case cases[] = { { BlockCompression::BC1, rgb }, { BlockCompression::BC3, all }, { BlockCompression::BC5, rg }, { BlockCompression::BC7, all } };
+    std::vector<unsigned char> decoded;
+    for (const Case& test : cases)
+        for (unsigned int threads : { 1u, cores })
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<unsigned char> blocks = BlockCompression::Compress(test.format, rgba, width, height, threads);
+            double seconds = secondsSince(start);
+            BlockCompression::Decompress(test.format, blocks.data(), width, height, decoded);
+            reportLine("cooker", BlockCompression::Name(test.format), threads, seconds, blocks.size(), rawBytes, psnr(rgba, decoded.data(), texels, test.channels));
+            if (cores == 1)
+                break;
+        }
+
+    // SOIL's encoder, decoded with ours (the bytes are plain DXT1/DXT5 blocks)
+    for (BlockCompression::Format format : { BlockCompression::BC1, BlockCompression::BC3 })
+    {
+        int size = 0;
+        auto start = std::chrono::steady_clock::now();
+        unsigned char* blocks = format == BlockCompression::BC1 ? convert_image_to_DXT1(rgba, width, height, 4, &size) : convert_image_to_DXT5(rgba, width, height, 4, &size);
+        double seconds = secondsSince(start);
+        if (!blocks)
+            continue;
+        BlockCompression::Decompress(format, blocks, width, height, decoded);
+        reportLine("SOIL", BlockCompression::Name(format), 1, seconds, size, rawBytes, psnr(rgba, decoded.data(), texels, format == BlockCompression::BC1 ? rgb : all));
+        free(blocks);
+    }
+    stbi_image_free(rgba);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2 && strcmp(argv[1], "--report") == 0)
+    {
+        for (int i = 2; i < argc; ++i)
+            report(argv[i]);
+        return 0;
+    }
+
+    std::string input, output, format;
+    bool normalMap = false, mipmaps = true;
+    unsigned int threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            format = argv[++i];
+        else if (strcmp(argv[i], "--normal") == 0)
+            normalMap = true;
+        else if (strcmp(argv[i], "--no-mips") == 0)
+            mipmaps = false;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned int)strtoul(argv[++i], nullptr, 10);
+        else if (input.empty())
+            input = argv[i];
+        else
+            output = argv[i];
+    }
+    if (input.empty())
+    {
+        std::cout << "usage: texture_cooker <image> [output.dds] [--format bc1|bc3|bc5|bc7] [--normal] [--no-mips] [--threads count]\n"
+                     "       texture_cooker --report <image>..." << std::endl;
+        return 1;
+    }
+    if (output.empty())
+    {
+        // where Resource::LoadTexture looks for it
+        output = input;
+        size_t extension = output.find_last_of('.');
+        if (extension != std::string::npos && output.find_first_of("/\\", extension) == std::string::npos)
+            output.erase(extension);
+        output += ".dds";
+    }
+
+    int width, height, channels;
+    unsigned char* rgba = stbi_load(input.c_str(), &width, &height, &channels, 4);
+    if (!rgba)
+    {
+        std::cout << "ERROR::TEXTURE_COOKER: Failed to load " << input << std::endl;
+        return 1;
+    }
+
+    BlockCompression::Format blockFormat;
+    if (format == "bc1")
+        blockFormat = BlockCompression::BC1;
+    else if (format == "bc3")
+        blockFormat = BlockCompression::BC3;
+    else if (format == "bc5")
+        blockFormat = BlockCompression::BC5;
+    else if (format == "bc7")
+        blockFormat = BlockCompression::BC7;
+    else if (!format.empty())
+    {
+        std::cout << "ERROR::TEXTURE_COOKER: Unknown format " << format << std::endl;
+        stbi_image_free(rgba);
+        return 1;
+    }
+    else if (normalMap)
+        blockFormat = BlockCompression::BC5;
+    else
+    {
+        blockFormat = BlockCompression::BC1;
+        for (size_t i = 0; channels == 4 && i < (size_t)width * height; ++i)
+            if (rgba[i * 4 + 3] != 255)
+            {
+                blockFormat = BlockCompression::BC3;
+                break;
+            }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CompressedTexture cooked = CompressedTexture::Cook(rgba, width, height, blockFormat, mipmaps, normalMap, threads);
+    double seconds = secondsSince(start);
+    stbi_image_free(rgba);
+    if (!cooked.WriteDDS(output))
+    {
+        std::cout << "ERROR::TEXTURE_COOKER: Failed to write " << output << std::endl;
+        return 1;
+    }
+    printf("%s -> %s: %s, %dx%d, %d levels, %zu bytes in %.1f ms\n", input.c_str(), output.c_str(), BlockCompression::Name(blockFormat),
+           width, height, cooked.Levels(), cooked.ByteCount(), seconds * 1000.0);
+    return 0;
+}